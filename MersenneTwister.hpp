@@ -10,6 +10,7 @@
 ///
 #include <iostream>
 #include <cmath>
+#include "fastmath.hpp"
 
 ///
 /// @class MersenneTwister MersenneTwister.hpp
@@ -238,6 +239,34 @@ public:
   {
     return M_SQRT2*sigma*std::sqrt(-std::log(rand()))*cos(2*M_PI*rand());
   }
+
+  /// normal random numbers x[0], ..., x[n-1] (Box-Muller method)
+  ///
+  /// Both cosine and sine of a pair of uniform random numbers are used, and
+  /// the transformation is vectorized with fastmath. The sequence is thus
+  /// different from that of successive calls of normal(sigma).
+  void normal(double *x, const int n, const double sigma=1.0)
+  {
+    const int np = n/2;
+
+    for(int i=0; i < 2*np ;i++) {
+      x[i] = rand();
+    }
+
+#pragma omp simd
+    for(int i=0; i < np ;i++) {
+      double s, c;
+      const double r =
+        M_SQRT2*sigma*std::sqrt(-fastmath::log<fastmath::FULL>(x[2*i]));
+      fastmath::sincos<fastmath::FULL>(2*M_PI*x[2*i+1], s, c);
+      x[2*i  ] = r*c;
+      x[2*i+1] = r*s;
+    }
+
+    if( n % 2 == 1 ) {
+      x[n-1] = normal(sigma);
+    }
+  }
 };
 
 // Local Variables:
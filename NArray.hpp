@@ -9,6 +9,7 @@
 /// $Id$
 ///
 #include "config.hpp"
+#include "simd.hpp"
 
 ///
 /// @class NArray NArray.hpp
@@ -76,7 +77,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0];
   }
@@ -92,6 +93,20 @@ public:
     return data[i1*stride[0]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 /// @brief 2-dimensional array (partial specialization)
@@ -153,7 +168,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0]*shape[1];
   }
@@ -169,6 +184,20 @@ public:
     return data[i1*stride[0] + i2*stride[1]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 /// @brief 3-dimensional array (partial specialization)
@@ -241,7 +270,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0]*shape[1]*shape[2];
   }
@@ -257,6 +286,20 @@ public:
     return data[i1*stride[0] + i2*stride[1] + i3*stride[2]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 /// @brief 4-dimensional array (partial specialization)
@@ -341,7 +384,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0]*shape[1]*shape[2]*shape[3];
   }
@@ -361,6 +404,20 @@ public:
                 i4*stride[3]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 /// @brief 5-dimensional array (partial specialization)
@@ -454,7 +511,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0]*shape[1]*shape[2]*shape[3]*shape[4];
   }
@@ -474,6 +531,20 @@ public:
                 i4*stride[3] + i5*stride[4]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 /// @brief 6-dimensional array (partial specialization)
@@ -576,7 +647,7 @@ public:
   }
 
   /// get total number of element
-  uint64 getSize()
+  uint64 getSize() const
   {
     return shape[0]*shape[1]*shape[2]*shape[3]*shape[4]*shape[5];
   }
@@ -596,6 +667,20 @@ public:
                 i4*stride[3] + i5*stride[4] + i6*stride[5]];
   }
   //}
+
+  /// gather elements at flat indices: out[i] = data[index[i]]
+  template <class I>
+  void gather(const NArray<I,1> &index, NArray<T,1> &out) const
+  {
+    simd::gather(data, index.data, out.data, index.getSize());
+  }
+
+  /// add values to elements at flat indices: data[index[i]] += values[i]
+  template <class I>
+  void scatter_add(const NArray<I,1> &index, const NArray<T,1> &values)
+  {
+    simd::scatter_add(data, index.data, values.data, index.getSize());
+  }
 };
 
 // Local Variables:
@@ -0,0 +1,332 @@
+// -*- C++ -*-
+#ifndef _NARRAYMASK_HPP_
+#define _NARRAYMASK_HPP_
+
+///
+/// Active Region Mask for Multidimensional Array Container
+///
+/// $Id$
+///
+#include <vector>
+#include <limits>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "simd.hpp"
+
+///
+/// @class NArrayMask NArrayMask.hpp
+/// @brief A Mask of Active Cells for NArray
+///
+/// This object records a subset of elements (active cells) of an NArray, e.g.,
+/// cells above a density threshold or inside a refinement region. Active
+/// cells are stored both as a bitmask and as a compacted list of flat indices
+/// into the contiguous data block of NArray. Both are constructed in parallel
+/// with OpenMP.
+///
+/// Kernels and reductions iterate only over the active cells. Batch
+/// operations gather active elements into a small dense buffer (with SIMD
+/// gather instructions if available), apply a kernel (which is expected to be
+/// vectorized by the compiler), and scatter the results back to the original
+/// array.
+///
+/// Since the mask depends only on the total number of elements, it may be
+/// shared by any arrays of the same size.
+///
+class NArrayMask
+{
+public:
+  enum {
+    BATCH = 256 ///< number of elements in a dense batch
+  };
+
+private:
+  uint64              m_size;  ///< number of elements of masked array
+  std::vector<uint64> m_bits;  ///< bitmask (64 cells per word)
+  std::vector<int64>  m_index; ///< compacted list of active cells
+
+  // number of bits set
+  static int popcount(uint64 x)
+  {
+#if defined (__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for(; x != 0 ;n++) x &= x - 1;
+    return n;
+#endif
+  }
+
+  // number of trailing zeros (x should not be zero)
+  static int ctz(uint64 x)
+  {
+#if defined (__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for(; (x & 1) == 0 ;n++) x >>= 1;
+    return n;
+#endif
+  }
+
+public:
+  /// default constructor
+  NArrayMask() : m_size(0)
+  {
+  }
+
+  /// construct mask for an array with a predicate on element values
+  template <class T, int Rank, class Predicate>
+  NArrayMask(const NArray<T,Rank> &array, Predicate pred) : m_size(0)
+  {
+    build(array, pred);
+  }
+
+  ///
+  /// @brief select active cells by a predicate on flat indices
+  ///
+  /// The predicate pred(i) should return true if the i-th element of the
+  /// contiguous data block is active. It must be thread safe.
+  ///
+  template <class Predicate>
+  void select(const uint64 size, Predicate pred)
+  {
+    const int64 nword = (size + 63) / 64;
+    std::vector<int64> offset(nword+1);
+
+    m_size = size;
+    m_bits.resize(nword);
+
+    // bitmask and number of active cells in each word
+#pragma omp parallel for schedule(static)
+    for(int64 w=0; w < nword ;w++) {
+      const uint64 i0 = w*64;
+      const uint64 nb = (size - i0 < 64) ? size - i0 : 64;
+      uint64 bits = 0;
+      for(uint64 b=0; b < nb ;b++) {
+        bits |= static_cast<uint64>(pred(i0+b) ? 1 : 0) << b;
+      }
+      m_bits[w]   = bits;
+      offset[w+1] = popcount(bits);
+    }
+
+    // offset for each word (this is only 1/64 of the array size)
+    offset[0] = 0;
+    for(int64 w=0; w < nword ;w++) {
+      offset[w+1] += offset[w];
+    }
+
+    // compacted list of indices
+    m_index.resize(offset[nword]);
+#pragma omp parallel for schedule(static)
+    for(int64 w=0; w < nword ;w++) {
+      uint64 bits = m_bits[w];
+      int64  pos  = offset[w];
+      while( bits != 0 ) {
+        m_index[pos++] = w*64 + ctz(bits);
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  ///
+  /// @brief select active cells by a predicate on element values
+  ///
+  /// The predicate pred(x) should return true if the element value x is
+  /// active.
+  ///
+  template <class T, int Rank, class Predicate>
+  void build(const NArray<T,Rank> &array, Predicate pred)
+  {
+    const T* RESTRICT data = array.data;
+    select(array.getSize(), [=](uint64 i) { return pred(data[i]); });
+  }
+
+  /// clear mask
+  void clear()
+  {
+    m_size = 0;
+    m_bits.clear();
+    m_index.clear();
+  }
+
+  /// get number of elements of masked array
+  uint64 getSize() const
+  {
+    return m_size;
+  }
+
+  /// get number of active cells
+  uint64 getCount() const
+  {
+    return m_index.size();
+  }
+
+  /// get compacted list of flat indices of active cells
+  const int64* getIndex() const
+  {
+    return m_index.data();
+  }
+
+  /// get bitmask (bit i%64 of word i/64 is set for active cell i)
+  const uint64* getBits() const
+  {
+    return m_bits.data();
+  }
+
+  /// return true if the i-th element is active
+  bool isActive(const uint64 i) const
+  {
+    return (m_bits[i >> 6] >> (i & 63)) & 1;
+  }
+
+  ///
+  /// @brief apply kernel to each active cell
+  ///
+  /// The kernel is called as kernel(i) with flat index i of an active cell.
+  ///
+  template <class Kernel>
+  void forEach(Kernel kernel) const
+  {
+    const int64 count = m_index.size();
+    const int64* RESTRICT index = m_index.data();
+
+#pragma omp parallel for schedule(static)
+    for(int64 p=0; p < count ;p++) {
+      kernel(index[p]);
+    }
+  }
+
+  ///
+  /// @brief apply kernel to each batch of active cells
+  ///
+  /// The kernel is called as kernel(index, n) with a pointer to a list of n
+  /// (at most BATCH) flat indices of active cells. This is useful for a
+  /// kernel involving multiple arrays, which may be gathered into dense
+  /// buffers by the kernel itself.
+  ///
+  template <class Kernel>
+  void forEachBatch(Kernel kernel) const
+  {
+    const int64 count  = m_index.size();
+    const int64 nbatch = (count + BATCH - 1) / BATCH;
+    const int64* RESTRICT index = m_index.data();
+
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < nbatch ;ib++) {
+      const int64 p0 = ib*BATCH;
+      const int   n  = (count - p0 < BATCH) ?
+        static_cast<int>(count - p0) : static_cast<int>(BATCH);
+      kernel(&index[p0], n);
+    }
+  }
+
+  ///
+  /// @brief apply kernel to dense batches of active elements
+  ///
+  /// Active elements are gathered into a dense buffer, on which the kernel
+  /// is called as kernel(buffer, n) with the number of elements n (at most
+  /// BATCH). The buffer is then scattered back to the array.
+  ///
+  template <class T, int Rank, class Kernel>
+  void transform(NArray<T,Rank> &array, Kernel kernel) const
+  {
+    T* RESTRICT data = array.data;
+
+    forEachBatch([=](const int64* RESTRICT index, const int n)
+                 {
+                   T buffer[BATCH];
+                   simd::gather(data, index, buffer, n);
+                   kernel(buffer, n);
+                   for(int k=0; k < n ;k++) {
+                     data[index[k]] = buffer[k];
+                   }
+                 });
+  }
+
+  /// gather active elements into a dense array of size getCount()
+  template <class T, int Rank>
+  void gather(const NArray<T,Rank> &array, T* RESTRICT out) const
+  {
+    const int64* base = m_index.data();
+    const T* RESTRICT data = array.data;
+
+    forEachBatch([=](const int64* RESTRICT index, const int n)
+                 {
+                   simd::gather(data, index, &out[index - base], n);
+                 });
+  }
+
+  /// scatter a dense array of size getCount() into active elements
+  template <class T, int Rank>
+  void scatter(const T* RESTRICT in, NArray<T,Rank> &array) const
+  {
+    const int64 count = m_index.size();
+    const int64* RESTRICT index = m_index.data();
+    T* RESTRICT data = array.data;
+
+#pragma omp parallel for schedule(static)
+    for(int64 p=0; p < count ;p++) {
+      data[index[p]] = in[p];
+    }
+  }
+
+  /// @name reduction over active cells
+  //@{
+  /// return sum of active elements
+  template <class T, int Rank>
+  T sum(const NArray<T,Rank> &array) const
+  {
+    const int64 count = m_index.size();
+    const int64* RESTRICT index = m_index.data();
+    const T* RESTRICT data = array.data;
+    T result = 0;
+
+#pragma omp parallel for schedule(static) reduction(+:result)
+    for(int64 p=0; p < count ;p++) {
+      result += data[index[p]];
+    }
+
+    return result;
+  }
+
+  /// return maximum of active elements
+  template <class T, int Rank>
+  T maximum(const NArray<T,Rank> &array) const
+  {
+    const int64 count = m_index.size();
+    const int64* RESTRICT index = m_index.data();
+    const T* RESTRICT data = array.data;
+    T result = std::numeric_limits<T>::lowest();
+
+#pragma omp parallel for schedule(static) reduction(max:result)
+    for(int64 p=0; p < count ;p++) {
+      result = (data[index[p]] > result) ? data[index[p]] : result;
+    }
+
+    return result;
+  }
+
+  /// return minimum of active elements
+  template <class T, int Rank>
+  T minimum(const NArray<T,Rank> &array) const
+  {
+    const int64 count = m_index.size();
+    const int64* RESTRICT index = m_index.data();
+    const T* RESTRICT data = array.data;
+    T result = std::numeric_limits<T>::max();
+
+#pragma omp parallel for schedule(static) reduction(min:result)
+    for(int64 p=0; p < count ;p++) {
+      result = (data[index[p]] < result) ? data[index[p]] : result;
+    }
+
+    return result;
+  }
+  //@}
+};
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
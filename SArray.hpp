@@ -5,9 +5,18 @@
 ///
 /// Multidimensional Static Array Container
 ///
+/// All the metadata (ndim, size, dims and stride) are compile-time constants,
+/// and so are offsets computed from constant indices. SArray?D objects are
+/// aggregates holding nothing but the array itself; they can be initialized
+/// with brace-enclosed lists, copied by value, and used in constant
+/// expressions if T is a literal type. The pointer to the first element is
+/// returned by the member function ptr(), which replaces the former data
+/// member ptr (that pointed to the original object after a copy).
+///
 /// Author: Takanobu AMANO <amano@eps.s.u-tokyo.ac.jp>
 /// $Id$
 ///
+#include <cstddef>
 
 ///
 /// @class SArray1D SArray.hpp
@@ -17,23 +26,60 @@ template <class T, size_t N0>
 class SArray1D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[1];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 1;
+  static constexpr size_t size = N0;
+  static constexpr size_t dims[1] = {N0};
+  static constexpr size_t stride[1] = {1};
   T data[N0];
-  T* ptr;
 
-  SArray1D() { ptr = &data[0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0]; }
+  constexpr const T* ptr() const { return &data[0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0)
+  {
+    return i0*stride[0];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0) const
+  {
+    return data[i0];
+  }
+  T& operator()(int i0)
+  {
+    return data[i0];
+  }
+  //@}
+
+  /// access operator with flat index
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i];
+  }
+  T& operator[](int i)
+  {
+    return data[i];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0>
-const size_t SArray1D<T,N0>::ndim = 1;
+constexpr size_t SArray1D<T,N0>::ndim;
 template <class T, size_t N0>
-const size_t SArray1D<T,N0>::size = N0;
+constexpr size_t SArray1D<T,N0>::size;
 template <class T, size_t N0>
-const size_t SArray1D<T,N0>::dims[] = {N0};
-#endif
+constexpr size_t SArray1D<T,N0>::dims[];
+template <class T, size_t N0>
+constexpr size_t SArray1D<T,N0>::stride[];
 
 ///
 /// @class SArray2D SArray.hpp
@@ -43,23 +89,61 @@ template <class T, size_t N0, size_t N1>
 class SArray2D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[2];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 2;
+  static constexpr size_t size = N0*N1;
+  static constexpr size_t dims[2] = {N0, N1};
+  static constexpr size_t stride[2] = {N1, 1};
   T data[N0][N1];
-  T* ptr;
 
-  SArray2D() { ptr = &data[0][0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0][0]; }
+  constexpr const T* ptr() const { return &data[0][0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1)
+  {
+    return i0*stride[0] + i1*stride[1];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1) const
+  {
+    return data[i0][i1];
+  }
+  T& operator()(int i0, int i1)
+  {
+    return data[i0][i1];
+  }
+  //@}
+
+  /// access operator with flat index (converted to indices of data, as
+  /// pointer arithmetic across rows is not allowed in constant expressions)
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i / N1][i % N1];
+  }
+  T& operator[](int i)
+  {
+    return data[i / N1][i % N1];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0, size_t N1>
-const size_t SArray2D<T,N0,N1>::ndim = 2;
+constexpr size_t SArray2D<T,N0,N1>::ndim;
 template <class T, size_t N0, size_t N1>
-const size_t SArray2D<T,N0,N1>::size = N0*N1;
+constexpr size_t SArray2D<T,N0,N1>::size;
 template <class T, size_t N0, size_t N1>
-const size_t SArray2D<T,N0,N1>::dims[] = {N0, N1};
-#endif
+constexpr size_t SArray2D<T,N0,N1>::dims[];
+template <class T, size_t N0, size_t N1>
+constexpr size_t SArray2D<T,N0,N1>::stride[];
 
 ///
 /// @class SArray3D SArray.hpp
@@ -69,23 +153,61 @@ template <class T, size_t N0, size_t N1, size_t N2>
 class SArray3D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[3];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 3;
+  static constexpr size_t size = N0*N1*N2;
+  static constexpr size_t dims[3] = {N0, N1, N2};
+  static constexpr size_t stride[3] = {N1*N2, N2, 1};
   T data[N0][N1][N2];
-  T* ptr;
 
-  SArray3D() { ptr = &data[0][0][0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0][0][0]; }
+  constexpr const T* ptr() const { return &data[0][0][0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1, int i2)
+  {
+    return i0*stride[0] + i1*stride[1] + i2*stride[2];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1, int i2) const
+  {
+    return data[i0][i1][i2];
+  }
+  T& operator()(int i0, int i1, int i2)
+  {
+    return data[i0][i1][i2];
+  }
+  //@}
+
+  /// access operator with flat index (converted to indices of data, as
+  /// pointer arithmetic across rows is not allowed in constant expressions)
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i / (N1*N2)][i / N2 % N1][i % N2];
+  }
+  T& operator[](int i)
+  {
+    return data[i / (N1*N2)][i / N2 % N1][i % N2];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0, size_t N1, size_t N2>
-const size_t SArray3D<T,N0,N1,N2>::ndim = 3;
+constexpr size_t SArray3D<T,N0,N1,N2>::ndim;
 template <class T, size_t N0, size_t N1, size_t N2>
-const size_t SArray3D<T,N0,N1,N2>::size = N0*N1*N2;
+constexpr size_t SArray3D<T,N0,N1,N2>::size;
 template <class T, size_t N0, size_t N1, size_t N2>
-const size_t SArray3D<T,N0,N1,N2>::dims[] = {N0, N1, N2};
-#endif
+constexpr size_t SArray3D<T,N0,N1,N2>::dims[];
+template <class T, size_t N0, size_t N1, size_t N2>
+constexpr size_t SArray3D<T,N0,N1,N2>::stride[];
 
 ///
 /// @class SArray4D SArray.hpp
@@ -95,23 +217,62 @@ template <class T, size_t N0, size_t N1, size_t N2, size_t N3>
 class SArray4D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[4];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 4;
+  static constexpr size_t size = N0*N1*N2*N3;
+  static constexpr size_t dims[4] = {N0, N1, N2, N3};
+  static constexpr size_t stride[4] = {N1*N2*N3, N2*N3, N3, 1};
   T data[N0][N1][N2][N3];
-  T* ptr;
 
-  SArray4D() { ptr = &data[0][0][0][0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0][0][0][0]; }
+  constexpr const T* ptr() const { return &data[0][0][0][0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1, int i2, int i3)
+  {
+    return i0*stride[0] + i1*stride[1] + i2*stride[2] +
+      i3*stride[3];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1, int i2, int i3) const
+  {
+    return data[i0][i1][i2][i3];
+  }
+  T& operator()(int i0, int i1, int i2, int i3)
+  {
+    return data[i0][i1][i2][i3];
+  }
+  //@}
+
+  /// access operator with flat index (converted to indices of data, as
+  /// pointer arithmetic across rows is not allowed in constant expressions)
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i / (N1*N2*N3)][i / (N2*N3) % N1][i / N3 % N2][i % N3];
+  }
+  T& operator[](int i)
+  {
+    return data[i / (N1*N2*N3)][i / (N2*N3) % N1][i / N3 % N2][i % N3];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3>
-const size_t SArray4D<T,N0,N1,N2,N3>::ndim = 4;
+constexpr size_t SArray4D<T,N0,N1,N2,N3>::ndim;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3>
-const size_t SArray4D<T,N0,N1,N2,N3>::size = N0*N1*N2*N3;
+constexpr size_t SArray4D<T,N0,N1,N2,N3>::size;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3>
-const size_t SArray4D<T,N0,N1,N2,N3>::dims[] = {N0, N1, N2, N3};
-#endif
+constexpr size_t SArray4D<T,N0,N1,N2,N3>::dims[];
+template <class T, size_t N0, size_t N1, size_t N2, size_t N3>
+constexpr size_t SArray4D<T,N0,N1,N2,N3>::stride[];
 
 ///
 /// @class SArray5D SArray.hpp
@@ -121,23 +282,64 @@ template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4>
 class SArray5D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[5];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 5;
+  static constexpr size_t size = N0*N1*N2*N3*N4;
+  static constexpr size_t dims[5] = {N0, N1, N2, N3, N4};
+  static constexpr size_t stride[5] = {N1*N2*N3*N4, N2*N3*N4, N3*N4, N4, 1};
   T data[N0][N1][N2][N3][N4];
-  T* ptr;
 
-  SArray5D() { ptr = &data[0][0][0][0][0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0][0][0][0][0]; }
+  constexpr const T* ptr() const { return &data[0][0][0][0][0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1, int i2, int i3, int i4)
+  {
+    return i0*stride[0] + i1*stride[1] + i2*stride[2] +
+      i3*stride[3] + i4*stride[4];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1, int i2, int i3, int i4) const
+  {
+    return data[i0][i1][i2][i3][i4];
+  }
+  T& operator()(int i0, int i1, int i2, int i3, int i4)
+  {
+    return data[i0][i1][i2][i3][i4];
+  }
+  //@}
+
+  /// access operator with flat index (converted to indices of data, as
+  /// pointer arithmetic across rows is not allowed in constant expressions)
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i / (N1*N2*N3*N4)][i / (N2*N3*N4) % N1][i / (N3*N4) % N2]
+      [i / N4 % N3][i % N4];
+  }
+  T& operator[](int i)
+  {
+    return data[i / (N1*N2*N3*N4)][i / (N2*N3*N4) % N1][i / (N3*N4) % N2]
+      [i / N4 % N3][i % N4];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4>
-const size_t SArray5D<T,N0,N1,N2,N3,N4>::ndim = 5;
+constexpr size_t SArray5D<T,N0,N1,N2,N3,N4>::ndim;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4>
-const size_t SArray5D<T,N0,N1,N2,N3,N4>::size = N0*N1*N2*N3*N4;
+constexpr size_t SArray5D<T,N0,N1,N2,N3,N4>::size;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4>
-const size_t SArray5D<T,N0,N1,N2,N3,N4>::dims[] = {N0, N1, N2, N3, N4};
-#endif
+constexpr size_t SArray5D<T,N0,N1,N2,N3,N4>::dims[];
+template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4>
+constexpr size_t SArray5D<T,N0,N1,N2,N3,N4>::stride[];
 
 ///
 /// @class SArray6D SArray.hpp
@@ -148,26 +350,70 @@ template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4,
 class SArray6D
 {
 public:
-  static const size_t ndim;
-  static const size_t size;
-  static const size_t dims[6];
+  typedef T value_type;
+
+  static constexpr size_t ndim = 6;
+  static constexpr size_t size = N0*N1*N2*N3*N4*N5;
+  static constexpr size_t dims[6] = {N0, N1, N2, N3, N4, N5};
+  static constexpr size_t stride[6] = {N1*N2*N3*N4*N5, N2*N3*N4*N5, N3*N4*N5,
+                                       N4*N5, N5, 1};
   T data[N0][N1][N2][N3][N4][N5];
-  T* ptr;
 
-  SArray6D() { ptr = &data[0][0][0][0][0][0]; }
+  /// return pointer to the first element
+  //@{
+  T* ptr() { return &data[0][0][0][0][0][0]; }
+  constexpr const T* ptr() const { return &data[0][0][0][0][0][0]; }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1, int i2, int i3, int i4, int i5)
+  {
+    return i0*stride[0] + i1*stride[1] + i2*stride[2] +
+      i3*stride[3] + i4*stride[4] + i5*stride[5];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1, int i2, int i3, int i4,
+                                int i5) const
+  {
+    return data[i0][i1][i2][i3][i4][i5];
+  }
+  T& operator()(int i0, int i1, int i2, int i3, int i4, int i5)
+  {
+    return data[i0][i1][i2][i3][i4][i5];
+  }
+  //@}
+
+  /// access operator with flat index (converted to indices of data, as
+  /// pointer arithmetic across rows is not allowed in constant expressions)
+  //@{
+  constexpr const T& operator[](int i) const
+  {
+    return data[i / (N1*N2*N3*N4*N5)][i / (N2*N3*N4*N5) % N1]
+      [i / (N3*N4*N5) % N2][i / (N4*N5) % N3][i / N5 % N4][i % N5];
+  }
+  T& operator[](int i)
+  {
+    return data[i / (N1*N2*N3*N4*N5)][i / (N2*N3*N4*N5) % N1]
+      [i / (N3*N4*N5) % N2][i / (N4*N5) % N3][i / N5 % N4][i % N5];
+  }
+  //@}
 };
 
-#ifdef __MAIN__
+// definition of static members (required for odr-use before C++17)
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4,
           size_t N5>
-const size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::ndim = 6;
+constexpr size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::ndim;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4,
           size_t N5>
-const size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::size = N0*N1*N2*N3*N4*N5;
+constexpr size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::size;
 template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4,
           size_t N5>
-const size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::dims[] = {N0, N1, N2, N3, N4, N5};
-#endif
+constexpr size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::dims[];
+template <class T, size_t N0, size_t N1, size_t N2, size_t N3, size_t N4,
+          size_t N5>
+constexpr size_t SArray6D<T,N0,N1,N2,N3,N4,N5>::stride[];
 
 // Local Variables:
 // c-file-style   : "gnu"
@@ -0,0 +1,349 @@
+// -*- C++ -*-
+#ifndef _SARRAYALIGNED_HPP_
+#define _SARRAYALIGNED_HPP_
+
+///
+/// Aligned Static Array Container
+///
+/// SArrayAligned?D is a variant of SArray?D of which the array is aligned to
+/// A byte (SIMD width by default, or CACHE_LINE_BYTES for cache line), and the
+/// innermost extent is padded to a multiple of A byte. Every innermost row
+/// thus starts at an aligned address, and it may be processed as a whole
+/// (including padding) with aligned full-width vector instructions. This is
+/// intended for register and L1 tiles in stencil inner loops.
+///
+/// Metadata are compile-time constants as in SArray?D: dims are the logical
+/// extents, whereas padded and stride take the padding into account.
+/// The padding is not initialized unless fill() is called.
+///
+/// Note that dynamic allocation of over-aligned objects (i.e., A larger than
+/// alignof(std::max_align_t)) requires C++17 aligned new.
+///
+/// $Id$
+///
+#include <cstddef>
+#include "config.hpp"
+#include "simd.hpp"
+
+/// compile-time padding of innermost extent
+template <class T, size_t N, size_t A>
+struct SArrayPadding
+{
+  static_assert((A & (A-1)) == 0, "alignment must be a power of two");
+  static_assert(A % sizeof(T) == 0 && A >= alignof(T),
+                "alignment must be a multiple of element size");
+
+  static constexpr size_t value = ((N*sizeof(T) + A - 1)/A)*A/sizeof(T);
+};
+
+///
+/// @class SArrayAligned1D SArrayAligned.hpp
+/// @brief An Aligned 1D Static Array Container Object
+///
+template <class T, size_t N0, size_t A = SIMD_BYTES>
+class SArrayAligned1D
+{
+public:
+  typedef T value_type;
+
+  static constexpr size_t ndim      = 1;
+  static constexpr size_t size      = N0;
+  static constexpr size_t alignment = A;
+  static constexpr size_t padded    = SArrayPadding<T,N0,A>::value;
+  static constexpr size_t storage   = padded;
+  static constexpr size_t dims[1]   = {N0};
+  static constexpr size_t stride[1] = {1};
+  alignas(A) T data[padded];
+
+  /// return aligned pointer to the first element
+  //@{
+  T* ptr() { return simd::assume_aligned<A>(&data[0]); }
+  const T* ptr() const { return simd::assume_aligned<A>(&data[0]); }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0)
+  {
+    return i0*stride[0];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0) const
+  {
+    return data[i0];
+  }
+  T& operator()(int i0)
+  {
+    return data[i0];
+  }
+  //@}
+
+  /// fill all the elements including padding
+  void fill(const T value)
+  {
+    T* RESTRICT p = ptr();
+#pragma omp simd
+    for(size_t i=0; i < storage ;i++) {
+      p[i] = value;
+    }
+  }
+
+  /// load elements from (unaligned) memory
+  void load(const T* RESTRICT src)
+  {
+    T* RESTRICT p = ptr();
+#pragma omp simd
+    for(size_t i=0; i < N0 ;i++) {
+      p[i] = src[i];
+    }
+  }
+
+  /// store elements to (unaligned) memory
+  void store(T* RESTRICT dst) const
+  {
+    const T* RESTRICT p = ptr();
+#pragma omp simd
+    for(size_t i=0; i < N0 ;i++) {
+      dst[i] = p[i];
+    }
+  }
+};
+
+// definition of static members (required for odr-use before C++17)
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::ndim;
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::size;
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::alignment;
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::padded;
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::storage;
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::dims[];
+template <class T, size_t N0, size_t A>
+constexpr size_t SArrayAligned1D<T,N0,A>::stride[];
+
+///
+/// @class SArrayAligned2D SArrayAligned.hpp
+/// @brief An Aligned 2D Static Array Container Object
+///
+template <class T, size_t N0, size_t N1, size_t A = SIMD_BYTES>
+class SArrayAligned2D
+{
+public:
+  typedef T value_type;
+
+  static constexpr size_t ndim      = 2;
+  static constexpr size_t size      = N0*N1;
+  static constexpr size_t alignment = A;
+  static constexpr size_t padded    = SArrayPadding<T,N1,A>::value;
+  static constexpr size_t storage   = N0*padded;
+  static constexpr size_t dims[2]   = {N0, N1};
+  static constexpr size_t stride[2] = {padded, 1};
+  alignas(A) T data[N0][padded];
+
+  /// return aligned pointer to the first element
+  //@{
+  T* ptr() { return simd::assume_aligned<A>(&data[0][0]); }
+  const T* ptr() const { return simd::assume_aligned<A>(&data[0][0]); }
+  //@}
+
+  /// return aligned pointer to an innermost row
+  //@{
+  T* row(int i0) { return simd::assume_aligned<A>(&data[i0][0]); }
+  const T* row(int i0) const { return simd::assume_aligned<A>(&data[i0][0]); }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1)
+  {
+    return i0*stride[0] + i1*stride[1];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1) const
+  {
+    return data[i0][i1];
+  }
+  T& operator()(int i0, int i1)
+  {
+    return data[i0][i1];
+  }
+  //@}
+
+  /// fill all the elements including padding
+  void fill(const T value)
+  {
+    T* RESTRICT p = ptr();
+#pragma omp simd
+    for(size_t i=0; i < storage ;i++) {
+      p[i] = value;
+    }
+  }
+
+  /// load elements from (unaligned) memory: data[i0][i1] = src[i0*s0 + i1]
+  void load(const T* RESTRICT src, const int64 s0)
+  {
+    for(size_t i0=0; i0 < N0 ;i0++) {
+      T* RESTRICT p = row(i0);
+      const T* RESTRICT q = &src[i0*s0];
+#pragma omp simd
+      for(size_t i1=0; i1 < N1 ;i1++) {
+        p[i1] = q[i1];
+      }
+    }
+  }
+
+  /// store elements to (unaligned) memory: dst[i0*s0 + i1] = data[i0][i1]
+  void store(T* RESTRICT dst, const int64 s0) const
+  {
+    for(size_t i0=0; i0 < N0 ;i0++) {
+      const T* RESTRICT p = row(i0);
+      T* RESTRICT q = &dst[i0*s0];
+#pragma omp simd
+      for(size_t i1=0; i1 < N1 ;i1++) {
+        q[i1] = p[i1];
+      }
+    }
+  }
+};
+
+// definition of static members (required for odr-use before C++17)
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::ndim;
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::size;
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::alignment;
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::padded;
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::storage;
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::dims[];
+template <class T, size_t N0, size_t N1, size_t A>
+constexpr size_t SArrayAligned2D<T,N0,N1,A>::stride[];
+
+///
+/// @class SArrayAligned3D SArrayAligned.hpp
+/// @brief An Aligned 3D Static Array Container Object
+///
+template <class T, size_t N0, size_t N1, size_t N2, size_t A = SIMD_BYTES>
+class SArrayAligned3D
+{
+public:
+  typedef T value_type;
+
+  static constexpr size_t ndim      = 3;
+  static constexpr size_t size      = N0*N1*N2;
+  static constexpr size_t alignment = A;
+  static constexpr size_t padded    = SArrayPadding<T,N2,A>::value;
+  static constexpr size_t storage   = N0*N1*padded;
+  static constexpr size_t dims[3]   = {N0, N1, N2};
+  static constexpr size_t stride[3] = {N1*padded, padded, 1};
+  alignas(A) T data[N0][N1][padded];
+
+  /// return aligned pointer to the first element
+  //@{
+  T* ptr() { return simd::assume_aligned<A>(&data[0][0][0]); }
+  const T* ptr() const { return simd::assume_aligned<A>(&data[0][0][0]); }
+  //@}
+
+  /// return aligned pointer to an innermost row
+  //@{
+  T* row(int i0, int i1)
+  {
+    return simd::assume_aligned<A>(&data[i0][i1][0]);
+  }
+  const T* row(int i0, int i1) const
+  {
+    return simd::assume_aligned<A>(&data[i0][i1][0]);
+  }
+  //@}
+
+  /// return offset of an element from the first element
+  static constexpr size_t offset(int i0, int i1, int i2)
+  {
+    return i0*stride[0] + i1*stride[1] + i2*stride[2];
+  }
+
+  /// access operator
+  //@{
+  constexpr const T& operator()(int i0, int i1, int i2) const
+  {
+    return data[i0][i1][i2];
+  }
+  T& operator()(int i0, int i1, int i2)
+  {
+    return data[i0][i1][i2];
+  }
+  //@}
+
+  /// fill all the elements including padding
+  void fill(const T value)
+  {
+    T* RESTRICT p = ptr();
+#pragma omp simd
+    for(size_t i=0; i < storage ;i++) {
+      p[i] = value;
+    }
+  }
+
+  /// load elements from (unaligned) memory:
+  /// data[i0][i1][i2] = src[i0*s0 + i1*s1 + i2]
+  void load(const T* RESTRICT src, const int64 s0, const int64 s1)
+  {
+    for(size_t i0=0; i0 < N0 ;i0++) {
+      for(size_t i1=0; i1 < N1 ;i1++) {
+        T* RESTRICT p = row(i0, i1);
+        const T* RESTRICT q = &src[i0*s0 + i1*s1];
+#pragma omp simd
+        for(size_t i2=0; i2 < N2 ;i2++) {
+          p[i2] = q[i2];
+        }
+      }
+    }
+  }
+
+  /// store elements to (unaligned) memory:
+  /// dst[i0*s0 + i1*s1 + i2] = data[i0][i1][i2]
+  void store(T* RESTRICT dst, const int64 s0, const int64 s1) const
+  {
+    for(size_t i0=0; i0 < N0 ;i0++) {
+      for(size_t i1=0; i1 < N1 ;i1++) {
+        const T* RESTRICT p = row(i0, i1);
+        T* RESTRICT q = &dst[i0*s0 + i1*s1];
+#pragma omp simd
+        for(size_t i2=0; i2 < N2 ;i2++) {
+          q[i2] = p[i2];
+        }
+      }
+    }
+  }
+};
+
+// definition of static members (required for odr-use before C++17)
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::ndim;
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::size;
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::alignment;
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::padded;
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::storage;
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::dims[];
+template <class T, size_t N0, size_t N1, size_t N2, size_t A>
+constexpr size_t SArrayAligned3D<T,N0,N1,N2,A>::stride[];
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,461 @@
+// -*- C++ -*-
+#ifndef _SARRAYBATCH_HPP_
+#define _SARRAYBATCH_HPP_
+
+///
+/// Batched Container of Small Static Arrays
+///
+/// $Id$
+///
+#include <cmath>
+#include <limits>
+#include "config.hpp"
+#include "simd.hpp"
+#include "SArray.hpp"
+
+///
+/// @class SArrayBatch1D SArrayBatch.hpp
+/// @brief A Batch of Small Vectors in SIMD-friendly SoA Layout
+///
+/// A batch of count vectors of length N0 is stored in blocks of W vectors
+/// (W is the number of SIMD lanes by default). Within a block, the element
+/// i of W vectors is contiguous, i.e., the layout is [block][N0][W]. Loops
+/// over lanes are thus unit stride, and one SIMD instruction processes W
+/// vectors (e.g., W grid cells) at once. The last block is padded.
+///
+template <class T, size_t N0, int W = simd::lanes<T>::value>
+class SArrayBatch1D
+{
+private:
+  // remain undefined
+  //@{
+  SArrayBatch1D& operator=(const SArrayBatch1D &batch);
+  SArrayBatch1D(const SArrayBatch1D &batch);
+  //@}
+
+public:
+  typedef SArray1D<T,N0> T_element;
+  typedef T T_block[N0][W];
+
+  static const int lanes = W;
+
+  uint64 count;  ///< number of vectors
+  uint64 nblock; ///< number of blocks
+  T* RESTRICT data;
+
+  /// constructor
+  SArrayBatch1D(const uint64 n) : count(n), nblock((n + W - 1) / W)
+  {
+    data = simd::aligned_alloc<T>(nblock*N0*W);
+    for(uint64 i=0; i < nblock*N0*W ;i++) data[i] = 0;
+  }
+
+  /// destructor
+  ~SArrayBatch1D()
+  {
+    simd::aligned_free(data);
+  }
+
+  /// return pointer to the b-th block
+  T_block* block(const uint64 b)
+  {
+    return reinterpret_cast<T_block*>(data + b*N0*W);
+  }
+
+  /// access operator: i-th element of the n-th vector
+  //@{
+  const T& operator()(const uint64 n, const int i) const
+  {
+    return data[((n/W)*N0 + i)*W + n%W];
+  }
+  T& operator()(const uint64 n, const int i)
+  {
+    return data[((n/W)*N0 + i)*W + n%W];
+  }
+  //@}
+
+  /// copy the n-th vector from SArray1D
+  void load(const uint64 n, const T_element &x)
+  {
+    for(size_t i=0; i < N0 ;i++) (*this)(n,i) = x.data[i];
+  }
+
+  /// copy the n-th vector to SArray1D
+  void store(const uint64 n, T_element &x) const
+  {
+    for(size_t i=0; i < N0 ;i++) x.data[i] = (*this)(n,i);
+  }
+};
+
+///
+/// @class SArrayBatch2D SArrayBatch.hpp
+/// @brief A Batch of Small Matrices in SIMD-friendly SoA Layout
+///
+/// A batch of count matrices of N0 x N1 is stored in blocks of W matrices.
+/// The layout is [block][N0][N1][W]; see SArrayBatch1D.
+///
+template <class T, size_t N0, size_t N1, int W = simd::lanes<T>::value>
+class SArrayBatch2D
+{
+private:
+  // remain undefined
+  //@{
+  SArrayBatch2D& operator=(const SArrayBatch2D &batch);
+  SArrayBatch2D(const SArrayBatch2D &batch);
+  //@}
+
+public:
+  typedef SArray2D<T,N0,N1> T_element;
+  typedef T T_block[N0][N1][W];
+
+  static const int lanes = W;
+
+  uint64 count;  ///< number of matrices
+  uint64 nblock; ///< number of blocks
+  T* RESTRICT data;
+
+  /// constructor
+  SArrayBatch2D(const uint64 n) : count(n), nblock((n + W - 1) / W)
+  {
+    data = simd::aligned_alloc<T>(nblock*N0*N1*W);
+    for(uint64 i=0; i < nblock*N0*N1*W ;i++) data[i] = 0;
+  }
+
+  /// destructor
+  ~SArrayBatch2D()
+  {
+    simd::aligned_free(data);
+  }
+
+  /// return pointer to the b-th block
+  T_block* block(const uint64 b)
+  {
+    return reinterpret_cast<T_block*>(data + b*N0*N1*W);
+  }
+
+  /// access operator: (i,j) element of the n-th matrix
+  //@{
+  const T& operator()(const uint64 n, const int i, const int j) const
+  {
+    return data[(((n/W)*N0 + i)*N1 + j)*W + n%W];
+  }
+  T& operator()(const uint64 n, const int i, const int j)
+  {
+    return data[(((n/W)*N0 + i)*N1 + j)*W + n%W];
+  }
+  //@}
+
+  /// copy the n-th matrix from SArray2D
+  void load(const uint64 n, const T_element &x)
+  {
+    for(size_t i=0; i < N0 ;i++)
+      for(size_t j=0; j < N1 ;j++)
+        (*this)(n,i,j) = x.data[i][j];
+  }
+
+  /// copy the n-th matrix to SArray2D
+  void store(const uint64 n, T_element &x) const
+  {
+    for(size_t i=0; i < N0 ;i++)
+      for(size_t j=0; j < N1 ;j++)
+        x.data[i][j] = (*this)(n,i,j);
+  }
+};
+
+///
+/// @brief Batched Kernels for Small Dense Linear Algebra
+///
+/// Each kernel processes a block of W systems with loops over lanes as the
+/// innermost loops, which are vectorized. Data dependent branches (e.g.,
+/// row exchanges of partial pivoting) are replaced by per-lane selection.
+/// Blocks are distributed over OpenMP threads. The padded lanes of the last
+/// block hold zero matrices initially; results for these are meaningless
+/// (possibly inf or nan) and should be ignored.
+///
+namespace sarraybatch
+{
+///
+/// @brief solve A X = B for a block with partial pivoting
+///
+/// On exit, a is destroyed and b is overwritten by the solution.
+///
+template <class T, int N, int M, int W>
+inline void solve_block(T a[N][N][W], T b[N][M][W])
+{
+  for(int k=0; k < N ;k++) {
+    int pivot[W];
+    T   amax[W];
+
+    // search pivot
+#pragma omp simd
+    for(int l=0; l < W ;l++) {
+      pivot[l] = k;
+      amax[l]  = std::abs(a[k][k][l]);
+    }
+    for(int r=k+1; r < N ;r++) {
+#pragma omp simd
+      for(int l=0; l < W ;l++) {
+        const T    x = std::abs(a[r][k][l]);
+        const bool s = x > amax[l];
+        pivot[l] = s ? r : pivot[l];
+        amax[l]  = s ? x : amax[l];
+      }
+    }
+
+    // exchange rows k and pivot
+    for(int r=k+1; r < N ;r++) {
+      for(int j=k; j < N ;j++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          const bool s = pivot[l] == r;
+          const T    x = a[k][j][l];
+          const T    y = a[r][j][l];
+          a[k][j][l] = s ? y : x;
+          a[r][j][l] = s ? x : y;
+        }
+      }
+      for(int j=0; j < M ;j++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          const bool s = pivot[l] == r;
+          const T    x = b[k][j][l];
+          const T    y = b[r][j][l];
+          b[k][j][l] = s ? y : x;
+          b[r][j][l] = s ? x : y;
+        }
+      }
+    }
+
+    // forward elimination
+    for(int r=k+1; r < N ;r++) {
+      T f[W];
+#pragma omp simd
+      for(int l=0; l < W ;l++) {
+        f[l] = a[r][k][l] / a[k][k][l];
+        a[r][k][l] = f[l];
+      }
+      for(int j=k+1; j < N ;j++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          a[r][j][l] -= f[l]*a[k][j][l];
+        }
+      }
+      for(int j=0; j < M ;j++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          b[r][j][l] -= f[l]*b[k][j][l];
+        }
+      }
+    }
+  }
+
+  // backward substitution
+  for(int k=N-1; k >= 0 ;k--) {
+    for(int j=0; j < M ;j++) {
+      for(int i=k+1; i < N ;i++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          b[k][j][l] -= a[k][i][l]*b[i][j][l];
+        }
+      }
+#pragma omp simd
+      for(int l=0; l < W ;l++) {
+        b[k][j][l] /= a[k][k][l];
+      }
+    }
+  }
+}
+
+///
+/// @brief eigenvalues and eigenvectors of symmetric matrices for a block
+///
+/// The cyclic Jacobi method is used. On exit, a is destroyed, w contains
+/// eigenvalues in ascending order and columns of v are the corresponding
+/// normalized eigenvectors. Iteration terminates when off-diagonal elements
+/// are negligible in all lanes, or when the number of sweeps reaches
+/// maxsweep.
+///
+template <class T, int N, int W>
+inline void eigen_block(T a[N][N][W], T w[N][W], T v[N][N][W],
+                        const int maxsweep)
+{
+  const T eps = std::numeric_limits<T>::epsilon();
+
+  // initialize eigenvectors
+  for(int i=0; i < N ;i++) {
+    for(int j=0; j < N ;j++) {
+#pragma omp simd
+      for(int l=0; l < W ;l++) {
+        v[i][j][l] = (i == j) ? 1 : 0;
+      }
+    }
+  }
+
+  for(int sweep=0; sweep < maxsweep ;sweep++) {
+    // convergence check
+    T offmax = 0;
+    for(int p=0; p < N ;p++) {
+      for(int q=p+1; q < N ;q++) {
+        for(int l=0; l < W ;l++) {
+          const T x = std::abs(a[p][q][l]) -
+            eps*(std::abs(a[p][p][l]) + std::abs(a[q][q][l]));
+          offmax = x > offmax ? x : offmax;
+        }
+      }
+    }
+    if( offmax <= 0 ) break;
+
+    // sweep over off-diagonal elements
+    for(int p=0; p < N ;p++) {
+      for(int q=p+1; q < N ;q++) {
+        T c[W];
+        T s[W];
+
+        // rotation angle
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          const T app = a[p][p][l];
+          const T aqq = a[q][q][l];
+          const T apq = a[p][q][l];
+          const bool skip = std::abs(apq) <=
+            eps*(std::abs(app) + std::abs(aqq));
+
+          const T theta = (aqq - app) / (2 * (skip ? 1 : apq));
+          const T tt    = std::copysign(T(1), theta) /
+            (std::abs(theta) + std::sqrt(theta*theta + 1));
+          const T t = skip ? 0 : tt;
+          c[l] = 1 / std::sqrt(t*t + 1);
+          s[l] = t * c[l];
+        }
+
+        // rotate
+        for(int r=0; r < N ;r++) {
+#pragma omp simd
+          for(int l=0; l < W ;l++) {
+            const T arp = a[r][p][l];
+            const T arq = a[r][q][l];
+            a[r][p][l] = c[l]*arp - s[l]*arq;
+            a[r][q][l] = s[l]*arp + c[l]*arq;
+          }
+        }
+        for(int r=0; r < N ;r++) {
+#pragma omp simd
+          for(int l=0; l < W ;l++) {
+            const T apr = a[p][r][l];
+            const T aqr = a[q][r][l];
+            a[p][r][l] = c[l]*apr - s[l]*aqr;
+            a[q][r][l] = s[l]*apr + c[l]*aqr;
+          }
+        }
+        for(int r=0; r < N ;r++) {
+#pragma omp simd
+          for(int l=0; l < W ;l++) {
+            const T vrp = v[r][p][l];
+            const T vrq = v[r][q][l];
+            v[r][p][l] = c[l]*vrp - s[l]*vrq;
+            v[r][q][l] = s[l]*vrp + c[l]*vrq;
+          }
+        }
+      }
+    }
+  }
+
+  // eigenvalues
+  for(int i=0; i < N ;i++) {
+#pragma omp simd
+    for(int l=0; l < W ;l++) {
+      w[i][l] = a[i][i][l];
+    }
+  }
+
+  // sort in ascending order with an odd-even transposition network
+  for(int pass=0; pass < N ;pass++) {
+    for(int i=pass%2; i+1 < N ;i+=2) {
+      bool s[W];
+#pragma omp simd
+      for(int l=0; l < W ;l++) {
+        const T x = w[i][l];
+        const T y = w[i+1][l];
+        s[l] = x > y;
+        w[i  ][l] = s[l] ? y : x;
+        w[i+1][l] = s[l] ? x : y;
+      }
+      for(int r=0; r < N ;r++) {
+#pragma omp simd
+        for(int l=0; l < W ;l++) {
+          const T vx = v[r][i  ][l];
+          const T vy = v[r][i+1][l];
+          v[r][i  ][l] = s[l] ? vy : vx;
+          v[r][i+1][l] = s[l] ? vx : vy;
+        }
+      }
+    }
+  }
+}
+
+///
+/// @brief solve A x = b
+///
+/// On exit, a is destroyed and b is overwritten by the solution x.
+///
+template <class T, size_t N, int W>
+inline void solve(SArrayBatch2D<T,N,N,W> &a, SArrayBatch1D<T,N,W> &b)
+{
+  typedef T T_rhs[N][1][W];
+  const int64 nblock = a.nblock;
+
+#pragma omp parallel for schedule(static)
+  for(int64 ib=0; ib < nblock ;ib++) {
+    solve_block<T,N,1,W>(*a.block(ib),
+                         *reinterpret_cast<T_rhs*>(b.block(ib)));
+  }
+}
+
+///
+/// @brief compute inverse matrices
+///
+/// On exit, a is destroyed and ainv contains the inverse.
+///
+template <class T, size_t N, int W>
+inline void inverse(SArrayBatch2D<T,N,N,W> &a, SArrayBatch2D<T,N,N,W> &ainv)
+{
+  const int64 nblock = a.nblock;
+
+#pragma omp parallel for schedule(static)
+  for(int64 ib=0; ib < nblock ;ib++) {
+    T (*x)[N][W] = *ainv.block(ib);
+    for(size_t i=0; i < N ;i++) {
+      for(size_t j=0; j < N ;j++) {
+        for(int l=0; l < W ;l++) {
+          x[i][j][l] = (i == j) ? 1 : 0;
+        }
+      }
+    }
+    solve_block<T,N,N,W>(*a.block(ib), x);
+  }
+}
+
+///
+/// @brief compute eigenvalues and eigenvectors of symmetric matrices
+///
+/// On exit, a is destroyed, w contains eigenvalues in ascending order and
+/// the columns of v are the corresponding eigenvectors.
+///
+template <class T, size_t N, int W>
+inline void eigen(SArrayBatch2D<T,N,N,W> &a, SArrayBatch1D<T,N,W> &w,
+                  SArrayBatch2D<T,N,N,W> &v, const int maxsweep=16)
+{
+  const int64 nblock = a.nblock;
+
+#pragma omp parallel for schedule(static)
+  for(int64 ib=0; ib < nblock ;ib++) {
+    eigen_block<T,N,W>(*a.block(ib), *w.block(ib), *v.block(ib), maxsweep);
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,325 @@
+// -*- C++ -*-
+#ifndef _SARRAYMATH_HPP_
+#define _SARRAYMATH_HPP_
+
+///
+/// Vector and Tensor Arithmetic on Static Arrays
+///
+/// Elementwise arithmetic operators for SArray1D and SArray2D, and small
+/// linear algebra operations (dot, cross, matvec, matmul, transpose, det and
+/// inverse) which are common in particle pushers and per-cell solvers.
+/// All loops over elements are unrolled at compile time with constant
+/// indices, such that the compiler generates straight-line code (friendly
+/// to SLP vectorization) without loops or temporary arrays.
+///
+/// $Id$
+///
+#include <cmath>
+#include <type_traits>
+#include "config.hpp"
+#include "SArray.hpp"
+#include "loopnest.hpp"
+
+/// type traits for SArray types supporting arithmetic operators
+//@{
+template <class T_array>
+struct SArrayTraits
+{
+  static const bool is_sarray = false;
+};
+
+template <class T, size_t N0>
+struct SArrayTraits< SArray1D<T,N0> >
+{
+  static const bool is_sarray = true;
+
+  // access element with flat index
+  template <class I>
+  static INLINE T& at(SArray1D<T,N0> &a, I i)
+  {
+    return a.data[i];
+  }
+  template <class I>
+  static INLINE const T& at(const SArray1D<T,N0> &a, I i)
+  {
+    return a.data[i];
+  }
+};
+
+template <class T, size_t N0, size_t N1>
+struct SArrayTraits< SArray2D<T,N0,N1> >
+{
+  static const bool is_sarray = true;
+
+  // access element with flat index
+  template <class I>
+  static INLINE T& at(SArray2D<T,N0,N1> &a, I i)
+  {
+    return a.data[i/N1][i%N1];
+  }
+  template <class I>
+  static INLINE const T& at(const SArray2D<T,N0,N1> &a, I i)
+  {
+    return a.data[i/N1][i%N1];
+  }
+};
+
+// return type R if T_array is SArray1D or SArray2D
+template <class T_array, class R = T_array>
+using SArrayEnable =
+  typename std::enable_if<SArrayTraits<T_array>::is_sarray, R>::type;
+//@}
+
+/// @name elementwise arithmetic operators
+//@{
+template <class A>
+INLINE SArrayEnable<A> operator-(const A &a)
+{
+  typedef SArrayTraits<A> S;
+  A c;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(c,i) = -S::at(a,i); });
+  return c;
+}
+
+template <class A>
+INLINE SArrayEnable<A> operator+(const A &a, const A &b)
+{
+  typedef SArrayTraits<A> S;
+  A c;
+  loopnest::static_for<0,A::size>([&](int i)
+                                 {
+                                   S::at(c,i) = S::at(a,i) + S::at(b,i);
+                                 });
+  return c;
+}
+
+template <class A>
+INLINE SArrayEnable<A> operator-(const A &a, const A &b)
+{
+  typedef SArrayTraits<A> S;
+  A c;
+  loopnest::static_for<0,A::size>([&](int i)
+                                 {
+                                   S::at(c,i) = S::at(a,i) - S::at(b,i);
+                                 });
+  return c;
+}
+
+template <class A>
+INLINE SArrayEnable<A> operator*(const typename A::value_type s, const A &a)
+{
+  typedef SArrayTraits<A> S;
+  A c;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(c,i) = s*S::at(a,i); });
+  return c;
+}
+
+template <class A>
+INLINE SArrayEnable<A> operator*(const A &a, const typename A::value_type s)
+{
+  return s*a;
+}
+
+template <class A>
+INLINE SArrayEnable<A> operator/(const A &a, const typename A::value_type s)
+{
+  typedef SArrayTraits<A> S;
+  A c;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(c,i) = S::at(a,i)/s; });
+  return c;
+}
+
+template <class A>
+INLINE SArrayEnable<A,A&> operator+=(A &a, const A &b)
+{
+  typedef SArrayTraits<A> S;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(a,i) += S::at(b,i); });
+  return a;
+}
+
+template <class A>
+INLINE SArrayEnable<A,A&> operator-=(A &a, const A &b)
+{
+  typedef SArrayTraits<A> S;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(a,i) -= S::at(b,i); });
+  return a;
+}
+
+template <class A>
+INLINE SArrayEnable<A,A&> operator*=(A &a, const typename A::value_type s)
+{
+  typedef SArrayTraits<A> S;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(a,i) *= s; });
+  return a;
+}
+
+template <class A>
+INLINE SArrayEnable<A,A&> operator/=(A &a, const typename A::value_type s)
+{
+  typedef SArrayTraits<A> S;
+  loopnest::static_for<0,A::size>([&](int i) { S::at(a,i) /= s; });
+  return a;
+}
+//@}
+
+/// @name vector operations
+//@{
+/// return dot product
+template <class T, size_t N0>
+INLINE T dot(const SArray1D<T,N0> &a, const SArray1D<T,N0> &b)
+{
+  T s = 0;
+  loopnest::static_for<0,N0>([&](int i) { s += a.data[i]*b.data[i]; });
+  return s;
+}
+
+/// return Euclidean norm
+template <class T, size_t N0>
+INLINE T norm(const SArray1D<T,N0> &a)
+{
+  return std::sqrt(dot(a, a));
+}
+
+/// return cross product of 3-vectors
+template <class T>
+INLINE SArray1D<T,3> cross(const SArray1D<T,3> &a, const SArray1D<T,3> &b)
+{
+  SArray1D<T,3> c = {{
+      a.data[1]*b.data[2] - a.data[2]*b.data[1],
+      a.data[2]*b.data[0] - a.data[0]*b.data[2],
+      a.data[0]*b.data[1] - a.data[1]*b.data[0]
+    }};
+  return c;
+}
+
+/// return outer product
+template <class T, size_t N0, size_t N1>
+INLINE SArray2D<T,N0,N1> outer(const SArray1D<T,N0> &a,
+                               const SArray1D<T,N1> &b)
+{
+  SArray2D<T,N0,N1> c;
+  loopnest::static_for<0,N0>([&](int i) {
+      loopnest::static_for<0,N1>([&](int j) {
+          c.data[i][j] = a.data[i]*b.data[j];
+        });
+    });
+  return c;
+}
+//@}
+
+/// @name matrix operations
+//@{
+/// return matrix-vector product
+template <class T, size_t N0, size_t N1>
+INLINE SArray1D<T,N0> matvec(const SArray2D<T,N0,N1> &a,
+                             const SArray1D<T,N1> &x)
+{
+  SArray1D<T,N0> y;
+  loopnest::static_for<0,N0>([&](int i) {
+      y.data[i] = 0;
+      loopnest::static_for<0,N1>([&](int j) {
+          y.data[i] += a.data[i][j]*x.data[j];
+        });
+    });
+  return y;
+}
+
+/// return matrix-matrix product
+template <class T, size_t N0, size_t N1, size_t N2>
+INLINE SArray2D<T,N0,N2> matmul(const SArray2D<T,N0,N1> &a,
+                                const SArray2D<T,N1,N2> &b)
+{
+  SArray2D<T,N0,N2> c;
+  loopnest::static_for<0,N0>([&](int i) {
+      loopnest::static_for<0,N2>([&](int j) {
+          c.data[i][j] = 0;
+          loopnest::static_for<0,N1>([&](int k) {
+              c.data[i][j] += a.data[i][k]*b.data[k][j];
+            });
+        });
+    });
+  return c;
+}
+
+/// return transposed matrix
+template <class T, size_t N0, size_t N1>
+INLINE SArray2D<T,N1,N0> transpose(const SArray2D<T,N0,N1> &a)
+{
+  SArray2D<T,N1,N0> c;
+  loopnest::static_for<0,N0>([&](int i) {
+      loopnest::static_for<0,N1>([&](int j) {
+          c.data[j][i] = a.data[i][j];
+        });
+    });
+  return c;
+}
+
+/// return trace
+template <class T, size_t N0>
+INLINE T trace(const SArray2D<T,N0,N0> &a)
+{
+  T s = 0;
+  loopnest::static_for<0,N0>([&](int i) { s += a.data[i][i]; });
+  return s;
+}
+
+/// return determinant of 2x2 matrix
+template <class T>
+INLINE T det(const SArray2D<T,2,2> &a)
+{
+  return a.data[0][0]*a.data[1][1] - a.data[0][1]*a.data[1][0];
+}
+
+/// return determinant of 3x3 matrix
+template <class T>
+INLINE T det(const SArray2D<T,3,3> &a)
+{
+  return
+    a.data[0][0]*(a.data[1][1]*a.data[2][2] - a.data[1][2]*a.data[2][1]) +
+    a.data[0][1]*(a.data[1][2]*a.data[2][0] - a.data[1][0]*a.data[2][2]) +
+    a.data[0][2]*(a.data[1][0]*a.data[2][1] - a.data[1][1]*a.data[2][0]);
+}
+
+/// return inverse of 2x2 matrix (not checked for singularity)
+template <class T>
+INLINE SArray2D<T,2,2> inverse(const SArray2D<T,2,2> &a)
+{
+  const T r = 1/det(a);
+  SArray2D<T,2,2> c = {{
+      { +r*a.data[1][1], -r*a.data[0][1] },
+      { -r*a.data[1][0], +r*a.data[0][0] }
+    }};
+  return c;
+}
+
+/// return inverse of 3x3 matrix (not checked for singularity)
+template <class T>
+INLINE SArray2D<T,3,3> inverse(const SArray2D<T,3,3> &a)
+{
+  SArray2D<T,3,3> c;
+
+  // cofactors
+  c.data[0][0] = a.data[1][1]*a.data[2][2] - a.data[1][2]*a.data[2][1];
+  c.data[0][1] = a.data[0][2]*a.data[2][1] - a.data[0][1]*a.data[2][2];
+  c.data[0][2] = a.data[0][1]*a.data[1][2] - a.data[0][2]*a.data[1][1];
+  c.data[1][0] = a.data[1][2]*a.data[2][0] - a.data[1][0]*a.data[2][2];
+  c.data[1][1] = a.data[0][0]*a.data[2][2] - a.data[0][2]*a.data[2][0];
+  c.data[1][2] = a.data[0][2]*a.data[1][0] - a.data[0][0]*a.data[1][2];
+  c.data[2][0] = a.data[1][0]*a.data[2][1] - a.data[1][1]*a.data[2][0];
+  c.data[2][1] = a.data[0][1]*a.data[2][0] - a.data[0][0]*a.data[2][1];
+  c.data[2][2] = a.data[0][0]*a.data[1][1] - a.data[0][1]*a.data[1][0];
+
+  // determinant by expansion along the first column
+  const T r = 1/(a.data[0][0]*c.data[0][0] +
+                 a.data[1][0]*c.data[0][1] +
+                 a.data[2][0]*c.data[0][2]);
+
+  return r*c;
+}
+//@}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
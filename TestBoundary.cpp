@@ -0,0 +1,229 @@
+// -*- C++ -*-
+
+///
+/// @file TestBoundary.cpp
+/// @brief Test code for physical boundary conditions
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "boundary.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+enum { PERIODIC = 0, REFLECT, ZEROGRAD, EXTRAP, DIRICHLET, NEUMANN, NOP };
+
+const double sign[3] = {-1.0, 1.0, 0.5};
+const double value   = 0.3;
+const double flux    = 2.0;
+const double spacing = 0.1;
+
+// apply boundary operator of type op
+template <int R>
+void apply(NArray<double,R> &x, const int axis, const int side, const int nb,
+           const int op, const int comp_axis)
+{
+  using namespace boundary;
+
+  switch( op ) {
+  case PERIODIC:
+    apply(x, axis, side, nb, Periodic());
+    break;
+  case REFLECT:
+    if( comp_axis < 0 ) {
+      apply(x, axis, side, nb, Reflect<double>(sign[0]));
+    } else {
+      apply(x, axis, side, nb, Reflect<double>(sign, 3, comp_axis));
+    }
+    break;
+  case ZEROGRAD:
+    apply(x, axis, side, nb, ZeroGradient());
+    break;
+  case EXTRAP:
+    apply(x, axis, side, nb, Extrapolate());
+    break;
+  case DIRICHLET:
+    apply(x, axis, side, nb, Dirichlet<double>(value));
+    break;
+  case NEUMANN:
+    apply(x, axis, side, nb, Neumann<double>(flux, spacing));
+    break;
+  }
+}
+
+// scalar reference on [n0][n1][n2] (no components if comp_axis < 0)
+template <int R>
+void reference(NArray<double,R> &x, const int axis, const int side,
+               const int nb, const int op, const int comp_axis)
+{
+  int64 n0 = 1, n2 = 1;
+  const int64 n1 = x.shape[axis];
+  for(int d=0; d < axis ;d++) n0 *= x.shape[d];
+  for(int d=axis+1; d < R ;d++) n2 *= x.shape[d];
+
+  for(int64 i0=0; i0 < n0 ;i0++) {
+    for(int64 i2=0; i2 < n2 ;i2++) {
+      // multi-dimensional index of component
+      int64 index[R];
+      int64 flat = (i0*n1 + nb)*n2 + i2;
+      for(int d=R-1; d >= 0 ;d--) {
+        index[d] = flat % x.shape[d];
+        flat /= x.shape[d];
+      }
+      const double s = (comp_axis < 0) ? sign[0] : sign[index[comp_axis]];
+
+      for(int g=1; g <= nb ;g++) {
+        // interior cell at distance d from the face
+        int64 ig, im, i0c, i1c, ip;
+        if( side == boundary::LOWER ) {
+          ig  = nb - g;
+          im  = nb + g - 1;
+          i0c = nb;
+          i1c = nb + 1;
+          ip  = n1 - nb - g;
+        } else {
+          ig  = n1 - nb - 1 + g;
+          im  = n1 - nb - g;
+          i0c = n1 - nb - 1;
+          i1c = n1 - nb - 2;
+          ip  = nb + g - 1;
+        }
+        double *p = &x.data[i0*n1*n2 + i2];
+        double &v = p[ig*n2];
+        switch( op ) {
+        case PERIODIC:
+          v = p[ip*n2];
+          break;
+        case REFLECT:
+          v = s * p[im*n2];
+          break;
+        case ZEROGRAD:
+          v = p[i0c*n2];
+          break;
+        case EXTRAP:
+          v = (g+1)*p[i0c*n2] - g*p[i1c*n2];
+          break;
+        case DIRICHLET:
+          v = 2*value - p[im*n2];
+          break;
+        case NEUMANN:
+          v = p[im*n2] + (2*g-1)*flux*spacing;
+          break;
+        }
+      }
+    }
+  }
+}
+
+// maximum difference from reference for all faces and operators
+template <int R>
+double check(NArray<double,R> &x, NArray<double,R> &y, const int nb,
+             const int comp_axis)
+{
+  double err = 0;
+
+  for(int axis=0; axis < R ;axis++) {
+    if( axis == comp_axis ) continue;
+    for(int side=0; side < 2 ;side++) {
+      for(int op=0; op < NOP ;op++) {
+        for(uint64 i=0; i < x.getSize() ;i++) {
+          x.data[i] = 2*mt.rand() - 1;
+          y.data[i] = x.data[i];
+        }
+        apply(x, axis, side, nb, op, comp_axis);
+        reference(y, axis, side, nb, op, comp_axis);
+        for(uint64 i=0; i < x.getSize() ;i++) {
+          err = max(err, abs(x.data[i] - y.data[i]));
+        }
+      }
+    }
+  }
+
+  return err;
+}
+
+int main()
+{
+  { // accuracy
+    cout << "----- accuracy -----" << endl;
+
+    const int nb = 2;
+    bool status = true;
+
+    {
+      NArray<double,3> x(8+2*nb, 6+2*nb, 7+2*nb);
+      NArray<double,3> y(8+2*nb, 6+2*nb, 7+2*nb);
+      double err = check(x, y, nb, -1);
+      cout << boost::format("rank 3 : error = %10.3e\n") % err;
+      status &= err < 1.0e-15;
+    }
+
+    {
+      // components in the last index
+      NArray<double,4> x(5+2*nb, 6+2*nb, 4+2*nb, 3);
+      NArray<double,4> y(5+2*nb, 6+2*nb, 4+2*nb, 3);
+      double err = check(x, y, nb, 3);
+      cout << boost::format("rank 4 (components last)  : error = %10.3e\n")
+        % err;
+      status &= err < 1.0e-15;
+    }
+
+    {
+      // components in the first index
+      NArray<double,4> x(3, 5+2*nb, 6+2*nb, 4+2*nb);
+      NArray<double,4> y(3, 5+2*nb, 6+2*nb, 4+2*nb);
+      double err = check(x, y, nb, 0);
+      cout << boost::format("rank 4 (components first) : error = %10.3e\n")
+        % err;
+      status &= err < 1.0e-15;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 256;
+    const int nb = 3;
+    const int nloop = 10;
+    NArray<double,3> x(N+2*nb, N+2*nb, N+2*nb);
+    for(uint64 i=0; i < x.getSize() ;i++) {
+      x.data[i] = mt.rand();
+    }
+
+    for(int axis=0; axis < 3 ;axis++) {
+      double t0 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        reference(x, axis, boundary::LOWER, nb, EXTRAP, -1);
+        reference(x, axis, boundary::UPPER, nb, EXTRAP, -1);
+      }
+      double t1 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        boundary::apply(x, axis, boundary::LOWER, nb, boundary::Extrapolate());
+        boundary::apply(x, axis, boundary::UPPER, nb, boundary::Extrapolate());
+      }
+      double t2 = common::etime();
+
+      cout << boost::format("axis = %d : scalar %8.5f [sec], "
+                            "apply %8.5f [sec]\n")
+        % axis % (t1 - t0) % (t2 - t1);
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,118 @@
+// -*- C++ -*-
+
+///
+/// @file TestFDWeights.cpp
+/// @brief Test code for compile-time finite difference weights
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "fdweights.hpp"
+
+using namespace std;
+using namespace fdweights;
+
+// approximate equality at compile time
+constexpr bool is_close(const double a, const double b)
+{
+  return (a - b < 1.0e-14) && (b - a < 1.0e-14);
+}
+
+// weights are compile-time constants
+static_assert(Centered<1,2>::size == 3, "Centered<1,2>::size");
+static_assert(is_close(Centered<1,2>::weight(0), -0.5) &&
+              is_close(Centered<1,2>::weight(1),  0.0) &&
+              is_close(Centered<1,2>::weight(2), +0.5), "Centered<1,2>");
+static_assert(is_close(Centered<2,2>::weight(0), +1.0) &&
+              is_close(Centered<2,2>::weight(1), -2.0) &&
+              is_close(Centered<2,2>::weight(2), +1.0), "Centered<2,2>");
+static_assert(Centered<1,4>::size == 5, "Centered<1,4>::size");
+static_assert(is_close(Centered<1,4>::weight(0), +1.0/12) &&
+              is_close(Centered<1,4>::weight(1), -8.0/12) &&
+              is_close(Centered<1,4>::weight(3), +8.0/12) &&
+              is_close(Centered<1,4>::weight(4), -1.0/12), "Centered<1,4>");
+static_assert(Staggered<0,4>::size == 4, "Staggered<0,4>::size");
+static_assert(is_close(Staggered<0,4>::weight(0), -1.0/16) &&
+              is_close(Staggered<0,4>::weight(1), +9.0/16) &&
+              is_close(Staggered<0,4>::weight(2), +9.0/16) &&
+              is_close(Staggered<0,4>::weight(3), -1.0/16), "Staggered<0,4>");
+static_assert(is_close(Staggered<1,4>::weight(0), +1.0/24) &&
+              is_close(Staggered<1,4>::weight(1), -27.0/24) &&
+              is_close(Staggered<1,4>::weight(2), +27.0/24) &&
+              is_close(Staggered<1,4>::weight(3), -1.0/24), "Staggered<1,4>");
+static_assert(is_close(Forward<1,2>::weight(0), -1.5) &&
+              is_close(Forward<1,2>::weight(1), +2.0) &&
+              is_close(Forward<1,2>::weight(2), -0.5), "Forward<1,2>");
+static_assert(is_close(Backward<1,2>::weight(0), +0.5) &&
+              is_close(Backward<1,2>::weight(1), -2.0) &&
+              is_close(Backward<1,2>::weight(2), +1.5), "Backward<1,2>");
+
+// maximum error of stencil S applied to sin(x) (exact result sin(x+phase))
+template <class S>
+double error(const int N, const double exact_phase)
+{
+  const double h = 2*M_PI/N;
+
+  vector<double> f(N + 16);
+  double *g = &f[8];
+  for(int i=-8; i < N+8 ;i++) {
+    g[i] = sin(i*h);
+  }
+
+  double err = 0;
+  for(int i=0; i < N ;i++) {
+    double df = S::apply(&g[i]) / pow(h, S::order);
+    err = max(err, abs(df - sin(i*h + exact_phase)));
+  }
+  return err;
+}
+
+template <class S>
+bool check(const char *name, const double shift, const int order)
+{
+  const double phase = 0.5*M_PI*S::order;
+  double e1 = error<S>(32, phase + shift*2*M_PI/32);
+  double e2 = error<S>(64, phase + shift*2*M_PI/64);
+  double rate = log2(e1/e2);
+
+  cout << boost::format("%-16s : error = %12.5e, %12.5e (rate = %5.2f)\n")
+    % name % e1 % e2 % rate;
+
+  return rate > order - 0.2;
+}
+
+int main()
+{
+  cout << "----- convergence -----" << endl;
+
+  bool status = true;
+  status &= check< Centered<1,2> >("Centered<1,2>", 0.0, 2);
+  status &= check< Centered<1,4> >("Centered<1,4>", 0.0, 4);
+  status &= check< Centered<1,6> >("Centered<1,6>", 0.0, 6);
+  status &= check< Centered<2,4> >("Centered<2,4>", 0.0, 4);
+  status &= check< Staggered<0,4> >("Staggered<0,4>", 0.5, 4);
+  status &= check< Staggered<1,6> >("Staggered<1,6>", 0.5, 6);
+  status &= check< Forward<1,3> >("Forward<1,3>", 0.0, 3);
+  status &= check< Backward<1,3> >("Backward<1,3>", 0.0, 3);
+
+  // run-time use with arbitrary points
+  SArray1D<double,3> x = {{ -1.0, 0.0, 2.0 }};
+  SArray1D<double,3> w = fornberg<1,3>(x, 0.0);
+  double sum = w(0) + w(1) + w(2);
+  double mom = -w(0) + 2*w(2);
+  if( abs(sum) > 1.0e-14 || abs(mom - 1) > 1.0e-14 ) status = false;
+
+  if( status ) {
+    cout << "===> works fine !" << endl;
+  } else {
+    cout << "===> does not work !" << endl;
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,251 @@
+// -*- C++ -*-
+
+///
+/// @file TestFFT.cpp
+/// @brief Test code for batched mixed-radix FFT
+///
+/// $Id$
+///
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "fft.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+typedef complex<double> Complex;
+static MersenneTwister mt;
+
+// naive DFT of a strided line
+void dft_ref(const Complex *x, Complex *y, const int n, const int stride,
+             const int sign)
+{
+  for(int k=0; k < n ;k++) {
+    Complex sum = 0;
+    for(int j=0; j < n ;j++) {
+      sum += x[j*stride] * polar(1.0, sign*2*M_PI*((int64)j*k % n)/n);
+    }
+    y[k*stride] = sum;
+  }
+}
+
+// scalar radix-2 FFT of a strided line with bit reversal
+void fft_ref(Complex *x, const int n, const int stride)
+{
+  for(int i=1, j=0; i < n ;i++) {
+    int bit = n >> 1;
+    for(; j & bit ; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if( i < j ) swap(x[i*stride], x[j*stride]);
+  }
+  for(int len=2; len <= n ;len <<= 1) {
+    const Complex wl = polar(1.0, -2*M_PI/len);
+    for(int i=0; i < n ;i+=len) {
+      Complex w = 1;
+      for(int j=0; j < len/2 ;j++) {
+        Complex u = x[(i+j)*stride];
+        Complex v = x[(i+j+len/2)*stride] * w;
+        x[(i+j)*stride]       = u + v;
+        x[(i+j+len/2)*stride] = u - v;
+        w *= wl;
+      }
+    }
+  }
+}
+
+// maximum error of c2c and r2c/c2r along axis against naive DFT
+double check(const int axis, const int n)
+{
+  int shape[3] = {3, 5, 7};
+  shape[axis] = n;
+  const int N1 = shape[0];
+  const int N2 = shape[1];
+  const int N3 = shape[2];
+  const int stride = (axis == 0) ? N2*N3 : (axis == 1) ? N3 : 1;
+  const int nl = N1*N2*N3/n;
+
+  NArray<Complex,3> x(N1, N2, N3);
+  NArray<Complex,3> y(N1, N2, N3);
+  NArray<Complex,3> z(N1, N2, N3);
+  for(int i=0; i < N1*N2*N3 ;i++) {
+    x.data[i] = Complex(2*mt.rand()-1, 2*mt.rand()-1);
+    y.data[i] = x.data[i];
+  }
+
+  // index of first element of line l
+  vector<int> head;
+  for(int i=0; i < N1*N2*N3 ;i++) {
+    const int e = (i / stride) % n;
+    if( e == 0 ) head.push_back(i);
+  }
+
+  double err = 0;
+
+  // complex forward and backward
+  fft::c2c(y, axis, fft::FORWARD);
+  for(int l=0; l < nl ;l++) {
+    dft_ref(&x.data[head[l]], &z.data[head[l]], n, stride, -1);
+  }
+  for(int l=0; l < nl ;l++) {
+    for(int k=0; k < n ;k++) {
+      const int p = head[l] + k*stride;
+      err = max(err, abs(y.data[p] - z.data[p]) / n);
+    }
+  }
+  fft::c2c(y, axis, fft::BACKWARD);
+  for(int i=0; i < N1*N2*N3 ;i++) {
+    err = max(err, abs(y.data[i]/(double)n - x.data[i]));
+  }
+
+  // real to complex and back
+  int cshape[3] = {N1, N2, N3};
+  cshape[axis] = n/2 + 1;
+  NArray<double,3>  r(N1, N2, N3);
+  NArray<double,3>  s(N1, N2, N3);
+  NArray<Complex,3> c(cshape[0], cshape[1], cshape[2]);
+  for(int i=0; i < N1*N2*N3 ;i++) {
+    r.data[i] = x.data[i].real();
+    x.data[i] = r.data[i];
+  }
+  for(int l=0; l < nl ;l++) {
+    dft_ref(&x.data[head[l]], &z.data[head[l]], n, stride, -1);
+  }
+  fft::r2c(r, c, axis);
+  for(int i=0; i < N1 ;i++) {
+    for(int j=0; j < N2 ;j++) {
+      for(int k=0; k < N3 ;k++) {
+        const int p = (axis == 0) ? i : (axis == 1) ? j : k;
+        if( p > n/2 ) continue;
+        const int ic = (axis == 0) ? p : i;
+        const int jc = (axis == 1) ? p : j;
+        const int kc = (axis == 2) ? p : k;
+        err = max(err, abs(c(ic,jc,kc) - z(i,j,k)) / n);
+      }
+    }
+  }
+  fft::c2r(c, s, axis);
+  for(int i=0; i < N1*N2*N3 ;i++) {
+    err = max(err, abs(s.data[i]/n - r.data[i]));
+  }
+
+  return err;
+}
+
+int main()
+{
+  { // accuracy
+    cout << "----- accuracy -----" << endl;
+
+    const int size[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 15, 16, 25, 30, 49,
+                        64, 77, 97, 120, 128, 243, 250};
+    const int nsize = sizeof(size)/sizeof(int);
+
+    bool status = true;
+    for(int axis=0; axis < 3 ;axis++) {
+      double err = 0;
+      for(int i=0; i < nsize ;i++) {
+        err = max(err, check(axis, size[i]));
+      }
+      cout << boost::format("axis = %d : error = %10.3e\n") % axis % err;
+      status &= err < 1.0e-13;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // single precision
+    cout << "----- float -----" << endl;
+
+    // a single mode transformed into a delta
+    const int N1 = 60;
+    const int N2 = 40;
+    NArray<complex<float>,2> x(N1, N2);
+
+    bool status = true;
+    for(int axis=0; axis < 2 ;axis++) {
+      const int n = x.shape[axis];
+      for(int i=0; i < N1 ;i++) {
+        for(int j=0; j < N2 ;j++) {
+          const int p = (axis == 0) ? i : j;
+          x(i,j) = polar(1.0f, static_cast<float>(2*M_PI*3*p/n));
+        }
+      }
+      fft::c2c(x, axis, fft::FORWARD);
+      for(int i=0; i < N1 ;i++) {
+        for(int j=0; j < N2 ;j++) {
+          const int p = (axis == 0) ? i : j;
+          const float expect = (p == 3) ? n : 0;
+          if( abs(x(i,j) - expect) > 1.0e-4*n ) status = false;
+        }
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 128;
+    const int nloop = 10;
+
+    NArray<Complex,3> x(N, N, N);
+    NArray<double,3>  r(N, N, N);
+    NArray<Complex,3> c(N, N, N/2+1);
+    for(int i=0; i < N*N*N ;i++) {
+      x.data[i] = Complex(mt.rand(), mt.rand());
+      r.data[i] = mt.rand();
+    }
+
+    for(int axis=0; axis < 3 ;axis++) {
+      const int stride = (axis == 0) ? N*N : (axis == 1) ? N : 1;
+      double t0, t1, t2;
+
+      // one line at a time
+      t0 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        for(int i=0; i < N ;i++) {
+          for(int j=0; j < N ;j++) {
+            int ip = (axis == 0) ? i*N + j : (axis == 1) ? i*N*N + j :
+              (i*N + j)*N;
+            fft_ref(&x.data[ip], N, stride);
+          }
+        }
+      }
+      t1 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        fft::c2c(x, axis, fft::FORWARD);
+      }
+      t2 = common::etime();
+
+      cout << boost::format("axis = %d : line by line %8.5f [sec], "
+                            "batched %8.5f [sec]\n")
+        % axis % (t1 - t0) % (t2 - t1);
+    }
+
+    double t0 = common::etime();
+    for(int n=0; n < nloop ;n++) {
+      fft::r2c(r, c, 2);
+    }
+    double t1 = common::etime();
+    cout << boost::format("r2c along last axis : %8.5f [sec]\n") % (t1 - t0);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,253 @@
+// -*- C++ -*-
+
+///
+/// @file TestFastMath.cpp
+/// @brief Test code for vectorizable elementary functions
+///
+/// $Id$
+///
+#include <cmath>
+#include <limits>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "fastmath.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+enum { EXP = 0, LOG, POW, SIN, COS, RSQRT, ERF, NFUNC };
+
+const char *name[NFUNC] = {"exp", "log", "pow", "sin", "cos", "rsqrt", "erf"};
+
+// test arguments for each function
+void arguments(const int func, NArray<double,1> &x, NArray<double,1> &y)
+{
+  const int n = x.shape[0];
+
+  for(int i=0; i < n ;i++) {
+    const double u = mt.rand();
+    const double v = mt.rand();
+    switch( func ) {
+    case EXP:
+      x(i) = 1400*u - 700;
+      break;
+    case LOG:
+    case RSQRT:
+      // log-uniform in [1e-300, 1e+300]
+      x(i) = std::pow(10.0, 600*u - 300);
+      break;
+    case POW:
+      x(i) = std::pow(10.0, 20*u - 10);
+      y(i) = 20*v - 10;
+      break;
+    case SIN:
+    case COS:
+      x(i) = 200*u - 100;
+      break;
+    case ERF:
+      x(i) = 14*u - 7;
+      break;
+    }
+  }
+}
+
+// reference by libm
+void reference(const int func, NArray<double,1> &x, NArray<double,1> &y,
+               NArray<double,1> &z)
+{
+  const int n = x.shape[0];
+
+  for(int i=0; i < n ;i++) {
+    switch( func ) {
+    case EXP:
+      z(i) = std::exp(x(i));
+      break;
+    case LOG:
+      z(i) = std::log(x(i));
+      break;
+    case POW:
+      z(i) = std::pow(x(i), y(i));
+      break;
+    case SIN:
+      z(i) = std::sin(x(i));
+      break;
+    case COS:
+      z(i) = std::cos(x(i));
+      break;
+    case RSQRT:
+      z(i) = 1/std::sqrt(x(i));
+      break;
+    case ERF:
+      z(i) = std::erf(x(i));
+      break;
+    }
+  }
+}
+
+// batch version of fastmath
+template <int A>
+void approximate(const int func, NArray<double,1> &x, NArray<double,1> &y,
+                 NArray<double,1> &z, NArray<double,1> &w)
+{
+  switch( func ) {
+  case EXP:
+    fastmath::exp<A>(x, z);
+    break;
+  case LOG:
+    fastmath::log<A>(x, z);
+    break;
+  case POW:
+    fastmath::pow<A>(x, y, z);
+    break;
+  case SIN:
+    fastmath::sincos<A>(x, z, w);
+    break;
+  case COS:
+    fastmath::sincos<A>(x, w, z);
+    break;
+  case RSQRT:
+    fastmath::rsqrt<A>(x, z);
+    break;
+  case ERF:
+    fastmath::erf<A>(x, z);
+    break;
+  }
+}
+
+// maximum relative error (absolute error for sin and cos)
+double error(const int func, NArray<double,1> &z, NArray<double,1> &r)
+{
+  const int n = z.shape[0];
+  double err = 0;
+
+  for(int i=0; i < n ;i++) {
+    const double e = abs(z(i) - r(i));
+    if( func == SIN || func == COS ) {
+      err = max(err, e);
+    } else {
+      err = max(err, e/abs(r(i)));
+    }
+  }
+
+  return err;
+}
+
+// check special values
+bool special()
+{
+  using namespace fastmath;
+  const double inf = numeric_limits<double>::infinity();
+  const double nan = numeric_limits<double>::quiet_NaN();
+  const double tiny = 1.0e-310; // subnormal
+
+  bool status = true;
+  status &= exp<FULL>(-inf) == 0 && exp<FULL>(inf) == inf;
+  status &= exp<FULL>(800.0) == inf && exp<FULL>(-800.0) == 0;
+  status &= std::isnan(exp<FULL>(nan));
+  status &= log<FULL>(0.0) == -inf && log<FULL>(inf) == inf;
+  status &= std::isnan(log<FULL>(-1.0)) && std::isnan(log<FULL>(nan));
+  status &= abs(log<FULL>(tiny) - std::log(tiny)) < 1.0e-14*abs(log(tiny));
+  status &= abs(exp<FULL>(-740.0) - std::exp(-740.0)) < 1.0e-320;
+  status &= erf<FULL>(10.0) == 1 && erf<FULL>(-inf) == -1;
+  status &= std::isnan(erf<FULL>(nan));
+  status &= std::isnan(fastmath::sin<FULL>(nan));
+  status &= pow<FULL>(0.0, 0.0) == 1 && pow<FULL>(inf, 0.0) == 1;
+  status &= pow<MEDIUM>(0.0, 0.0) == 1 && pow<LOW>(inf, 0.0) == 1;
+  status &= pow<FULL>(0.0, 2.0) == 0 && pow<FULL>(inf, 2.0) == inf;
+  status &= pow<FULL>(0.0, -2.0) == inf && pow<FULL>(inf, -2.0) == 0;
+
+  return status;
+}
+
+int main()
+{
+  const int N = 1 << 20;
+  NArray<double,1> x(N), y(N), z(N), w(N), r(N);
+
+  { // accuracy
+    cout << "----- accuracy -----" << endl;
+
+    // expected error for FULL, MEDIUM and LOW (MEDIUM and LOW of pow are
+    // amplified by y log x)
+    const double tol[NFUNC][3] = {
+      {1.0e-15, 1.0e-7, 1.0e-4}, // exp
+      {1.0e-15, 1.0e-7, 1.0e-4}, // log
+      {2.0e-15, 1.0e-6, 1.0e-3}, // pow
+      {1.0e-15, 1.0e-7, 1.0e-4}, // sin
+      {1.0e-15, 1.0e-7, 1.0e-4}, // cos
+      {1.0e-15, 1.0e-7, 1.0e-4}, // rsqrt
+      {1.0e-15, 1.0e-7, 1.0e-4}, // erf
+    };
+
+    bool status = special();
+    cout << boost::format("special values : %s\n")
+      % (status ? "ok" : "wrong");
+
+    for(int func=0; func < NFUNC ;func++) {
+      double err[3];
+      arguments(func, x, y);
+      reference(func, x, y, r);
+      approximate<fastmath::FULL>(func, x, y, z, w);
+      err[0] = error(func, z, r);
+      approximate<fastmath::MEDIUM>(func, x, y, z, w);
+      err[1] = error(func, z, r);
+      approximate<fastmath::LOW>(func, x, y, z, w);
+      err[2] = error(func, z, r);
+
+      cout << boost::format("%-5s : full %10.3e, medium %10.3e, low %10.3e\n")
+        % name[func] % err[0] % err[1] % err[2];
+      for(int a=0; a < 3 ;a++) {
+        status &= err[a] < tol[func][a];
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int nloop = 10;
+
+    for(int func=0; func < NFUNC ;func++) {
+      arguments(func, x, y);
+
+      double t[4];
+      t[0] = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        reference(func, x, y, z);
+      }
+      t[1] = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        approximate<fastmath::FULL>(func, x, y, z, w);
+      }
+      t[2] = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        approximate<fastmath::MEDIUM>(func, x, y, z, w);
+      }
+      t[3] = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        approximate<fastmath::LOW>(func, x, y, z, w);
+      }
+      const double t4 = common::etime();
+
+      cout << boost::format("%-5s : libm %8.5f, full %8.5f, medium %8.5f, "
+                            "low %8.5f [sec]\n")
+        % name[func] % (t[1] - t[0]) % (t[2] - t[1]) % (t[3] - t[2])
+        % (t4 - t[3]);
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
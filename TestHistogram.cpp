@@ -0,0 +1,142 @@
+// -*- C++ -*-
+
+///
+/// @file TestHistogram.cpp
+/// @brief Test code for parallel histogram
+///
+/// $Id$
+///
+#include <cmath>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "histogram.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// serial reference bin index (-1 for outside)
+int bin_ref(const double x, const int nbin, const double xmin,
+            const double xmax)
+{
+  if( !(x >= xmin && x < xmax) ) return -1;
+  return min(nbin-1, static_cast<int>((x - xmin)*nbin/(xmax - xmin)));
+}
+
+int main()
+{
+  { // accuracy
+    cout << "----- accuracy -----" << endl;
+
+    const int NP = 100003;
+    const int NC = 4;
+    const int NX = 37;
+    const int NY = 5000;
+
+    // particles [np][nc] with a few values outside and NaN
+    NArray<double,2> p(NP, NC);
+    for(int i=0; i < NP ;i++) {
+      p(i,0) = mt.normal();
+      p(i,1) = 3*mt.rand() - 1;
+      p(i,2) = mt.rand();
+      p(i,3) = (i % 1001 == 0) ? NAN : mt.normal(0.5);
+    }
+
+    histogram::Hist1D<double> h1(NX, -2.0, 2.0);
+    histogram::Hist1D<double> w1(NX, -2.0, 2.0);
+    histogram::Hist2D<double> h2(NX, -2.0, 2.0, NY, -1.0, 1.0);
+    histogram::Hist2D<double> w2(NX, -2.0, 2.0, NY, -1.0, 1.0);
+
+    // twice to check accumulation
+    for(int n=0; n < 2 ;n++) {
+      h1.fill(&p(0,0), NP, NC);
+      w1.fill(&p(0,1), &p(0,2), NP, NC);
+      h2.fill(&p(0,0), &p(0,3), NP, NC);
+      w2.fill(&p(0,0), &p(0,3), &p(0,2), NP, NC);
+    }
+
+    vector<double> r1(NX, 0), s1(NX, 0), r2(NX*NY, 0), s2(NX*NY, 0);
+    for(int i=0; i < NP ;i++) {
+      const int b0 = bin_ref(p(i,0), NX, -2.0, 2.0);
+      const int b1 = bin_ref(p(i,1), NX, -2.0, 2.0);
+      const int b3 = bin_ref(p(i,3), NY, -1.0, 1.0);
+      if( b0 >= 0 ) r1[b0] += 2;
+      if( b1 >= 0 ) s1[b1] += 2*p(i,2);
+      if( b0 >= 0 && b3 >= 0 ) {
+        r2[b0*NY + b3] += 2;
+        s2[b0*NY + b3] += 2*p(i,2);
+      }
+    }
+
+    double err = 0;
+    for(int i=0; i < NX ;i++) {
+      err = max(err, abs(h1(i) - r1[i]));
+      err = max(err, abs(w1(i) - s1[i]));
+      for(int j=0; j < NY ;j++) {
+        err = max(err, abs(h2(i,j) - r2[i*NY + j]));
+        err = max(err, abs(w2(i,j) - s2[i*NY + j]));
+      }
+    }
+    cout << boost::format("error = %10.3e, total = %8.0f %8.0f\n")
+      % err % h1.getTotal() % h2.getTotal();
+
+    // NArray input
+    NArray<float,3> d(20, 30, 40);
+    for(uint64 i=0; i < d.getSize() ;i++) {
+      d.data[i] = mt.rand();
+    }
+    histogram::Hist1D<float> h3(10, 0.0, 1.0);
+    h3.fill(d);
+
+    bool status = err < 1.0e-10 && h3.getTotal() == d.getSize();
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 1 << 24;
+    const int nloop = 5;
+    NArray<double,1> x(N);
+    for(int i=0; i < N ;i++) {
+      x(i) = mt.normal(0.1);
+    }
+
+    const int nbin[3] = {16, 256, 65536};
+    for(int k=0; k < 3 ;k++) {
+      histogram::Hist1D<double> h(nbin[k], -1.0, 1.0);
+      vector<double> r(nbin[k], 0);
+
+      double t0 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        for(int i=0; i < N ;i++) {
+          const int b = bin_ref(x(i), nbin[k], -1.0, 1.0);
+          if( b >= 0 ) r[b] += 1;
+        }
+      }
+      double t1 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        h.fill(x);
+      }
+      double t2 = common::etime();
+
+      cout << boost::format("nbin = %5d : serial %8.5f [sec], "
+                            "histogram %8.5f [sec]\n")
+        % nbin[k] % (t1 - t0) % (t2 - t1);
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
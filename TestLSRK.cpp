@@ -0,0 +1,277 @@
+// -*- C++ -*-
+
+///
+/// @file TestLSRK.cpp
+/// @brief Test code for low-storage Runge-Kutta time integrators
+///
+/// $Id$
+///
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "lsrk.hpp"
+
+using namespace std;
+typedef NArray<double,3> Array;
+typedef vector<Array*> Fields;
+
+// rotation (x' = -y, y' = x) and z' = cos(t) z
+struct Ode
+{
+  void operator()(const double t, Fields &u, Fields &du,
+                  const double a, const double b)
+  {
+    const int64 n = u[0]->getSize();
+    const double ct = cos(t);
+    for(int64 i=0; i < n ;i++) {
+      const double lx = -u[1]->data[i];
+      const double ly = +u[0]->data[i];
+      const double lz = ct * u[2]->data[i];
+      du[0]->data[i] = (a == 0 ? 0 : a*du[0]->data[i]) + b*lx;
+      du[1]->data[i] = (a == 0 ? 0 : a*du[1]->data[i]) + b*ly;
+      du[2]->data[i] = (a == 0 ? 0 : a*du[2]->data[i]) + b*lz;
+    }
+  }
+};
+
+// maximum error at t = 1 with nstep steps
+template <class Scheme>
+double solve_ode(Scheme &scheme, const int nstep)
+{
+  const int N = 4;
+  Array x(N, N, N), y(N, N, N), z(N, N, N);
+  Fields u;
+  u.push_back(&x);
+  u.push_back(&y);
+  u.push_back(&z);
+
+  const int64 n = x.getSize();
+  for(int64 i=0; i < n ;i++) {
+    x.data[i] = cos(0.1*i);
+    y.data[i] = sin(0.1*i);
+    z.data[i] = 1 + 0.01*i;
+  }
+
+  Ode ode;
+  const double dt = 1.0 / nstep;
+  for(int step=0; step < nstep ;step++) {
+    scheme.step(ode, u, step*dt, dt);
+  }
+
+  double err = 0;
+  for(int64 i=0; i < n ;i++) {
+    err = max(err, abs(x.data[i] - cos(0.1*i + 1)));
+    err = max(err, abs(y.data[i] - sin(0.1*i + 1)));
+    err = max(err, abs(z.data[i] - (1 + 0.01*i)*exp(sin(1.0))));
+  }
+  return err;
+}
+
+// observed order of accuracy
+template <class Scheme>
+double order(Scheme &scheme)
+{
+  const double e1 = solve_ode(scheme, 20);
+  const double e2 = solve_ode(scheme, 40);
+  return log(e1/e2) / log(2.0);
+}
+
+// periodic advection-diffusion with 7-point stencil
+struct AdvectionDiffusion
+{
+  double vx, vy, vz, nu;
+
+  void operator()(const double t, Fields &u, Fields &du,
+                  const double a, const double b)
+  {
+    for(size_t f=0; f < u.size() ;f++) {
+      Array &q = *u[f];
+      Array &d = *du[f];
+      const int N1 = q.shape[0];
+      const int N2 = q.shape[1];
+      const int N3 = q.shape[2];
+
+#pragma omp parallel for schedule(static)
+      for(int i=0; i < N1 ;i++) {
+        const int im = (i + N1 - 1) % N1;
+        const int ip = (i + 1) % N1;
+        for(int j=0; j < N2 ;j++) {
+          const int jm = (j + N2 - 1) % N2;
+          const int jp = (j + 1) % N2;
+          for(int k=0; k < N3 ;k++) {
+            const int km = (k + N3 - 1) % N3;
+            const int kp = (k + 1) % N3;
+            const double c = q(i,j,k);
+            const double l =
+              - 0.5*vx*(q(ip,j,k) - q(im,j,k))
+              - 0.5*vy*(q(i,jp,k) - q(i,jm,k))
+              - 0.5*vz*(q(i,j,kp) - q(i,j,km))
+              + nu*(q(ip,j,k) + q(im,j,k) + q(i,jp,k) + q(i,jm,k) +
+                    q(i,j,kp) + q(i,j,km) - 6*c);
+            d(i,j,k) = (a == 0 ? 0 : a*d(i,j,k)) + b*l;
+          }
+        }
+      }
+    }
+  }
+};
+
+// classical RK4 with a register for each stage
+class ClassicRK4
+{
+private:
+  vector< unique_ptr<Array> > m_k[4];
+  vector< unique_ptr<Array> > m_w;
+
+public:
+  template <class Rhs>
+  void step(Rhs &rhs, Fields &u, const double t, const double dt)
+  {
+    if( m_w.size() != u.size() ) {
+      for(size_t f=0; f < u.size() ;f++) {
+        for(int s=0; s < 4 ;s++) {
+          m_k[s].emplace_back(lsrk::create(*u[f]));
+        }
+        m_w.emplace_back(lsrk::create(*u[f]));
+      }
+    }
+
+    const double c[4] = {0.0, 0.5, 0.5, 1.0};
+    Fields k[4], w;
+    for(size_t f=0; f < u.size() ;f++) {
+      for(int s=0; s < 4 ;s++) {
+        k[s].push_back(m_k[s][f].get());
+      }
+      w.push_back(m_w[f].get());
+    }
+
+    for(int s=0; s < 4 ;s++) {
+      Fields &in = (s == 0) ? u : w;
+      rhs(t + c[s]*dt, in, k[s], 0.0, dt);
+      if( s == 3 ) break;
+      for(size_t f=0; f < u.size() ;f++) {
+        const int64 n = u[f]->getSize();
+#pragma omp parallel for simd schedule(static)
+        for(int64 i=0; i < n ;i++) {
+          w[f]->data[i] = u[f]->data[i] + c[s+1]*k[s][f]->data[i];
+        }
+      }
+    }
+    for(size_t f=0; f < u.size() ;f++) {
+      const int64 n = u[f]->getSize();
+#pragma omp parallel for simd schedule(static)
+      for(int64 i=0; i < n ;i++) {
+        u[f]->data[i] += (k[0][f]->data[i] + 2*k[1][f]->data[i] +
+                          2*k[2][f]->data[i] + k[3][f]->data[i]) / 6;
+      }
+    }
+  }
+};
+
+// elapsed time per step of a scheme for advection-diffusion
+template <class Scheme>
+double advance(Scheme &scheme, const int nstep, double &norm)
+{
+  const int N = 64;
+  const int NF = 3;
+  vector< unique_ptr<Array> > store;
+  Fields u;
+  for(int f=0; f < NF ;f++) {
+    store.emplace_back(new Array(N, N, N));
+    u.push_back(store.back().get());
+    for(int i=0; i < N ;i++) {
+      for(int j=0; j < N ;j++) {
+        for(int k=0; k < N ;k++) {
+          (*u[f])(i,j,k) = sin(2*M_PI*(i + (f+1)*j + k)/N);
+        }
+      }
+    }
+  }
+
+  AdvectionDiffusion rhs = {1.0, 0.5, 0.25, 0.05};
+  const double dt = 0.2;
+  scheme.step(rhs, u, 0.0, dt);
+
+  double t0 = common::etime();
+  for(int step=1; step <= nstep ;step++) {
+    scheme.step(rhs, u, step*dt, dt);
+  }
+  double t1 = common::etime();
+
+  norm = 0;
+  for(int f=0; f < NF ;f++) {
+    for(uint64 i=0; i < u[f]->getSize() ;i++) {
+      norm += u[f]->data[i] * u[f]->data[i];
+    }
+  }
+  return (t1 - t0) / nstep;
+}
+
+int main()
+{
+  { // order of accuracy
+    cout << "----- order of accuracy -----" << endl;
+
+    lsrk::RK2N<double,3> w3(lsrk::WILLIAMSON3);
+    lsrk::RK2N<double,3> ck4(lsrk::CARPENTER4);
+    lsrk::RK3S<double,3> ssp33(lsrk::SSP33);
+    lsrk::RK3S<double,3> ssp104(lsrk::SSP104);
+
+    const double p1 = order(w3);
+    const double p2 = order(ck4);
+    const double p3 = order(ssp33);
+    const double p4 = order(ssp104);
+    cout << boost::format("2N Williamson (3,3)  : %5.2f\n") % p1;
+    cout << boost::format("2N Carpenter  (5,4)  : %5.2f\n") % p2;
+    cout << boost::format("3S* SSP       (3,3)  : %5.2f\n") % p3;
+    cout << boost::format("3S* SSP       (10,4) : %5.2f\n") % p4;
+
+    bool status = true;
+    status &= abs(p1 - 3) < 0.2;
+    status &= abs(p2 - 4) < 0.2;
+    status &= abs(p3 - 3) < 0.2;
+    status &= abs(p4 - 4) < 0.2;
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int nstep = 10;
+    double n1, n2, n3;
+    ClassicRK4           rk4;
+    lsrk::RK2N<double,3> ck4(lsrk::CARPENTER4);
+    lsrk::RK3S<double,3> ssp104(lsrk::SSP104);
+
+    const double t1 = advance(rk4, nstep, n1);
+    const double t2 = advance(ck4, nstep, n2);
+    const double t3 = advance(ssp104, nstep, n3);
+
+    cout << boost::format("classic RK4  (4 stages, 6 registers) : "
+                          "%8.5f [sec/step] %8.5f [sec/stage]\n")
+      % t1 % (t1/4);
+    cout << boost::format("2N RK4       (5 stages, 2 registers) : "
+                          "%8.5f [sec/step] %8.5f [sec/stage]\n")
+      % t2 % (t2/5);
+    cout << boost::format("3S* SSP RK4 (10 stages, 4 registers) : "
+                          "%8.5f [sec/step] %8.5f [sec/stage]\n")
+      % t3 % (t3/10);
+    cout << boost::format("relative difference of norm : %10.3e %10.3e\n")
+      % abs(n2/n1 - 1) % abs(n3/n1 - 1);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,216 @@
+// -*- C++ -*-
+
+///
+/// @file TestLimiter.cpp
+/// @brief Test code for slope limiters
+///
+/// $Id$
+///
+#include <cmath>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "limiter.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+/// @name reference implementations with branches
+//@{
+double minmod_ref(double a, double b)
+{
+  if( a*b <= 0 ) return 0;
+  return a > 0 ? min(a, b) : max(a, b);
+}
+
+double minmod3_ref(double a, double b, double c)
+{
+  return minmod_ref(a, minmod_ref(b, c));
+}
+
+double mc_ref(double a, double b)
+{
+  return minmod3_ref(2*a, 0.5*(a+b), 2*b);
+}
+
+double vanleer_ref(double a, double b)
+{
+  if( a*b <= 0 ) return 0;
+  return 2*a*b/(a+b);
+}
+
+double superbee_ref(double a, double b)
+{
+  if( a*b <= 0 ) return 0;
+  double s1 = minmod_ref(2*a, b);
+  double s2 = minmod_ref(a, 2*b);
+  return abs(s1) > abs(s2) ? s1 : s2;
+}
+
+double vanalbada_ref(double a, double b)
+{
+  const double e = 1.0e-12;
+  if( a*b <= 0 ) return 0;
+  return (a*(b*b + e) + b*(a*a + e))/(a*a + b*b + 2*e);
+}
+
+double gminmod_ref(double a, double b)
+{
+  return minmod3_ref(1.5*a, 0.5*(a+b), 1.5*b);
+}
+//@}
+
+// random number in [-1, 1] with some exact zeros
+double random_diff()
+{
+  double r = 2*mt.rand() - 1;
+  return abs(r) < 0.05 ? 0.0 : r;
+}
+
+template <class L, class R>
+bool check(const char *name, L lim, R ref, vector<double> &a,
+           vector<double> &b)
+{
+  const int N = a.size();
+  vector<double> c(N);
+  vector<float>  af(a.begin(), a.end());
+  vector<float>  bf(b.begin(), b.end());
+  vector<float>  cf(N);
+
+  limiter::limit(lim, a.data(), b.data(), c.data(), N);
+  limiter::limit(lim, af.data(), bf.data(), cf.data(), N);
+
+  double err = 0;
+  double errf = 0;
+  for(int i=0; i < N ;i++) {
+    double r = ref(a[i], b[i]);
+    err  = max(err, abs(c[i] - r));
+    errf = max(errf, abs(cf[i] - ref(af[i], bf[i])));
+  }
+
+  cout << boost::format("%-10s : error = %10.3e (double), %10.3e (float)\n")
+    % name % err % errf;
+
+  return err < 1.0e-14 && errf < 1.0e-6;
+}
+
+int main()
+{
+  const int N = 100000;
+  vector<double> a(N), b(N);
+  for(int i=0; i < N ;i++) {
+    a[i] = random_diff();
+    b[i] = random_diff();
+  }
+
+  { // comparison with reference implementations
+    cout << "----- limiters -----" << endl;
+
+    bool status = true;
+    status &= check("minmod", limiter::MinMod(), minmod_ref, a, b);
+    status &= check("MC", limiter::MC(), mc_ref, a, b);
+    status &= check("van Leer", limiter::VanLeer(), vanleer_ref, a, b);
+    status &= check("superbee", limiter::Superbee(), superbee_ref, a, b);
+    status &= check("van Albada", limiter::VanAlbada(), vanalbada_ref, a, b);
+    status &= check("gminmod", limiter::GMinMod(1.5), gminmod_ref, a, b);
+
+    // compatibility with common::minmod
+    for(int i=0; i < N ;i++) {
+      if( limiter::minmod(a[i], b[i]) != common::minmod(a[i], b[i]) )
+        status = false;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // slope along each axis of NArray
+    cout << "----- slope of NArray -----" << endl;
+
+    const int N1 = 20;
+    const int N2 = 30;
+    const int N3 = 40;
+    NArray<double,3> u(N1, N2, N3);
+    NArray<double,3> du(N1, N2, N3);
+    for(uint64 i=0; i < u.getSize() ;i++) {
+      u.data[i] = mt.rand();
+    }
+
+    bool status = true;
+    for(int axis=0; axis < 3 ;axis++) {
+      const int d[3] = {axis == 0, axis == 1, axis == 2};
+      for(uint64 i=0; i < du.getSize() ;i++) {
+        du.data[i] = -1;
+      }
+
+      limiter::slope(limiter::MC(), u, du, axis);
+
+      for(int i=0; i < N1 ;i++) {
+        for(int j=0; j < N2 ;j++) {
+          for(int k=0; k < N3 ;k++) {
+            int p[3] = {i, j, k};
+            if( p[axis] == 0 || p[axis] == u.shape[axis]-1 ) {
+              if( du(i,j,k) != -1 ) status = false;
+              continue;
+            }
+            double dl = u(i,j,k) - u(i-d[0],j-d[1],k-d[2]);
+            double dr = u(i+d[0],j+d[1],k+d[2]) - u(i,j,k);
+            if( abs(du(i,j,k) - mc_ref(dl, dr)) > 1.0e-14 ) status = false;
+          }
+        }
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int nloop = 100;
+    vector<double> u(N), du(N);
+    for(int i=0; i < N ;i++) {
+      u[i] = mt.rand();
+    }
+
+    double t0, t1, t2, t3;
+
+    t0 = common::etime();
+    for(int n=0; n < nloop ;n++) {
+      for(int i=1; i < N-1 ;i++) {
+        du[i] = minmod_ref(u[i] - u[i-1], u[i+1] - u[i]);
+      }
+    }
+    t1 = common::etime();
+    for(int n=0; n < nloop ;n++) {
+      limiter::slope(limiter::MinMod(), u.data(), du.data(), N);
+    }
+    t2 = common::etime();
+    for(int n=0; n < nloop ;n++) {
+      for(int i=1; i < N-1 ;i++) {
+        du[i] = common::minmod(u[i] - u[i-1], u[i+1] - u[i]);
+      }
+    }
+    t3 = common::etime();
+
+    cout << boost::format("minmod with branch : %10.5f [sec]\n") % (t1 - t0);
+    cout << boost::format("common::minmod     : %10.5f [sec]\n") % (t3 - t2);
+    cout << boost::format("limiter::slope     : %10.5f [sec]\n") % (t2 - t1);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,134 @@
+// -*- C++ -*-
+
+///
+/// @file TestLoopNest.cpp
+/// @brief Test code for compile-time loop nest generator
+///
+/// $Id$
+///
+#include <vector>
+#include "boost/format.hpp"
+#include "SArray.hpp"
+#include "NArray.hpp"
+#include "loopnest.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// check that the loop nest visits every element once in the expected order
+template <class O, class T>
+bool check_nest(const char *name)
+{
+  const int N1 = 13;
+  const int N2 = 17;
+  const int N3 = 19;
+  const int Nm = 2;
+
+  NArray<int,3> a(N1, N2, N3);
+  vector<int64> visit;
+  for(uint64 i=0; i < a.getSize() ;i++) {
+    a.data[i] = 0;
+  }
+
+  loopnest::nd_for<O,T>(loopnest::range(a, Nm),
+                        [&](int i, int j, int k)
+                        {
+                          a(i,j,k)++;
+                          visit.push_back((i*N2 + j)*N3 + k);
+                        });
+
+  bool status = true;
+  for(int i=0; i < N1 ;i++) {
+    for(int j=0; j < N2 ;j++) {
+      for(int k=0; k < N3 ;k++) {
+        bool inner = i >= Nm && i < N1-Nm && j >= Nm && j < N2-Nm &&
+          k >= Nm && k < N3-Nm;
+        if( a(i,j,k) != (inner ? 1 : 0) ) status = false;
+      }
+    }
+  }
+
+  // the second visit is the neighbor along the innermost loop dimension
+  const int64 stride[3] = {N2*N3, N3, 1};
+  if( visit.size() < 2 || visit[1] - visit[0] != stride[O::value[2]] )
+    status = false;
+
+  cout << boost::format("%-24s : %s\n") % name
+    % (status ? "works fine !" : "does not work !");
+  return status;
+}
+
+int main()
+{
+  { // compile-time loops
+    cout << "----- static_nd_for -----" << endl;
+
+    typedef SArray3D<double,2,3,4> T_array;
+    T_array a;
+    for(size_t i=0; i < T_array::size ;i++) {
+      a[i] = mt.rand();
+    }
+
+    double sum1 = 0;
+    double sum2 = 0;
+    int    count = 0;
+    loopnest::static_nd_for<T_array>([&](int i, int j, int k)
+                                     {
+                                       sum1 += a(i,j,k);
+                                       count++;
+                                     });
+    loopnest::static_nd_for<2,12>([&](int i, int j)
+                                  {
+                                    sum2 += a[i*12 + j];
+                                  });
+
+    int sum3 = 0;
+    loopnest::static_for<1,5>([&](int i) { sum3 += i; });
+
+    bool status = count == 24 && sum1 == sum2 && sum3 == 10;
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // rank-generic loop nest
+    cout << "----- nd_for -----" << endl;
+
+    using loopnest::Order;
+    using loopnest::Tile;
+
+    bool status = true;
+    status &= check_nest< Order<0,1,2>, Tile<0,0,0> >("Order<0,1,2>");
+    status &= check_nest< Order<2,1,0>, Tile<0,0,0> >("Order<2,1,0>");
+    status &= check_nest< Order<1,2,0>, Tile<4,0,5> >("Order<1,2,0> tiled");
+    status &= check_nest< Order<0,1,2>, Tile<3,4,8> >("Order<0,1,2> tiled");
+
+    // default order and 2D
+    NArray<double,2> b(20, 30);
+    NArray<double,2> c(20, 30);
+    for(uint64 i=0; i < b.getSize() ;i++) {
+      b.data[i] = mt.rand();
+    }
+    loopnest::nd_for(loopnest::range(b),
+                     [&](int i, int j) { c(i,j) = 2*b(i,j); });
+    for(uint64 i=0; i < b.getSize() ;i++) {
+      if( c.data[i] != 2*b.data[i] ) status = false;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,162 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPIBoundary.cpp
+/// @brief Test code for boundary conditions of distributed NArray
+///
+/// The domain is periodic in x and bounded in y and z, e.g.,
+///
+///   mpirun -np 4 ./TestMPIBoundary -d 2,2,1
+///
+/// $Id$
+///
+#include <cmath>
+#include "NArray.hpp"
+#include "mpiboundary.hpp"
+
+using namespace std;
+
+const int    N     = 12;
+const int    NB    = 2;
+const double value = 0.5;
+const double flux  = -1.0;
+const double sign[3] = {1.0, -1.0, -1.0};
+
+// deterministic data at global index (i, j, k) and component c
+double data(int i, int j, int k, int c)
+{
+  return sin(0.7*i + 1.3*j + 0.1*k*k + c) + 0.1*c;
+}
+
+// physical boundary conditions
+template <int R>
+void set_condition(boundary::Condition<double,R> &bc)
+{
+  using namespace boundary;
+
+  bc.set(1, LOWER, Dirichlet<double>(value));
+  bc.set(1, UPPER, Neumann<double>(flux, 1.0/N));
+  bc.set(2, LOWER, Extrapolate());
+  if( R == 4 ) {
+    bc.set(2, UPPER, Reflect<double>(sign, 3, 3));
+  } else {
+    bc.set(2, UPPER, Reflect<double>(-1.0));
+  }
+}
+
+// compare ghost cells with those of the global array filled serially
+template <int R>
+bool check(NArray<double,R> &x, NArray<double,R> &g, const int nc)
+{
+  int dims[3], period[3], coord[3];
+  MPI_Cart_get(mpiutils::getComm(), 3, dims, period, coord);
+
+  const int n[3] = {N/dims[0], N/dims[1], N/dims[2]};
+  const int m[3] = {n[0]+2*NB, n[1]+2*NB, n[2]+2*NB};
+  double *px = x.data;
+  double *pg = g.data;
+
+  // global array with all faces applied serially
+  for(int i=0; i < N ;i++) {
+    for(int j=0; j < N ;j++) {
+      for(int k=0; k < N ;k++) {
+        for(int c=0; c < nc ;c++) {
+          const int64 p = (((i+NB)*(N+2*NB) + j+NB)*(N+2*NB) + k+NB)*nc + c;
+          pg[p] = data(i, j, k, c);
+        }
+      }
+    }
+  }
+  {
+    using namespace boundary;
+    Condition<double,R> bc;
+    set_condition(bc);
+    apply(g, 0, LOWER, NB, Periodic());
+    apply(g, 0, UPPER, NB, Periodic());
+    for(int dir=1; dir < 3 ;dir++) {
+      bc.apply_physical(g, NB, dir);
+    }
+  }
+
+  // local array with ghost cells filled by the condition
+  for(int64 p=0; p < static_cast<int64>(x.getSize()) ;p++) {
+    px[p] = 0;
+  }
+  for(int i=0; i < n[0] ;i++) {
+    for(int j=0; j < n[1] ;j++) {
+      for(int k=0; k < n[2] ;k++) {
+        for(int c=0; c < nc ;c++) {
+          const int64 p = (((i+NB)*m[1] + j+NB)*m[2] + k+NB)*nc + c;
+          px[p] = data(coord[0]*n[0] + i, coord[1]*n[1] + j,
+                       coord[2]*n[2] + k, c);
+        }
+      }
+    }
+  }
+  boundary::Condition<double,R> bc;
+  set_condition(bc);
+  bc.fill(x, NB);
+
+  double err = 0;
+  for(int i=0; i < m[0] ;i++) {
+    for(int j=0; j < m[1] ;j++) {
+      for(int k=0; k < m[2] ;k++) {
+        for(int c=0; c < nc ;c++) {
+          const int ig = coord[0]*n[0] + i;
+          const int jg = coord[1]*n[1] + j;
+          const int kg = coord[2]*n[2] + k;
+          const int64 p = ((i*m[1] + j)*m[2] + k)*nc + c;
+          const int64 q = ((ig*(N+2*NB) + jg)*(N+2*NB) + kg)*nc + c;
+          err = max(err, abs(px[p] - pg[q]));
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX,
+                mpiutils::getComm());
+
+  cout << tfm::format("rank %d : error = %10.3e\n", R, err);
+
+  return err < 1.0e-14;
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {1, 0, 0};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- boundary condition -----" << endl;
+
+    int dims[3], period[3], coord[3];
+    MPI_Cart_get(mpiutils::getComm(), 3, dims, period, coord);
+    const int m[3] = {N/dims[0]+2*NB, N/dims[1]+2*NB, N/dims[2]+2*NB};
+
+    bool status = true;
+    {
+      NArray<double,3> x(m[0], m[1], m[2]);
+      NArray<double,3> g(N+2*NB, N+2*NB, N+2*NB);
+      status &= check(x, g, 1);
+    }
+    {
+      NArray<double,4> x(m[0], m[1], m[2], 3);
+      NArray<double,4> g(N+2*NB, N+2*NB, N+2*NB, 3);
+      status &= check(x, g, 3);
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,135 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPIFFT.cpp
+/// @brief Test code for pencil-decomposed 3D FFT
+///
+/// The topology must not be decomposed in the last direction, e.g.,
+///
+///   mpirun -np 4 ./TestMPIFFT -d 2,2,1
+///
+/// $Id$
+///
+#include <cmath>
+#include <complex>
+#include "NArray.hpp"
+#include "mpifft.hpp"
+
+using namespace std;
+typedef complex<double> Complex;
+
+// deterministic data at global index (i, j, k)
+Complex data(int i, int j, int k)
+{
+  return Complex(sin(0.7*i + 1.3*j + 0.1*k*k), cos(0.3*i*j + 0.9*k));
+}
+
+// compare with serial transform of global array
+bool check(const int shape[3], const int nchunk)
+{
+  int dims[3], period[3], coord[3];
+  MPI_Cart_get(mpiutils::getComm(), 3, dims, period, coord);
+
+  fft::Pencil<double> pencil(shape, nchunk);
+  int zs[3], xs[3];
+  pencil.getShapeZ(zs);
+  pencil.getShapeX(xs);
+
+  NArray<Complex,3> z(zs[0], zs[1], zs[2]);
+  NArray<Complex,3> w(zs[0], zs[1], zs[2]);
+  NArray<Complex,3> x(xs[0], xs[1], xs[2]);
+  NArray<Complex,3> g(shape[0], shape[1], shape[2]);
+
+  for(int i=0; i < shape[0] ;i++) {
+    for(int j=0; j < shape[1] ;j++) {
+      for(int k=0; k < shape[2] ;k++) {
+        g(i,j,k) = data(i, j, k);
+      }
+    }
+  }
+  for(int i=0; i < zs[0] ;i++) {
+    for(int j=0; j < zs[1] ;j++) {
+      for(int k=0; k < zs[2] ;k++) {
+        z(i,j,k) = data(coord[0]*zs[0] + i, coord[1]*zs[1] + j, k);
+      }
+    }
+  }
+
+  // serial 3D transform
+  for(int axis=0; axis < 3 ;axis++) {
+    fft::c2c(g, axis, fft::FORWARD);
+  }
+
+  double t0 = mpiutils::getTime();
+  pencil.forward(z, x);
+  double t1 = mpiutils::getTime();
+
+  // x-pencil: axis 1 by direction 0 and axis 2 by direction 1
+  const double size = static_cast<double>(shape[0])*shape[1]*shape[2];
+  double err = 0;
+  for(int i=0; i < xs[0] ;i++) {
+    for(int j=0; j < xs[1] ;j++) {
+      for(int k=0; k < xs[2] ;k++) {
+        Complex e = g(i, coord[0]*xs[1] + j, coord[1]*xs[2] + k);
+        err = max(err, abs(x(i,j,k) - e) / size);
+      }
+    }
+  }
+
+  double t2 = mpiutils::getTime();
+  pencil.backward(x, w);
+  double t3 = mpiutils::getTime();
+
+  for(int i=0; i < zs[0] ;i++) {
+    for(int j=0; j < zs[1] ;j++) {
+      for(int k=0; k < zs[2] ;k++) {
+        Complex e = data(coord[0]*zs[0] + i, coord[1]*zs[1] + j, k);
+        err = max(err, abs(w(i,j,k)/size - e));
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX,
+                mpiutils::getComm());
+
+  cout << tfm::format("shape = [%3d,%3d,%3d], chunk = %d : error = %10.3e, "
+                      "forward %8.5f [sec], backward %8.5f [sec]\n",
+                      shape[0], shape[1], shape[2], nchunk, err,
+                      t1 - t0, t3 - t2);
+
+  return err < 1.0e-12;
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {1, 1, 1};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- pencil 3D FFT -----" << endl;
+
+    const int shape1[3] = {12, 24, 30};
+    const int shape2[3] = {36, 24, 18};
+    const int shape3[3] = {48, 48, 48};
+
+    bool status = true;
+    status &= check(shape1, 1);
+    status &= check(shape1, 4);
+    status &= check(shape2, 3);
+    status &= check(shape3, 4);
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,94 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPIHistogram.cpp
+/// @brief Test code for global reduction of histogram
+///
+/// $Id$
+///
+#include <cmath>
+#include "NArray.hpp"
+#include "mpihistogram.hpp"
+
+using namespace std;
+
+const int    N    = 10000;
+const int    NX   = 20;
+const int    NY   = 30;
+const double xmin = -1.0;
+const double xmax = +1.0;
+
+// deterministic data of element i on process rank
+double data(int rank, int i, int c)
+{
+  return sin(0.37*i + 1.7*rank + 2.1*c);
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {1, 1, 1};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- global reduction -----" << endl;
+
+    const int rank  = mpiutils::getThisRank();
+    const int nproc = mpiutils::getNProcess();
+
+    NArray<double,1> x(N), y(N);
+    for(int i=0; i < N ;i++) {
+      x(i) = data(rank, i, 0);
+      y(i) = data(rank, i, 1);
+    }
+
+    histogram::Hist1D<double> h1(NX, xmin, xmax);
+    histogram::Hist2D<double> h2(NX, xmin, xmax, NY, xmin, xmax);
+    h1.fill(x, y);
+    h2.fill(x, y);
+    histogram::allreduce(h1);
+
+    MPI_Request req;
+    histogram::allreduce_begin(h2, &req);
+    mpiutils::wait(&req, 1);
+
+    // all data on every process
+    histogram::Hist1D<double> r1(NX, xmin, xmax);
+    histogram::Hist2D<double> r2(NX, xmin, xmax, NY, xmin, xmax);
+    for(int p=0; p < nproc ;p++) {
+      for(int i=0; i < N ;i++) {
+        x(i) = data(p, i, 0);
+        y(i) = data(p, i, 1);
+      }
+      r1.fill(x, y);
+      r2.fill(x, y);
+    }
+
+    double err = 0;
+    for(int i=0; i < NX ;i++) {
+      err = max(err, abs(h1(i) - r1(i)));
+      for(int j=0; j < NY ;j++) {
+        err = max(err, abs(h2(i,j) - r2(i,j)));
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX,
+                  mpiutils::getComm());
+
+    cout << tfm::format("error = %10.3e, total = %8.0f\n",
+                        err, h2.getTotal());
+
+    if( err < 1.0e-10 && h2.getTotal() == nproc*N ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,178 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPIKrylov.cpp
+/// @brief Test code for pipelined Krylov solvers
+///
+/// A 3D elliptic problem with Dirichlet boundaries is solved on decomposed
+/// domain, e.g.,
+///
+///   mpirun -np 4 ./TestMPIKrylov -d 2,2,1
+///
+/// $Id$
+///
+#include <cmath>
+#include "NArray.hpp"
+#include "krylov.hpp"
+#include "mpiboundary.hpp"
+
+using namespace std;
+
+static const int Nb = 1;
+static const int Nx = 12;
+
+//
+// 7-point operator -lap(x) + c*x + v*dx(x) with zero ghost cells at
+// physical boundaries; non-symmetric if v != 0
+//
+class Operator
+{
+public:
+  NArray<double,3> coef;
+  double v;
+
+  Operator(double velocity)
+    : coef(Nx+2*Nb, Nx+2*Nb, Nx+2*Nb), v(velocity)
+  {
+    int c[3];
+    mpiutils::getCoord(c);
+    for(int i=0; i < Nx+2*Nb ;i++) {
+      for(int j=0; j < Nx+2*Nb ;j++) {
+        for(int k=0; k < Nx+2*Nb ;k++) {
+          const double x = (c[0]*Nx + i)*0.1;
+          const double y = (c[1]*Nx + j)*0.1;
+          const double z = (c[2]*Nx + k)*0.1;
+          coef(i,j,k) = 1 + sin(x + 2*y)*cos(z);
+        }
+      }
+    }
+  }
+
+  double diagonal(int i, int j, int k)
+  {
+    return 6 + coef(i,j,k);
+  }
+
+  void operator()(NArray<double,3> &x, NArray<double,3> &y)
+  {
+    boundary::exchange(x, Nb);
+
+#pragma omp parallel for collapse(2)
+    for(int i=Nb; i < Nx+Nb ;i++) {
+      for(int j=Nb; j < Nx+Nb ;j++) {
+        for(int k=Nb; k < Nx+Nb ;k++) {
+          y(i,j,k) = (6 + coef(i,j,k))*x(i,j,k)
+            - x(i-1,j,k) - x(i+1,j,k)
+            - x(i,j-1,k) - x(i,j+1,k)
+            - x(i,j,k-1) - x(i,j,k+1)
+            + 0.5*v*(x(i+1,j,k) - x(i-1,j,k));
+        }
+      }
+    }
+  }
+};
+
+// solve with given solver and preconditioner
+template <class Solver, class Pc>
+bool check(const char *name, Solver solver, Operator &A, Pc &M)
+{
+  const int N = Nx + 2*Nb;
+  NArray<double,3> b(N, N, N);
+  NArray<double,3> x(N, N, N);
+  NArray<double,3> r(N, N, N);
+
+  int c[3];
+  mpiutils::getCoord(c);
+  for(int i=0; i < N ;i++) {
+    for(int j=0; j < N ;j++) {
+      for(int k=0; k < N ;k++) {
+        b(i,j,k) = cos(0.3*(c[0]*Nx + i) + 0.2*(c[1]*Nx + j))
+          + sin(0.5*(c[2]*Nx + k));
+        x(i,j,k) = 0;
+      }
+    }
+  }
+
+  krylov::Status status = solver(A, M, b, x, Nb, 1.0e-10, 500);
+
+  // true residual
+  A(x, r);
+  double local[2] = {0, 0};
+  double global[2];
+  for(int i=Nb; i < Nx+Nb ;i++) {
+    for(int j=Nb; j < Nx+Nb ;j++) {
+      for(int k=Nb; k < Nx+Nb ;k++) {
+        local[0] += pow(b(i,j,k) - r(i,j,k), 2);
+        local[1] += pow(b(i,j,k), 2);
+      }
+    }
+  }
+  MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, mpiutils::getComm());
+  const double res = sqrt(global[0]/global[1]);
+
+  cout << tfm::format("%-24s : iteration = %3d, residual = %10.3e (%10.3e)\n",
+                      name, status.iteration, status.residual, res);
+
+  return status.converged && res < 1.0e-9;
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {0, 0, 0};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- pipelined Krylov solvers -----" << endl;
+
+    Operator sym(0.0);
+    Operator nonsym(1.5);
+
+    // inverse of diagonal for Jacobi preconditioner
+    const int N = Nx + 2*Nb;
+    NArray<double,3> dinv(N, N, N);
+    for(int i=0; i < N ;i++) {
+      for(int j=0; j < N ;j++) {
+        for(int k=0; k < N ;k++) {
+          dinv(i,j,k) = 1/sym.diagonal(i,j,k);
+        }
+      }
+    }
+
+    krylov::Identity       identity(Nb);
+    krylov::Jacobi<double> jacobi(dinv, Nb);
+
+    auto cg = [](Operator &A, auto &M, NArray<double,3> &b,
+                 NArray<double,3> &x, int nb, double tol, int maxiter)
+      {
+        return krylov::cg(A, M, b, x, nb, tol, maxiter);
+      };
+    auto bicgstab = [](Operator &A, auto &M, NArray<double,3> &b,
+                       NArray<double,3> &x, int nb, double tol, int maxiter)
+      {
+        return krylov::bicgstab(A, M, b, x, nb, tol, maxiter);
+      };
+
+    bool status = true;
+    status &= check("CG", cg, sym, identity);
+    status &= check("CG + Jacobi", cg, sym, jacobi);
+    status &= check("BiCGStab", bicgstab, sym, identity);
+    status &= check("BiCGStab + Jacobi", bicgstab, sym, jacobi);
+    status &= check("BiCGStab (nonsym)", bicgstab, nonsym, identity);
+    status &= check("BiCGStab + Jacobi (nonsym)", bicgstab, nonsym, jacobi);
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,149 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPIMultigrid.cpp
+/// @brief Test code for multigrid solver
+///
+/// The domain is periodic in x and bounded in y and z, e.g.,
+///
+///   mpirun -np 4 ./TestMPIMultigrid -d 2,2,1
+///
+/// $Id$
+///
+#include <cmath>
+#include "NArray.hpp"
+#include "multigrid.hpp"
+
+using namespace std;
+
+static const int Nx = 32;
+
+// right-hand-side at cell center of global index (i, j, k)
+double source(int i, int j, int k, const double h)
+{
+  const double x = (i + 0.5)*h;
+  const double y = (j + 0.5)*h;
+  const double z = (k + 0.5)*h;
+  return cos(2*M_PI*x) * sin(M_PI*y) * (1 + 4*z*(1 - z)) + y*z;
+}
+
+// local arrays of right-hand-side and zero initial guess
+void setup(NArray<double,3> &u, NArray<double,3> &f, const double h)
+{
+  int c[3];
+  mpiutils::getCoord(c);
+  for(int i=0; i < Nx+2 ;i++) {
+    for(int j=0; j < Nx+2 ;j++) {
+      for(int k=0; k < Nx+2 ;k++) {
+        f(i,j,k) = source(c[0]*Nx+i-1, c[1]*Nx+j-1, c[2]*Nx+k-1, h);
+        u(i,j,k) = 0;
+      }
+    }
+  }
+}
+
+// grid spacing for unit length in the longest direction
+double spacing()
+{
+  int dims[3], period[3], coord[3];
+  MPI_Cart_get(mpiutils::getComm(), 3, dims, period, coord);
+  return 1.0/(Nx*max(dims[0], max(dims[1], dims[2])));
+}
+
+// V-cycles until convergence
+bool check_cycle(const double lambda)
+{
+  const int    n[3] = {Nx, Nx, Nx};
+  const double hh   = spacing();
+  const double h[3] = {hh, hh, hh};
+
+  NArray<double,3> u(Nx+2, Nx+2, Nx+2);
+  NArray<double,3> f(Nx+2, Nx+2, Nx+2);
+  setup(u, f, hh);
+
+  multigrid::Solver<double> mg(n, h, lambda);
+
+  double t0 = mpiutils::getTime();
+  krylov::Status status = mg.solve(u, f, 1.0e-10, 30);
+  double t1 = mpiutils::getTime();
+
+  // average convergence factor per cycle
+  const double rho = pow(status.residual, 1.0/status.iteration);
+
+  cout << tfm::format("lambda = %5.1f : levels = %d, cycles = %2d, "
+                      "residual = %10.3e, factor = %5.3f, "
+                      "time/cycle = %8.5f [sec]\n",
+                      lambda, mg.getLevels(), status.iteration,
+                      status.residual, rho, (t1 - t0)/status.iteration);
+
+  return status.converged && rho < 0.2;
+}
+
+// V-cycle as preconditioner of Krylov solver
+bool check_preconditioner()
+{
+  const int    n[3] = {Nx, Nx, Nx};
+  const double hh   = spacing();
+  const double h[3] = {hh, hh, hh};
+  const double cc   = 1/(hh*hh);
+
+  NArray<double,3> u(Nx+2, Nx+2, Nx+2);
+  NArray<double,3> f(Nx+2, Nx+2, Nx+2);
+  setup(u, f, hh);
+
+  multigrid::Solver<double> mg(n, h);
+
+  // operator with the same boundary condition as the multigrid solver
+  auto A = [&](NArray<double,3> &x, NArray<double,3> &y)
+    {
+      mg.fill(x);
+      for(int i=1; i <= Nx ;i++) {
+        for(int j=1; j <= Nx ;j++) {
+          for(int k=1; k <= Nx ;k++) {
+            y(i,j,k) = cc*(6*x(i,j,k)
+                           - x(i-1,j,k) - x(i+1,j,k)
+                           - x(i,j-1,k) - x(i,j+1,k)
+                           - x(i,j,k-1) - x(i,j,k+1));
+          }
+        }
+      }
+    };
+
+  krylov::Status status = krylov::bicgstab(A, mg, f, u, 1, 1.0e-10, 30);
+
+  cout << tfm::format("BiCGStab + multigrid : iteration = %2d, "
+                      "residual = %10.3e\n",
+                      status.iteration, status.residual);
+
+  return status.converged && status.iteration < 10;
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {1, 0, 0};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- multigrid -----" << endl;
+
+    bool status = true;
+    status &= check_cycle(0.0);
+    status &= check_cycle(100.0);
+    status &= check_preconditioner();
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,122 @@
+// -*- C++ -*-
+
+///
+/// @file TestMPITridiag.cpp
+/// @brief Test code for distributed tridiagonal solver
+///
+/// The systems are distributed along the first direction, e.g.,
+///
+///   mpirun -np 4 ./TestMPITridiag -d 2,2,1
+///
+/// $Id$
+///
+#include <cmath>
+#include "NArray.hpp"
+#include "mpitridiag.hpp"
+
+using namespace std;
+
+// deterministic coefficients at global index (i, j, k)
+void coefficients(int i, int j, int k, double &a, double &b, double &c,
+                  double &d)
+{
+  a = -0.5 - 0.4*sin(0.7*i + 1.3*j + 0.1*k);
+  c = -0.5 - 0.4*cos(0.3*i + 0.9*j + 0.7*k);
+  b =  2.5 + 0.5*sin(1.1*i + 0.2*j + 0.3*k);
+  d = cos(0.5*i + 0.37*j + 1.7*k);
+}
+
+// compare distributed solution with serial solution of global systems
+bool check(const int axis, const bool periodic)
+{
+  const int dir = 0;
+  int nproc;
+  int coord[3];
+  MPI_Comm_size(mpiutils::getLineComm(dir), &nproc);
+  mpiutils::getCoord(coord);
+
+  // local and global shape; the axis is decomposed
+  int lshape[3] = {6, 7, 9};
+  int gshape[3] = {6, 7, 9};
+  gshape[axis] *= nproc;
+  const int offset = coord[dir]*lshape[axis];
+
+  NArray<double,3> a(lshape[0], lshape[1], lshape[2]);
+  NArray<double,3> b(lshape[0], lshape[1], lshape[2]);
+  NArray<double,3> c(lshape[0], lshape[1], lshape[2]);
+  NArray<double,3> d(lshape[0], lshape[1], lshape[2]);
+  NArray<double,3> ga(gshape[0], gshape[1], gshape[2]);
+  NArray<double,3> gb(gshape[0], gshape[1], gshape[2]);
+  NArray<double,3> gc(gshape[0], gshape[1], gshape[2]);
+  NArray<double,3> gd(gshape[0], gshape[1], gshape[2]);
+
+  for(int i=0; i < gshape[0] ;i++) {
+    for(int j=0; j < gshape[1] ;j++) {
+      for(int k=0; k < gshape[2] ;k++) {
+        coefficients(i, j, k, ga(i,j,k), gb(i,j,k), gc(i,j,k), gd(i,j,k));
+      }
+    }
+  }
+  for(int i=0; i < lshape[0] ;i++) {
+    for(int j=0; j < lshape[1] ;j++) {
+      for(int k=0; k < lshape[2] ;k++) {
+        int g[3] = {i, j, k};
+        g[axis] += offset;
+        coefficients(g[0], g[1], g[2], a(i,j,k), b(i,j,k), c(i,j,k), d(i,j,k));
+      }
+    }
+  }
+
+  tridiag::solve(ga, gb, gc, gd, axis, periodic);
+  tridiag::solve_distributed(a, b, c, d, axis, dir, periodic);
+
+  double err = 0;
+  for(int i=0; i < lshape[0] ;i++) {
+    for(int j=0; j < lshape[1] ;j++) {
+      for(int k=0; k < lshape[2] ;k++) {
+        int g[3] = {i, j, k};
+        g[axis] += offset;
+        err = max(err, abs(d(i,j,k) - gd(g[0],g[1],g[2])));
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX,
+                mpiutils::getComm());
+
+  cout << tfm::format("axis = %d, periodic = %d : error = %10.3e\n",
+                      axis, periodic, err);
+
+  return err < 1.0e-13;
+}
+
+int main(int argc, char **argv)
+{
+  int period[3] = {1, 1, 1};
+  mpiutils::initialize(&argc, &argv, period);
+
+  {
+    cout << "----- distributed tridiagonal solver -----" << endl;
+
+    bool status = true;
+    for(int periodic=0; periodic < 2 ;periodic++) {
+      for(int axis=0; axis < 3 ;axis++) {
+        status &= check(axis, periodic);
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  mpiutils::finalize();
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
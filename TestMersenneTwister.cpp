@@ -6,8 +6,6 @@
 ///
 /// This code demonstrates how to use MersenneTwister object.
 ///
-/// @todo add test routine for normal random numbers
-///
 /// Author: Takanobu AMANO <amanot@stelab.nagoya-u.ac.jp>
 /// $Id$
 ///
@@ -58,6 +56,36 @@ int main()
     }
   }
 
+  {
+    // normal random numbers by scalar and batch versions
+    // mean, variance and kurtosis should be close to 0, 1 and 3
+    const int N = 1000000;
+    double *x = new double[N];
+    MersenneTwister mt;
+    for(int i=0; i < N ;i++) {
+      x[i] = mt.normal();
+    }
+    cout << setw(60) << setfill('-') << "" << endl;
+    for(int batch=0; batch < 2 ;batch++) {
+      if( batch ) {
+        mt.normal(x, N);
+      }
+      double m1 = 0, m2 = 0, m4 = 0;
+      for(int i=0; i < N ;i++) {
+        m1 += x[i];
+        m2 += x[i]*x[i];
+        m4 += x[i]*x[i]*x[i]*x[i];
+      }
+      m1 /= N;
+      m2 /= N;
+      m4 /= N;
+      cout << boost::format("normal random number (%s) : "
+                            "mean = %8.5f, var = %8.5f, kurt = %8.5f\n")
+        % (batch ? "batch " : "scalar") % m1 % (m2 - m1*m1) % (m4/(m2*m2));
+    }
+    delete [] x;
+  }
+
   return 0;
 }
 
@@ -10,6 +10,7 @@
 /// $Id$
 ///
 #include "boost/format.hpp"
+#include "common.hpp"
 #include "NArray.hpp"
 #include "MersenneTwister.hpp"
 
@@ -23,6 +24,21 @@ int rand(int min, int max)
   return static_cast<int>(r * (max - min)) + min;
 }
 
+// reference scalar gather (not vectorized)
+__attribute__((optimize("no-tree-vectorize")))
+void gather_scalar(const double *src, const int *index, double *dst, int n)
+{
+  for(int i=0; i < n ;i++) dst[i] = src[index[i]];
+}
+
+// reference scalar scatter-add (not vectorized)
+__attribute__((optimize("no-tree-vectorize")))
+void scatter_add_scalar(double *dst, const int *index, const double *src,
+                        int n)
+{
+  for(int i=0; i < n ;i++) dst[index[i]] += src[i];
+}
+
 int main()
 {
   { // 1D array
@@ -240,6 +256,80 @@ int main()
     }
   }
 
+  { // gather and scatter-add by index list
+    const int N1 = 64;
+    const int N2 = 64;
+    const int N3 = 64;
+    const int NN = N1*N2*N3;
+    const int NI = 1 << 20;
+    const int NR = 20;
+    NArray<double,3> a3(N1, N2, N3);
+    NArray<double,3> b3(N1, N2, N3);
+    NArray<int,1>    index(NI);
+    NArray<double,1> x(NI);
+    NArray<double,1> y(NI);
+
+    for(int i=0; i < NN ;i++) {
+      a3.data[i] = rand(0, 100);
+      b3.data[i] = a3.data[i];
+    }
+    for(int i=0; i < NI ;i++) {
+      // indices repeat for testing conflicts in scatter-add
+      index.data[i] = rand(0, NN-1) / 2;
+      x.data[i]     = rand(0, 100);
+    }
+
+    cout << "----- gather/scatter_add -----" << endl;
+    bool status = true;
+
+    // gather
+    a3.gather(index, y);
+    for(int i=0; i < NI ;i++) {
+      if( y.data[i] != a3.data[index.data[i]] ) status = false;
+    }
+
+    // scatter-add (exact as all values are integers)
+    a3.scatter_add(index, x);
+    scatter_add_scalar(b3.data, index.data, x.data, NI);
+    for(int i=0; i < NN ;i++) {
+      if( a3.data[i] != b3.data[i] ) status = false;
+    }
+
+    // timing
+    double t0, t1, t2, t3;
+    t0 = common::etime();
+    for(int r=0; r < NR ;r++) gather_scalar(a3.data, index.data, y.data, NI);
+    t1 = common::etime();
+    for(int r=0; r < NR ;r++) a3.gather(index, y);
+    t2 = common::etime();
+    t3 = (t1 - t0) / (t2 - t1);
+    cout << boost::format("gather      : scalar %8.3f ms, simd %8.3f ms"
+                          " ===> speedup %5.2f\n")
+      % ((t1-t0)/NR*1.0e+3) % ((t2-t1)/NR*1.0e+3) % t3;
+
+    // scatter-add is scalar unless built with -DSIMD_SCATTER (on AVX-512)
+    if( simd::VECTOR_SCATTER_ADD ) {
+      t0 = common::etime();
+      for(int r=0; r < NR ;r++)
+        scatter_add_scalar(a3.data, index.data, x.data, NI);
+      t1 = common::etime();
+      for(int r=0; r < NR ;r++) a3.scatter_add(index, x);
+      t2 = common::etime();
+      t3 = (t1 - t0) / (t2 - t1);
+      cout << boost::format("scatter_add : scalar %8.3f ms, simd %8.3f ms"
+                            " ===> speedup %5.2f\n")
+        % ((t1-t0)/NR*1.0e+3) % ((t2-t1)/NR*1.0e+3) % t3;
+    } else {
+      cout << "scatter_add : scalar (vectorized with -DSIMD_SCATTER)" << endl;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
   return 0;
 }
 
@@ -0,0 +1,126 @@
+// -*- C++ -*-
+
+///
+/// @file TestNArrayMask.cpp
+/// @brief Test code for NArrayMask class
+///
+/// This code demonstrates how to use NArrayMask object.
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "NArray.hpp"
+#include "NArrayMask.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+int main()
+{
+  const int N1 = 32;
+  const int N2 = 24;
+  const int N3 = 40;
+  const int NN = N1*N2*N3;
+  const double threshold = 0.8;
+
+  NArray<double,3> a(N1, N2, N3);
+  NArray<double,3> b(N1, N2, N3);
+
+  for(int i=0; i < NN ;i++) {
+    a.data[i] = mt.rand();
+    b.data[i] = a.data[i];
+  }
+
+  NArrayMask mask(a, [=](double x) { return x > threshold; });
+
+  { // compacted index list and bitmask
+    cout << "----- build mask -----" << endl;
+
+    int    count = 0;
+    double sum   = 0;
+    double amax  = 0;
+    bool status  = true;
+    for(int i=0; i < NN ;i++) {
+      bool active = a.data[i] > threshold;
+      if( active ) {
+        if( mask.getIndex()[count] != i ) status = false;
+        count++;
+        sum += a.data[i];
+        amax = max(amax, a.data[i]);
+      }
+      if( active != mask.isActive(i) ) status = false;
+    }
+    if( count != static_cast<int>(mask.getCount()) ) status = false;
+    if( abs(sum - mask.sum(a)) > 1.0e-10*sum ) status = false;
+    if( amax != mask.maximum(a) ) status = false;
+    if( mask.minimum(a) <= threshold ) status = false;
+
+    cout << boost::format("active cells = %8d / %8d\n") % count % NN;
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // select by flat index (region)
+    cout << "----- select region -----" << endl;
+
+    NArrayMask region;
+    region.select(a.getSize(),
+                  [=](uint64 i)
+                  {
+                    int i1 = i / (N2*N3);
+                    return i1 >= 4 && i1 < 8;
+                  });
+
+    bool status = true;
+    if( region.getCount() != static_cast<uint64>(4*N2*N3) ) status = false;
+    if( region.getIndex()[0] != 4*N2*N3 ) status = false;
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // batch transform
+    cout << "----- transform -----" << endl;
+
+    mask.transform(a, [](double *x, int n)
+                   {
+                     for(int k=0; k < n ;k++) x[k] = 2*x[k];
+                   });
+
+    bool status = true;
+    for(int i=0; i < NN ;i++) {
+      double expect = b.data[i] > threshold ? 2*b.data[i] : b.data[i];
+      if( a.data[i] != expect ) status = false;
+    }
+
+    // gather and scatter back
+    vector<double> buffer(mask.getCount());
+    mask.gather(a, buffer.data());
+    for(size_t p=0; p < buffer.size() ;p++) buffer[p] *= 0.5;
+    mask.scatter(buffer.data(), a);
+
+    for(int i=0; i < NN ;i++) {
+      if( a.data[i] != b.data[i] ) status = false;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,209 @@
+// -*- C++ -*-
+
+///
+/// @file TestReconstruction.cpp
+/// @brief Test code for reconstruction of interface states
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "reconstruction.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+enum { MAXNORM = 0, L1NORM };
+
+// error of face values for cell averages of sin(x) on N cells
+template <class S>
+double error(const S &scheme, const int N, const int norm)
+{
+  const int R = S::RADIUS;
+  const double h = 2*M_PI/N;
+
+  NArray<double,1> u(N+2*R), wm(N+2*R), wp(N+2*R);
+  for(int i=0; i < N+2*R ;i++) {
+    double xm = (i-R)*h;
+    double xp = (i-R+1)*h;
+    u(i) = (cos(xm) - cos(xp))/h;
+  }
+
+  reconstruction::reconstruct(scheme, u, wm, wp, 0);
+
+  double err = 0;
+  for(int i=R; i < N+R ;i++) {
+    double em = abs(wm(i) - sin((i-R)*h));
+    double ep = abs(wp(i) - sin((i-R+1)*h));
+    if( norm == MAXNORM ) {
+      err = max(err, max(em, ep));
+    } else {
+      err += 0.5*(em + ep)*h;
+    }
+  }
+  return err;
+}
+
+// check convergence rate
+template <class S>
+bool check_rate(const char *name, const S &scheme, const double order,
+                const int norm=MAXNORM)
+{
+  double e1 = error(scheme, 64, norm);
+  double e2 = error(scheme, 128, norm);
+  double rate = log2(e1/e2);
+
+  cout << boost::format("%-8s : error = %12.5e, %12.5e (rate = %5.2f, %s)\n")
+    % name % e1 % e2 % rate % (norm == MAXNORM ? "max" : "L1");
+
+  return rate > order - 0.3;
+}
+
+// check that face values of a step are bounded by the neighbors
+template <class S>
+bool check_bound(const S &scheme)
+{
+  const int N = 64;
+  const int R = S::RADIUS;
+  NArray<float,1> u(N), wm(N), wp(N);
+  for(int i=0; i < N ;i++) {
+    u(i) = i < N/2 ? 1.0 : 0.0;
+  }
+
+  reconstruction::reconstruct(scheme, u, wm, wp, 0);
+
+  bool status = true;
+  for(int i=R; i < N-R ;i++) {
+    float lo = min(u(i-1), min(u(i), u(i+1)));
+    float hi = max(u(i-1), max(u(i), u(i+1)));
+    if( wm(i) < lo - 1.0e-6 || wm(i) > hi + 1.0e-6 ) status = false;
+    if( wp(i) < lo - 1.0e-6 || wp(i) > hi + 1.0e-6 ) status = false;
+  }
+  return status;
+}
+
+// check reconstruction along each axis against 1D
+template <class S>
+bool check_axis(const S &scheme)
+{
+  const int R  = S::RADIUS;
+  const int N1 = 12;
+  const int N2 = 17;
+  const int N3 = 23;
+  NArray<double,3> u(N1, N2, N3), wm(N1, N2, N3), wp(N1, N2, N3);
+  for(uint64 i=0; i < u.getSize() ;i++) {
+    u.data[i] = mt.rand();
+  }
+
+  bool status = true;
+  for(int axis=0; axis < 3 ;axis++) {
+    reconstruction::reconstruct(scheme, u, wm, wp, axis);
+
+    const int d[3] = {axis == 0, axis == 1, axis == 2};
+    for(int i=0; i < N1 ;i++) {
+      for(int j=0; j < N2 ;j++) {
+        for(int k=0; k < N3 ;k++) {
+          int p[3] = {i, j, k};
+          int n = u.shape[axis];
+          if( p[axis] < R || p[axis] >= n-R ) continue;
+
+          double v[2*R+1], m, q;
+          for(int s=-R; s <= R ;s++) {
+            v[s+R] = u(i+s*d[0], j+s*d[1], k+s*d[2]);
+          }
+          scheme(v, m, q);
+          if( abs(wm(i,j,k) - m) > 1.0e-14 || abs(wp(i,j,k) - q) > 1.0e-14 )
+            status = false;
+        }
+      }
+    }
+  }
+  return status;
+}
+
+int main()
+{
+  using namespace reconstruction;
+
+  { // convergence for smooth profile
+    cout << "----- convergence -----" << endl;
+
+    bool status = true;
+    // clipping at extrema limits PPM to second order in max norm, but it
+    // affects only a few cells around each extremum
+    status &= check_rate("PLM", PLM<limiter::MC>(), 2.0);
+    status &= check_rate("PLM", PLM<limiter::MC>(), 2.0, L1NORM);
+    status &= check_rate("PPM", PPM(), 3.0, L1NORM);
+    status &= check_rate("WENO5", WENO5(), 4.5);
+    status &= check_rate("WENO-Z", WENOZ(), 4.5);
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // discontinuity
+    cout << "----- discontinuity -----" << endl;
+
+    bool status = true;
+    status &= check_bound(PLM<limiter::MinMod>());
+    status &= check_bound(PLM<limiter::MC>());
+    status &= check_bound(PPM());
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // along each axis of 3D array
+    cout << "----- axis -----" << endl;
+
+    bool status = true;
+    status &= check_axis(PLM<limiter::VanLeer>());
+    status &= check_axis(PPM());
+    status &= check_axis(WENO5());
+    status &= check_axis(WENOZ());
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 128;
+    const int nloop = 10;
+    NArray<double,3> u(N, N, N), wm(N, N, N), wp(N, N, N);
+    for(uint64 i=0; i < u.getSize() ;i++) {
+      u.data[i] = mt.rand();
+    }
+
+    for(int axis=0; axis < 3 ;axis++) {
+      double t0 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        reconstruct(WENOZ(), u, wm, wp, axis);
+      }
+      double t1 = common::etime();
+      double rate = nloop*u.getSize()/(t1 - t0)*1.0e-6;
+      cout << boost::format("WENO-Z along axis %d : %8.2f [Mcell/sec]\n")
+        % axis % rate;
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,357 @@
+// -*- C++ -*-
+
+///
+/// @file TestRiemann.cpp
+/// @brief Test code for approximate Riemann solvers
+///
+/// $Id$
+///
+#include <cmath>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "riemann.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// random primitive state
+template <class E>
+void random_state(double *w, const double vmax=1.0)
+{
+  w[E::IRO] = 0.5 + mt.rand();
+  w[E::IVX] = vmax*(2*mt.rand() - 1);
+  w[E::IVY] = vmax*(2*mt.rand() - 1);
+  w[E::IVZ] = vmax*(2*mt.rand() - 1);
+  w[E::IPR] = 0.5 + mt.rand();
+  for(int v=5; v < E::NVAR ;v++) {
+    w[v] = 2*mt.rand() - 1;
+  }
+}
+
+// physical flux
+template <class E>
+void physical_flux(const E &eq, const double *w, double *f)
+{
+  double u[E::NVAR];
+  eq.conserved(w, u);
+  eq.flux(w, u, f);
+}
+
+// scalar application of solver without vectorization
+template <class S>
+__attribute__((noinline, optimize("no-tree-vectorize")))
+void solve_scalar(const S &solver, const NArray<double,2> &wl,
+                  const NArray<double,2> &wr, NArray<double,2> &f)
+{
+  const int N = S::NVAR;
+  const int n = wl.shape[1];
+  for(int i=0; i < n ;i++) {
+    double l[N], r[N], g[N];
+    for(int v=0; v < N ;v++) {
+      l[v] = wl(v,i);
+      r[v] = wr(v,i);
+    }
+    solver(l, r, g);
+    for(int v=0; v < N ;v++) {
+      f(v,i) = g[v];
+    }
+  }
+}
+
+///
+/// consistency F(w, w) = F(w) and upwinding for supersonic flows
+///
+template <class S>
+bool check_consistency(const char *name, const S &solver)
+{
+  typedef typename S::equation E;
+  const int N = E::NVAR;
+  double err1 = 0;
+  double err2 = 0;
+
+  for(int n=0; n < 1000 ;n++) {
+    double wl[N], wr[N], f[N], fl[N], fr[N];
+
+    // identical states
+    random_state<E>(wl);
+    physical_flux(solver.eq, wl, fl);
+    solver(wl, wl, f);
+    for(int v=0; v < N ;v++) {
+      err1 = max(err1, abs(f[v] - fl[v]));
+    }
+
+    // supersonic to the right and to the left
+    random_state<E>(wl);
+    random_state<E>(wr);
+    wr[E::IRO] = wl[E::IRO];
+    for(int v=5; v < N ;v++) wr[v] = wl[v];
+    wl[E::IVX] = +10;
+    wr[E::IVX] = +10;
+    physical_flux(solver.eq, wl, fl);
+    solver(wl, wr, f);
+    for(int v=0; v < N ;v++) {
+      err2 = max(err2, abs(f[v] - fl[v]));
+    }
+    wl[E::IVX] = -10;
+    wr[E::IVX] = -10;
+    physical_flux(solver.eq, wr, fr);
+    solver(wl, wr, f);
+    for(int v=0; v < N ;v++) {
+      err2 = max(err2, abs(f[v] - fr[v]));
+    }
+  }
+
+  cout << boost::format("%-6s : consistency = %10.3e, upwind = %10.3e\n")
+    % name % err1 % err2;
+
+  return err1 < 1.0e-12 && err2 < 1.0e-12;
+}
+
+///
+/// mass flux through a stationary contact discontinuity
+///
+template <class S>
+double contact_flux(const S &solver)
+{
+  typedef typename S::equation E;
+  const int N = E::NVAR;
+  double wl[N] = {}, wr[N] = {}, f[N];
+
+  wl[E::IRO] = 1.0;
+  wr[E::IRO] = 0.1;
+  wl[E::IPR] = 1.0;
+  wr[E::IPR] = 1.0;
+  for(int v=5; v < N ;v++) {
+    wl[v] = 0.5;
+    wr[v] = 0.5;
+  }
+  solver(wl, wr, f);
+
+  return abs(f[E::IRO]);
+}
+
+///
+/// batched solver for NArray against scalar application
+///
+template <class S>
+bool check_batch(const char *name, const S &solver, const int n)
+{
+  typedef typename S::equation E;
+  const int N = E::NVAR;
+  NArray<double,2> wl(N, n), wr(N, n), f(N, n), g(N, n);
+
+  for(int i=0; i < n ;i++) {
+    double l[N], r[N];
+    random_state<E>(l, 2.0);
+    random_state<E>(r, 2.0);
+    for(int v=0; v < N ;v++) {
+      wl(v,i) = l[v];
+      wr(v,i) = r[v];
+    }
+  }
+
+  riemann::solve(solver, wl, wr, f);
+  solve_scalar(solver, wl, wr, g);
+
+  double err = 0;
+  for(int v=0; v < N ;v++) {
+    for(int i=0; i < n ;i++) {
+      err = max(err, abs(f(v,i) - g(v,i))/(1 + abs(g(v,i))));
+    }
+  }
+
+  // performance
+  const int nloop = 20;
+  double t0, t1, t2;
+  t0 = common::etime();
+  for(int l=0; l < nloop ;l++) {
+    solve_scalar(solver, wl, wr, g);
+  }
+  t1 = common::etime();
+  for(int l=0; l < nloop ;l++) {
+    riemann::solve(solver, wl, wr, f);
+  }
+  t2 = common::etime();
+
+  double ms = 1.0e-6*nloop*n/(t1 - t0);
+  double mb = 1.0e-6*nloop*n/(t2 - t1);
+  cout << boost::format("%-6s : error = %10.3e, "
+                        "scalar %8.2f, batch %8.2f [Mface/sec]\n")
+    % name % err % ms % mb;
+
+  return err < 1.0e-12;
+}
+
+///
+/// shock tube problem with first order Godunov scheme
+///
+template <class S>
+bool shock_tube(const char *name, const S &solver, const double *wl,
+                const double *wr)
+{
+  typedef typename S::equation E;
+  const int    N     = E::NVAR;
+  const int    Nx    = 400;
+  const double dx    = 1.0/Nx;
+  const double dt    = 0.2*dx;
+  const int    nstep = 0.1/dt;
+
+  NArray<double,2> w(N, Nx+2), u(N, Nx+2);
+  NArray<double,2> fl(N, Nx+1), fr(N, Nx+1), f(N, Nx+1);
+
+  for(int i=0; i < Nx+2 ;i++) {
+    const double *w0 = (i <= Nx/2) ? wl : wr;
+    double uu[N];
+    solver.eq.conserved(w0, uu);
+    for(int v=0; v < N ;v++) {
+      u(v,i) = uu[v];
+    }
+  }
+
+  double mass0 = 0;
+  for(int i=1; i <= Nx ;i++) mass0 += u(E::IRO,i);
+
+  bool positive = true;
+  for(int step=0; step < nstep ;step++) {
+    // primitive variables
+    for(int i=0; i < Nx+2 ;i++) {
+      double ro = u(E::IRO,i);
+      double vx = u(E::IVX,i)/ro;
+      double vy = u(E::IVY,i)/ro;
+      double vz = u(E::IVZ,i)/ro;
+      double bb = 0;
+      for(int v=5; v < N ;v++) bb += u(v,i)*u(v,i);
+      w(E::IRO,i) = ro;
+      w(E::IVX,i) = vx;
+      w(E::IVY,i) = vy;
+      w(E::IVZ,i) = vz;
+      w(E::IPR,i) = (solver.eq.gamma - 1)*
+        (u(E::IPR,i) - 0.5*ro*(vx*vx + vy*vy + vz*vz) - 0.5*bb);
+      for(int v=5; v < N ;v++) w(v,i) = u(v,i);
+    }
+    for(int v=0; v < N ;v++) {
+      for(int i=0; i < Nx+1 ;i++) {
+        fl(v,i) = w(v,i);
+        fr(v,i) = w(v,i+1);
+      }
+    }
+
+    riemann::solve(solver, fl, fr, f);
+
+    for(int v=0; v < N ;v++) {
+      for(int i=1; i <= Nx ;i++) {
+        u(v,i) -= dt/dx*(f(v,i) - f(v,i-1));
+      }
+    }
+    for(int i=1; i <= Nx ;i++) {
+      if( !(u(E::IRO,i) > 0) ) positive = false;
+    }
+  }
+
+  double mass = 0;
+  for(int i=1; i <= Nx ;i++) mass += u(E::IRO,i);
+
+  cout << boost::format("%-6s : mass error = %10.3e, density at 0.6 = %8.5f\n")
+    % name % abs(mass - mass0) % u(E::IRO, (int)(0.6*Nx));
+
+  return positive && abs(mass - mass0) < 1.0e-10*mass0;
+}
+
+int main()
+{
+  using namespace riemann;
+
+  { // consistency
+    cout << "----- consistency -----" << endl;
+
+    bool status = true;
+    status &= check_consistency("HLL", HLL<Hydro>());
+    status &= check_consistency("HLLC", HLLC<Hydro>());
+    status &= check_consistency("HLL", HLL<MHD>());
+    status &= check_consistency("HLLD", HLLD<MHD>());
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // contact discontinuity
+    cout << "----- contact discontinuity -----" << endl;
+
+    double hll  = contact_flux(HLL<Hydro>());
+    double hllc = contact_flux(HLLC<Hydro>());
+    double hlld = contact_flux(HLLD<MHD>());
+    cout << boost::format("mass flux : HLL = %10.3e, HLLC = %10.3e, "
+                          "HLLD = %10.3e\n") % hll % hllc % hlld;
+
+    if( hll > 1.0e-2 && hllc < 1.0e-14 && hlld < 1.0e-14 ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // shock tube
+    cout << "----- shock tube -----" << endl;
+
+    // Sod
+    const double sl[5] = {1.000, 0.0, 0.0, 0.0, 1.0};
+    const double sr[5] = {0.125, 0.0, 0.0, 0.0, 0.1};
+    // Brio & Wu
+    const double bl[8] = {1.000, 0.0, 0.0, 0.0, 1.0, 0.75, +1.0, 0.0};
+    const double br[8] = {0.125, 0.0, 0.0, 0.0, 0.1, 0.75, -1.0, 0.0};
+
+    bool status = true;
+    status &= shock_tube("HLL", HLL<Hydro>(Hydro(1.4)), sl, sr);
+    status &= shock_tube("HLLC", HLLC<Hydro>(Hydro(1.4)), sl, sr);
+    status &= shock_tube("HLL", HLL<MHD>(MHD(2.0)), bl, br);
+    status &= shock_tube("HLLD", HLLD<MHD>(MHD(2.0)), bl, br);
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // batch
+    cout << "----- batch -----" << endl;
+
+    const int n = 1 << 18;
+
+    bool status = true;
+    status &= check_batch("HLL", HLL<Hydro>(), n);
+    status &= check_batch("HLLC", HLLC<Hydro>(), n);
+    status &= check_batch("HLL", HLL<MHD>(), n);
+    status &= check_batch("HLLD", HLLD<MHD>(), n);
+
+    // single precision
+    NArray<float,2> wl(8, 100), wr(8, 100), f(8, 100);
+    for(uint64 i=0; i < wl.getSize() ;i++) {
+      wl.data[i] = 1 + mt.rand();
+      wr.data[i] = 1 + mt.rand();
+    }
+    riemann::solve(HLLD<MHD>(), wl, wr, f);
+    for(uint64 i=0; i < f.getSize() ;i++) {
+      if( !std::isfinite(f.data[i]) ) status = false;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -9,9 +9,12 @@
 /// Author: Takanobu AMANO <amanot@stelab.nagoya-u.ac.jp>
 /// $Id$
 ///
-#define __MAIN__
 #include "boost/format.hpp"
+#include <cmath>
+#include <vector>
 #include "SArray.hpp"
+#include "SArrayMath.hpp"
+#include "SArrayAligned.hpp"
 #include "MersenneTwister.hpp"
 
 using namespace std;
@@ -279,6 +282,161 @@ int main()
     }
   }
 
+  { // compile-time metadata and access operator
+    typedef SArray3D<double,2,3,4> T_array;
+
+    static_assert(T_array::ndim == 3, "ndim is not a constant expression");
+    static_assert(T_array::size == 24, "size is not a constant expression");
+    static_assert(T_array::dims[2] == 4, "dims is not a constant expression");
+    static_assert(T_array::stride[0] == 12 && T_array::stride[1] == 4 &&
+                  T_array::stride[2] == 1, "stride is not correct");
+    static_assert(T_array::offset(1,2,3) == 23, "offset is not correct");
+    static_assert(sizeof(T_array) == 24*sizeof(double),
+                  "SArray should not have any extra data");
+
+    constexpr SArray1D<int,3> c = {{1, 2, 3}};
+    static_assert(c(0) + c(1) + c(2) == 6, "constexpr access failed");
+
+    // flat index beyond the first row
+    constexpr SArray2D<int,2,3> d = {{{1, 2, 3}, {4, 5, 6}}};
+    static_assert(d[3] == 4 && d[5] == 6, "constexpr flat access failed");
+    constexpr SArray3D<int,2,2,2> e = {{{{0, 1}, {2, 3}}, {{4, 5}, {6, 7}}}};
+    static_assert(e[2] == 2 && e[5] == 5 && e[7] == 7,
+                  "constexpr flat access failed");
+
+    cout << "\n"
+         << "*** Testing operator() ...\n"
+         << "    ===> ";
+
+    T_array a;
+    for(size_t i=0; i < T_array::size ;i++) {
+      a.ptr()[i] = rand(0, 100);
+    }
+
+    T_array b = a;
+    bool status = true;
+    for(int i1=0; i1 < 2 ;i1++) {
+      for(int i2=0; i2 < 3 ;i2++) {
+        for(int i3=0; i3 < 4 ;i3++) {
+          if( a(i1,i2,i3) != a.data[i1][i2][i3] ||
+              a(i1,i2,i3) != a[T_array::offset(i1,i2,i3)] ||
+              b(i1,i2,i3) != a(i1,i2,i3) )
+            status = false;
+        }
+      }
+    }
+    if( status ) {
+      cout << "works fine !" << endl;
+    } else {
+      cout << "does not work !" << endl;
+    }
+  }
+
+  { // vector and tensor arithmetic
+    typedef SArray1D<double,3>   T_vector;
+    typedef SArray2D<double,3,3> T_matrix;
+
+    cout << "\n"
+         << "*** Testing arithmetic ...\n"
+         << "    ===> ";
+
+    T_vector a = {{1.0, 2.0, 3.0}};
+    T_vector b = {{-2.0, 0.5, 4.0}};
+    T_matrix m = {{{2.0, 1.0, 0.0}, {1.0, 3.0, 1.0}, {0.0, 1.0, 4.0}}};
+    T_matrix e = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+
+    bool status = true;
+    T_vector c = cross(a, b);
+    T_vector d = 2.0*a - b/2.0;
+    T_vector y = matvec(m, a);
+
+    // cross product is orthogonal to both vectors
+    if( abs(dot(c, a)) > 1.0e-14 || abs(dot(c, b)) > 1.0e-14 )
+      status = false;
+    if( c(0) != 6.5 || c(1) != -10.0 || c(2) != 4.5 )
+      status = false;
+    if( d(0) != 3.0 || d(1) != 3.75 || d(2) != 4.0 )
+      status = false;
+    if( y(0) != 4.0 || y(1) != 10.0 || y(2) != 14.0 )
+      status = false;
+    if( abs(det(m) - 18.0) > 1.0e-14 || trace(m) != 9.0 )
+      status = false;
+
+    // m * inverse(m) = identity
+    T_matrix r = matmul(m, inverse(m)) - e;
+    for(size_t i=0; i < T_matrix::size ;i++) {
+      if( abs(r[i]) > 1.0e-14 ) status = false;
+    }
+
+    // 2x2 and transpose
+    SArray2D<double,2,2> m2 = {{{4.0, 7.0}, {2.0, 6.0}}};
+    SArray2D<double,2,2> r2 = matmul(inverse(m2), m2);
+    if( abs(r2(0,0) - 1) > 1.0e-14 || abs(r2(0,1)) > 1.0e-14 ||
+        abs(r2(1,0)) > 1.0e-14 || abs(r2(1,1) - 1) > 1.0e-14 )
+      status = false;
+    if( transpose(m2)(0,1) != 2.0 || det(m2) != 10.0 )
+      status = false;
+
+    if( status ) {
+      cout << "works fine !" << endl;
+    } else {
+      cout << "does not work !" << endl;
+    }
+  }
+
+  { // aligned array with padding
+    typedef SArrayAligned3D<double,3,5,6,CACHE_LINE_BYTES> T_array;
+
+    static_assert(T_array::padded == 8, "padding is not correct");
+    static_assert(T_array::stride[0] == 40 && T_array::stride[1] == 8,
+                  "stride is not correct");
+    static_assert(T_array::offset(1,2,3) == 59, "offset is not correct");
+    static_assert(sizeof(T_array) == T_array::storage*sizeof(double),
+                  "SArrayAligned should not have any extra data");
+    static_assert(alignof(T_array) == CACHE_LINE_BYTES,
+                  "alignment is not correct");
+    static_assert(SArrayAligned1D<float,5>::padded ==
+                  SIMD_BYTES/sizeof(float), "padding is not correct");
+
+    cout << "\n"
+         << "*** Testing aligned array ...\n"
+         << "    ===> ";
+
+    const int N1 = 7;
+    const int N2 = 9;
+    vector<double> src(3*N1*N2), dst(3*N1*N2, 0.0);
+    for(size_t i=0; i < src.size() ;i++) {
+      src[i] = rand(0, 100);
+    }
+
+    T_array a;
+    a.fill(-1.0);
+    a.load(&src[0], N1*N2, N2);
+    a.store(&dst[0], N1*N2, N2);
+
+    bool status = true;
+    for(int i1=0; i1 < 3 ;i1++) {
+      for(int i2=0; i2 < 5 ;i2++) {
+        if( !simd::is_aligned(a.row(i1,i2), CACHE_LINE_BYTES) )
+          status = false;
+        for(int i3=0; i3 < 6 ;i3++) {
+          int ii = i1*N1*N2 + i2*N2 + i3;
+          if( a(i1,i2,i3) != src[ii] || dst[ii] != src[ii] ||
+              a.ptr()[T_array::offset(i1,i2,i3)] != src[ii] )
+            status = false;
+        }
+        // padding is left untouched
+        if( a(i1,i2,6) != -1.0 || a(i1,i2,7) != -1.0 )
+          status = false;
+      }
+    }
+    if( status ) {
+      cout << "works fine !" << endl;
+    } else {
+      cout << "does not work !" << endl;
+    }
+  }
+
   return 0;
 }
 
@@ -0,0 +1,148 @@
+// -*- C++ -*-
+
+///
+/// @file TestSArrayBatch.cpp
+/// @brief Test code for SArrayBatch1D and SArrayBatch2D classes
+///
+/// This code demonstrates how to use batched kernels on SArrayBatch?D.
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "SArrayBatch.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+int main()
+{
+  const int M = 1001;
+  const int N = 5;
+  const double tolerance = 1.0e-10;
+
+  { // linear system
+    SArrayBatch2D<double,N,N> a(M);
+    SArrayBatch2D<double,N,N> a0(M);
+    SArrayBatch1D<double,N>   x(M);
+    SArrayBatch1D<double,N>   b(M);
+
+    for(int n=0; n < M ;n++) {
+      for(int i=0; i < N ;i++) {
+        for(int j=0; j < N ;j++) {
+          a(n,i,j) = a0(n,i,j) = mt.rand() - 0.5;
+        }
+        x(n,i) = b(n,i) = mt.rand() - 0.5;
+      }
+    }
+
+    cout << "----- solve -----" << endl;
+    sarraybatch::solve(a, x);
+
+    // residual
+    double error = 0.0;
+    for(int n=0; n < M ;n++) {
+      for(int i=0; i < N ;i++) {
+        double r = -b(n,i);
+        for(int j=0; j < N ;j++) {
+          r += a0(n,i,j) * x(n,j);
+        }
+        error = max(error, abs(r));
+      }
+    }
+    cout << boost::format("maximum residual = %12.5e\n") % error;
+    if( error < tolerance ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // inverse
+    SArrayBatch2D<double,N,N> a(M);
+    SArrayBatch2D<double,N,N> a0(M);
+    SArrayBatch2D<double,N,N> ainv(M);
+
+    for(int n=0; n < M ;n++) {
+      SArray2D<double,N,N> e;
+      for(int i=0; i < N ;i++) {
+        for(int j=0; j < N ;j++) {
+          e(i,j) = mt.rand() - 0.5;
+        }
+      }
+      a.load(n, e);
+      a0.load(n, e);
+    }
+
+    cout << "----- inverse -----" << endl;
+    sarraybatch::inverse(a, ainv);
+
+    double error = 0.0;
+    for(int n=0; n < M ;n++) {
+      for(int i=0; i < N ;i++) {
+        for(int j=0; j < N ;j++) {
+          double r = (i == j) ? -1.0 : 0.0;
+          for(int k=0; k < N ;k++) {
+            r += a0(n,i,k) * ainv(n,k,j);
+          }
+          error = max(error, abs(r));
+        }
+      }
+    }
+    cout << boost::format("maximum error    = %12.5e\n") % error;
+    if( error < tolerance ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // symmetric eigenvalue problem
+    SArrayBatch2D<double,N,N> a(M);
+    SArrayBatch2D<double,N,N> a0(M);
+    SArrayBatch2D<double,N,N> v(M);
+    SArrayBatch1D<double,N>   w(M);
+
+    for(int n=0; n < M ;n++) {
+      for(int i=0; i < N ;i++) {
+        for(int j=0; j <= i ;j++) {
+          a(n,i,j) = a(n,j,i) = mt.rand() - 0.5;
+          a0(n,i,j) = a0(n,j,i) = a(n,i,j);
+        }
+      }
+    }
+
+    cout << "----- eigen -----" << endl;
+    sarraybatch::eigen(a, w, v);
+
+    // check A v = lambda v and ascending order
+    double error = 0.0;
+    bool   order = true;
+    for(int n=0; n < M ;n++) {
+      for(int k=0; k < N ;k++) {
+        for(int i=0; i < N ;i++) {
+          double r = -w(n,k) * v(n,i,k);
+          for(int j=0; j < N ;j++) {
+            r += a0(n,i,j) * v(n,j,k);
+          }
+          error = max(error, abs(r));
+        }
+        if( k > 0 && w(n,k-1) > w(n,k) ) order = false;
+      }
+    }
+    cout << boost::format("maximum residual = %12.5e\n") % error;
+    if( error < tolerance && order ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,259 @@
+// -*- C++ -*-
+
+///
+/// @file TestSparse.cpp
+/// @brief Test code for sparse matrix formats and SpMV
+///
+/// $Id$
+///
+#include <cmath>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "sparse.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// variable-coefficient 7-point operator on N^3 grid (Dirichlet) in triplets
+void laplacian(const int N, vector<int64> &row, vector<int32> &col,
+               vector<double> &val)
+{
+  const int offset[6][3] = {{-1, 0, 0}, {+1, 0, 0}, {0, -1, 0},
+                            {0, +1, 0}, {0, 0, -1}, {0, 0, +1}};
+
+  for(int i=0; i < N ;i++) {
+    for(int j=0; j < N ;j++) {
+      for(int k=0; k < N ;k++) {
+        const int64 p = (i*N + j)*N + k;
+        double diag = 0;
+        for(int d=0; d < 6 ;d++) {
+          const int ii = i + offset[d][0];
+          const int jj = j + offset[d][1];
+          const int kk = k + offset[d][2];
+          const double c = 1 + 0.5*sin(0.1*(i+j+k+d));
+          diag += c;
+          if( ii < 0 || ii >= N || jj < 0 || jj >= N || kk < 0 || kk >= N ) {
+            continue;
+          }
+          row.push_back(p);
+          col.push_back((ii*N + jj)*N + kk);
+          val.push_back(-c);
+        }
+        row.push_back(p);
+        col.push_back(p);
+        val.push_back(diag);
+      }
+    }
+  }
+}
+
+// rectangular matrix with random row lengths and duplicates in random order
+void random_matrix(const int nrow, const int ncol, vector<int64> &row,
+                   vector<int32> &col, vector<double> &val)
+{
+  for(int i=0; i < nrow ;i++) {
+    const int n = (i % 17 == 0) ? 0 : mt.rand32() % 40;
+    for(int j=0; j < n ;j++) {
+      row.push_back(i);
+      col.push_back(mt.rand32() % ncol);
+      val.push_back(2*mt.rand() - 1);
+    }
+  }
+  // shuffle
+  for(int64 p=row.size()-1; p > 0 ;p--) {
+    const int64 q = mt.rand32() % (p + 1);
+    swap(row[p], row[q]);
+    swap(col[p], col[q]);
+    swap(val[p], val[q]);
+  }
+}
+
+// maximum error of CSR and SELL-C-sigma against product by triplets
+template <int C>
+double check(const int nrow, const int ncol, const vector<int64> &row,
+             const vector<int32> &col, const vector<double> &val,
+             const int sigma, const bool numa)
+{
+  NArray<double,1> x(ncol);
+  NArray<double,1> y(nrow);
+  NArray<double,1> z(nrow);
+
+  for(int i=0; i < ncol ;i++) {
+    x(i) = 2*mt.rand() - 1;
+  }
+  for(int i=0; i < nrow ;i++) {
+    z(i) = 0;
+  }
+  for(size_t p=0; p < row.size() ;p++) {
+    z(row[p]) += val[p] * x(col[p]);
+  }
+
+  sparse::CSR<double> a(nrow, ncol, row, col, val, numa);
+  sparse::SELL<double,C> b(a, sigma, numa);
+
+  double err = 0;
+
+  sparse::spmv(a, x, y);
+  for(int i=0; i < nrow ;i++) {
+    err = max(err, abs(y(i) - z(i)));
+  }
+
+  sparse::touch(b, y);
+  sparse::spmv(b, x, y);
+  for(int i=0; i < nrow ;i++) {
+    err = max(err, abs(y(i) - z(i)));
+  }
+
+  // touch() should zero-fill vectors of both sizes
+  NArray<double,1> w(ncol);
+  for(int i=0; i < ncol ;i++) {
+    w(i) = 1;
+  }
+  sparse::touch(a, w);
+  for(int i=0; i < ncol ;i++) {
+    err = max(err, abs(w(i)));
+  }
+  for(int i=0; i < ncol ;i++) {
+    w(i) = 1;
+  }
+  sparse::touch(b, w);
+  for(int i=0; i < ncol ;i++) {
+    err = max(err, abs(w(i)));
+  }
+
+  return err;
+}
+
+// bandwidth in GB/s of SpMV streaming nnz entries and vectors
+template <class Matrix>
+double bandwidth(const Matrix &a, const int64 nnz, const int nloop)
+{
+  const int64 nrow = a.getRows();
+  const int64 ncol = a.getCols();
+  NArray<double,1> x(ncol);
+  NArray<double,1> y(nrow);
+
+  sparse::touch(a, x);
+  sparse::touch(a, y);
+  for(int64 i=0; i < ncol ;i++) {
+    x(i) = 1;
+  }
+
+  sparse::spmv(a, x, y);
+  double t0 = common::etime();
+  for(int n=0; n < nloop ;n++) {
+    sparse::spmv(a, x, y);
+  }
+  double t1 = common::etime();
+
+  const double bytes = nnz*(sizeof(double) + sizeof(int32)) +
+    (nrow + ncol)*sizeof(double);
+  return bytes*nloop / (t1 - t0) * 1.0e-9;
+}
+
+int main()
+{
+  { // accuracy
+    cout << "----- accuracy -----" << endl;
+
+    bool status = true;
+
+    {
+      const int N = 12;
+      vector<int64>  row;
+      vector<int32>  col;
+      vector<double> val;
+      laplacian(N, row, col, val);
+
+      double err = 0;
+      err = max(err, check<4>(N*N*N, N*N*N, row, col, val, 1, false));
+      err = max(err, check<8>(N*N*N, N*N*N, row, col, val, 64, true));
+      cout << boost::format("laplacian : error = %10.3e\n") % err;
+      status &= err < 1.0e-13;
+    }
+
+    {
+      const int nrow = 1001;
+      const int ncol = 777;
+      vector<int64>  row;
+      vector<int32>  col;
+      vector<double> val;
+      random_matrix(nrow, ncol, row, col, val);
+
+      double err = 0;
+      err = max(err, check<4>(nrow, ncol, row, col, val, 1, true));
+      err = max(err, check<8>(nrow, ncol, row, col, val, 100, false));
+      err = max(err, check<16>(nrow, ncol, row, col, val, 5000, true));
+
+      // wide matrix
+      row.clear();
+      col.clear();
+      val.clear();
+      random_matrix(ncol/2, nrow, row, col, val);
+      err = max(err, check<8>(ncol/2, nrow, row, col, val, 100, true));
+      cout << boost::format("random    : error = %10.3e\n") % err;
+      status &= err < 1.0e-13;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 96;
+    const int nloop = 20;
+    const int64 size = N*N*N;
+    vector<int64>  row;
+    vector<int32>  col;
+    vector<double> val;
+    laplacian(N, row, col, val);
+
+    sparse::CSR<double> a(size, size, row, col, val, true);
+    sparse::SELL<double> b(a, sparse::SIGMA, true);
+    const int64 nnz = a.getNonZeros();
+
+    // reference: stream triad
+    NArray<double,1> x(size), y(size), z(size);
+    for(int64 i=0; i < size ;i++) {
+      x(i) = 1;
+      y(i) = 2;
+      z(i) = 0;
+    }
+    double t0 = common::etime();
+    for(int n=0; n < nloop ;n++) {
+#pragma omp parallel for simd
+      for(int64 i=0; i < size ;i++) {
+        z(i) = x(i) + 0.5*y(i);
+      }
+    }
+    double t1 = common::etime();
+    const double triad = 3*sizeof(double)*size*nloop / (t1 - t0) * 1.0e-9;
+
+    // SpMV bandwidth relative to triad with the same number of threads
+    const double bw_csr  = bandwidth(a, nnz, nloop);
+    const double bw_sell = bandwidth(b, nnz, nloop);
+
+    cout << boost::format("nnz = %d, padding (SELL) = %5.2f %%, threads = %d\n")
+      % nnz % (100.0*(b.getStorage() - nnz)/nnz) % sparse::get_num_threads();
+    cout << boost::format("triad : %7.2f [GB/s]\n") % triad;
+    cout << boost::format("CSR   : %7.2f [GB/s] (%5.1f %% of triad)\n")
+      % bw_csr % (100*bw_csr/triad);
+    cout << boost::format("SELL  : %7.2f [GB/s] (%5.1f %% of triad)\n")
+      % bw_sell % (100*bw_sell/triad);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
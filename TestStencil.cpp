@@ -0,0 +1,301 @@
+// -*- C++ -*-
+
+///
+/// @file TestStencil.cpp
+/// @brief Test code for cache-blocked 3D stencil driver
+///
+/// $Id$
+///
+#include <cmath>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "stencil.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// reference 7-point Laplacian with plain triple loop
+void laplacian_ref(NArray<double,3> &u, NArray<double,3> &v)
+{
+  const int N1 = u.shape[0];
+  const int N2 = u.shape[1];
+  const int N3 = u.shape[2];
+
+#pragma omp parallel for
+  for(int i=1; i < N1-1 ;i++) {
+    for(int j=1; j < N2-1 ;j++) {
+      for(int k=1; k < N3-1 ;k++) {
+        v(i,j,k) = u(i-1,j,k) + u(i+1,j,k) + u(i,j-1,k) + u(i,j+1,k)
+          + u(i,j,k-1) + u(i,j,k+1) - 6*u(i,j,k);
+      }
+    }
+  }
+}
+
+// 7-point Laplacian with stencil driver
+void laplacian(NArray<double,3> &u, NArray<double,3> &v)
+{
+  stencil::sweep<1>(u, [&](int i, int j, int k)
+                    {
+                      v(i,j,k) = u(i-1,j,k) + u(i+1,j,k) + u(i,j-1,k)
+                        + u(i,j+1,k) + u(i,j,k-1) + u(i,j,k+1) - 6*u(i,j,k);
+                    });
+}
+
+// Jacobi iteration for Laplace equation
+struct Jacobi
+{
+  void operator()(const stencil::View<double> &in,
+                  const stencil::View<double> &out, int i, int j, int k) const
+  {
+    out(i,j,k) = (in(i-1,j,k) + in(i+1,j,k) + in(i,j-1,k) + in(i,j+1,k) +
+                  in(i,j,k-1) + in(i,j,k+1)) / 6;
+  }
+} jacobi;
+
+// reference Jacobi iteration with plain triple loop
+void jacobi_ref(NArray<double,3> &u, NArray<double,3> &v)
+{
+  const int N1 = u.shape[0];
+  const int N2 = u.shape[1];
+  const int N3 = u.shape[2];
+
+#pragma omp parallel for
+  for(int i=1; i < N1-1 ;i++) {
+    for(int j=1; j < N2-1 ;j++) {
+      for(int k=1; k < N3-1 ;k++) {
+        v(i,j,k) = (u(i-1,j,k) + u(i+1,j,k) + u(i,j-1,k) + u(i,j+1,k) +
+                    u(i,j,k-1) + u(i,j,k+1)) / 6;
+      }
+    }
+  }
+}
+
+// return true if two arrays are identical within a range
+bool compare(NArray<double,3> &a, NArray<double,3> &b,
+             const loopnest::Range<3> &r)
+{
+  bool status = true;
+  for(int i=r.lo[0]; i < r.hi[0] ;i++) {
+    for(int j=r.lo[1]; j < r.hi[1] ;j++) {
+      for(int k=r.lo[2]; k < r.hi[2] ;k++) {
+        if( abs(a(i,j,k) - b(i,j,k)) > 1.0e-12 ) status = false;
+      }
+    }
+  }
+  return status;
+}
+
+int main()
+{
+  const int N1 = 66;
+  const int N2 = 70;
+  const int N3 = 130;
+
+  NArray<double,3> u(N1, N2, N3);
+  NArray<double,3> v(N1, N2, N3);
+  NArray<double,3> w(N1, N2, N3);
+
+  for(uint64 i=0; i < u.getSize() ;i++) {
+    u.data[i] = mt.rand();
+    v.data[i] = 0;
+    w.data[i] = 0;
+  }
+
+  { // 7-point stencil on ghosted array
+    cout << "----- 7-point stencil -----" << endl;
+
+    laplacian_ref(u, v);
+    laplacian(u, w);
+
+    if( compare(v, w, loopnest::range(u, 1)) ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // 27-point stencil on a slice with explicit tiling
+    cout << "----- 27-point stencil on slice -----" << endl;
+
+    loopnest::Range<3> r = {{3, 10, 5}, {40, 61, 120}};
+    stencil::Tiling t = {{5, 7, 32}};
+
+    stencil::sweep(r, t, [&](int i, int j, int k)
+                   {
+                     double s = 0;
+                     for(int ii=-1; ii <= 1 ;ii++) {
+                       for(int jj=-1; jj <= 1 ;jj++) {
+                         for(int kk=-1; kk <= 1 ;kk++) {
+                           s += u(i+ii,j+jj,k+kk);
+                         }
+                       }
+                     }
+                     w(i,j,k) = s/27;
+                   });
+
+    bool status = true;
+    for(int i=r.lo[0]; i < r.hi[0] ;i++) {
+      for(int j=r.lo[1]; j < r.hi[1] ;j++) {
+        for(int k=r.lo[2]; k < r.hi[2] ;k++) {
+          double s = 0;
+          for(int ii=-1; ii <= 1 ;ii++) {
+            for(int jj=-1; jj <= 1 ;jj++) {
+              for(int kk=-1; kk <= 1 ;kk++) {
+                s += u(i+ii,j+jj,k+kk);
+              }
+            }
+          }
+          if( abs(w(i,j,k) - s/27) > 1.0e-12 ) status = false;
+        }
+      }
+    }
+    // outside of the slice is untouched
+    if( !compare(v, w, loopnest::Range<3>{{1, 1, 1}, {3, N2-1, N3-1}}) )
+      status = false;
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // fused reduction
+    cout << "----- fused reduction -----" << endl;
+
+    // reference with plain triple loop
+    double vmax = -1.0e+30;
+    double vmin = +1.0e+30;
+    for(int i=1; i < N1-1 ;i++) {
+      for(int j=1; j < N2-1 ;j++) {
+        for(int k=1; k < N3-1 ;k++) {
+          double g = abs(u(i+1,j,k) - u(i-1,j,k)) + u(i,j,k);
+          vmax = max(vmax, g);
+          vmin = min(vmin, 1/g);
+        }
+      }
+    }
+
+    // maximum with side effect
+    double smax = stencil::sweep_max<1>(u, [&](int i, int j, int k)
+                                        {
+                                          double g = abs(u(i+1,j,k) -
+                                                         u(i-1,j,k)) +
+                                            u(i,j,k);
+                                          w(i,j,k) = g;
+                                          return g;
+                                        });
+    // minimum
+    double smin = stencil::sweep_min<1>(u, [&](int i, int j, int k)
+                                        {
+                                          return 1/w(i,j,k);
+                                        });
+    // empty range
+    loopnest::Range<3> r = {{1, 1, 1}, {1, N2-1, N3-1}};
+    double empty = stencil::sweep_max(r, stencil::tiling<double>(r, 1),
+                                      [&](int i, int j, int k)
+                                      {
+                                        return u(i,j,k);
+                                      });
+
+    cout << boost::format("max = %12.5e (ref = %12.5e)\n") % smax % vmax;
+    cout << boost::format("min = %12.5e (ref = %12.5e)\n") % smin % vmin;
+
+    double w0 = abs(u(2,1,1) - u(0,1,1)) + u(1,1,1);
+    if( smax == vmax && smin == vmin && w(1,1,1) == w0 &&
+        empty == std::numeric_limits<double>::lowest() ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // temporal blocking
+    cout << "----- temporal blocking -----" << endl;
+
+    const int nstep = 7;
+    NArray<double,3> x(N1, N2, N3);
+    NArray<double,3> y(N1, N2, N3);
+    for(uint64 i=0; i < u.getSize() ;i++) {
+      v.data[i] = u.data[i];
+      w.data[i] = u.data[i];
+      x.data[i] = u.data[i];
+    }
+
+    // reference: plain sweeps (ghost cells of w are fixed)
+    for(int n=0; n < nstep ;n++) {
+      jacobi_ref(v, w);
+      jacobi_ref(w, v);
+    }
+
+    bool status = true;
+    for(int tblock=1; tblock <= 4 ;tblock++) {
+      for(uint64 i=0; i < u.getSize() ;i++) {
+        x.data[i] = u.data[i];
+      }
+      stencil::iterate<1>(x, y, 2*nstep, jacobi, tblock);
+      if( !compare(v, x, loopnest::range(u)) ) status = false;
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int nloop = 20;
+    double t0, t1, t2, t3, t4;
+
+    t0 = common::etime();
+    for(int n=0; n < nloop ;n++) laplacian_ref(u, v);
+    t1 = common::etime();
+    for(int n=0; n < nloop ;n++) laplacian(u, w);
+    t2 = common::etime();
+
+    cout << boost::format("plain loop     : %10.5f [sec]\n") % (t1 - t0);
+    cout << boost::format("stencil driver : %10.5f [sec]\n") % (t2 - t1);
+
+    // iterated stencil on larger grid
+    const int M = 194;
+    const int nstep = 16;
+    NArray<double,3> x(M, M, M);
+    NArray<double,3> y(M, M, M);
+    for(uint64 i=0; i < x.getSize() ;i++) {
+      x.data[i] = mt.rand();
+      y.data[i] = x.data[i];
+    }
+
+    t0 = common::etime();
+    for(int n=0; n < nstep/2 ;n++) {
+      jacobi_ref(x, y);
+      jacobi_ref(y, x);
+    }
+    t1 = common::etime();
+    stencil::iterate<1>(x, y, nstep, jacobi, 1);
+    t2 = common::etime();
+    stencil::iterate<1>(x, y, nstep, jacobi, 4);
+    t3 = common::etime();
+    stencil::iterate<1>(x, y, nstep, jacobi, 8);
+    t4 = common::etime();
+
+    cout << boost::format("%d iterations of %d^3 grid\n") % nstep % M;
+    cout << boost::format("plain loop     : %10.5f [sec]\n") % (t1 - t0);
+    cout << boost::format("tblock = 1     : %10.5f [sec]\n") % (t2 - t1);
+    cout << boost::format("tblock = 4     : %10.5f [sec]\n") % (t3 - t2);
+    cout << boost::format("tblock = 8     : %10.5f [sec]\n") % (t4 - t3);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
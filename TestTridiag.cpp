@@ -0,0 +1,199 @@
+// -*- C++ -*-
+
+///
+/// @file TestTridiag.cpp
+/// @brief Test code for batched tridiagonal solver
+///
+/// $Id$
+///
+#include <cmath>
+#include <vector>
+#include "boost/format.hpp"
+#include "common.hpp"
+#include "NArray.hpp"
+#include "tridiag.hpp"
+#include "MersenneTwister.hpp"
+
+using namespace std;
+static MersenneTwister mt;
+
+// random diagonally dominant coefficients
+void random_system(NArray<double,3> &a, NArray<double,3> &b,
+                   NArray<double,3> &c, NArray<double,3> &d)
+{
+  for(uint64 i=0; i < d.getSize() ;i++) {
+    a.data[i] = -mt.rand();
+    c.data[i] = -mt.rand();
+    b.data[i] = 2.5 + mt.rand();
+    d.data[i] = 2*mt.rand() - 1;
+  }
+}
+
+// maximum residual of solution x along axis
+double residual(NArray<double,3> &a, NArray<double,3> &b,
+                NArray<double,3> &c, NArray<double,3> &d,
+                NArray<double,3> &x, const int axis, const bool periodic)
+{
+  const int N1 = d.shape[0];
+  const int N2 = d.shape[1];
+  const int N3 = d.shape[2];
+  const int n  = d.shape[axis];
+  const int e[3] = {axis == 0, axis == 1, axis == 2};
+
+  double res = 0;
+  for(int i=0; i < N1 ;i++) {
+    for(int j=0; j < N2 ;j++) {
+      for(int k=0; k < N3 ;k++) {
+        const int p = (axis == 0) ? i : (axis == 1) ? j : k;
+        // neighbors with periodic index
+        const int pm = (p - 1 + n) % n - p;
+        const int pp = (p + 1) % n - p;
+        double r = b(i,j,k)*x(i,j,k) - d(i,j,k);
+        if( p > 0 || periodic ) {
+          r += a(i,j,k)*x(i+pm*e[0], j+pm*e[1], k+pm*e[2]);
+        }
+        if( p < n-1 || periodic ) {
+          r += c(i,j,k)*x(i+pp*e[0], j+pp*e[1], k+pp*e[2]);
+        }
+        res = max(res, abs(r));
+      }
+    }
+  }
+
+  return res;
+}
+
+// scalar Thomas algorithm along a strided line
+void thomas_ref(const double *a, const double *b, const double *c, double *d,
+                double *w, const int n, const int stride)
+{
+  w[0] = c[0]/b[0];
+  d[0] = d[0]/b[0];
+  for(int i=1; i < n ;i++) {
+    double r = 1/(b[i*stride] - a[i*stride]*w[i-1]);
+    w[i] = c[i*stride]*r;
+    d[i*stride] = (d[i*stride] - a[i*stride]*d[(i-1)*stride])*r;
+  }
+  for(int i=n-2; i >= 0 ;i--) {
+    d[i*stride] -= w[i]*d[(i+1)*stride];
+  }
+}
+
+int main()
+{
+  { // residual for each axis
+    cout << "----- residual -----" << endl;
+
+    const int N1 = 19;
+    const int N2 = 23;
+    const int N3 = 300;
+
+    NArray<double,3> a(N1, N2, N3);
+    NArray<double,3> b(N1, N2, N3);
+    NArray<double,3> c(N1, N2, N3);
+    NArray<double,3> d(N1, N2, N3);
+    NArray<double,3> x(N1, N2, N3);
+    random_system(a, b, c, d);
+
+    bool status = true;
+    for(int periodic=0; periodic < 2 ;periodic++) {
+      for(int axis=0; axis < 3 ;axis++) {
+        for(uint64 i=0; i < d.getSize() ;i++) {
+          x.data[i] = d.data[i];
+        }
+        tridiag::solve(a, b, c, x, axis, periodic);
+
+        double res = residual(a, b, c, d, x, axis, periodic);
+        cout << boost::format("periodic = %d, axis = %d : residual = %10.3e\n")
+          % periodic % axis % res;
+        status &= res < 1.0e-13;
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // single precision and 2D array
+    cout << "----- float -----" << endl;
+
+    const int N1 = 50;
+    const int N2 = 70;
+    NArray<float,2> a(N1, N2), b(N1, N2), c(N1, N2), d(N1, N2), x(N1, N2);
+    for(uint64 i=0; i < d.getSize() ;i++) {
+      a.data[i] = -1;
+      b.data[i] = +3;
+      c.data[i] = -1;
+      d.data[i] = 1;
+    }
+
+    bool status = true;
+    for(int axis=0; axis < 2 ;axis++) {
+      // periodic system with constant coefficients gives x = 1
+      for(uint64 i=0; i < d.getSize() ;i++) {
+        x.data[i] = d.data[i];
+      }
+      tridiag::solve(a, b, c, x, axis, true);
+      for(uint64 i=0; i < d.getSize() ;i++) {
+        if( abs(x.data[i] - 1) > 1.0e-5 ) status = false;
+      }
+    }
+
+    if( status ) {
+      cout << "===> works fine !" << endl;
+    } else {
+      cout << "===> does not work !" << endl;
+    }
+  }
+
+  { // performance
+    cout << "----- performance -----" << endl;
+
+    const int N = 128;
+    const int nloop = 10;
+
+    NArray<double,3> a(N, N, N);
+    NArray<double,3> b(N, N, N);
+    NArray<double,3> c(N, N, N);
+    NArray<double,3> d(N, N, N);
+    random_system(a, b, c, d);
+
+    for(int axis=0; axis < 3 ;axis++) {
+      const int stride = (axis == 0) ? N*N : (axis == 1) ? N : 1;
+      double t0, t1, t2;
+      vector<double> w(N);
+
+      // one line at a time
+      t0 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        for(int i=0; i < N ;i++) {
+          for(int j=0; j < N ;j++) {
+            int ip = (axis == 0) ? i*N + j : (axis == 1) ? i*N*N + j :
+              (i*N + j)*N;
+            thomas_ref(&a.data[ip], &b.data[ip], &c.data[ip], &d.data[ip],
+                       w.data(), N, stride);
+          }
+        }
+      }
+      t1 = common::etime();
+      for(int n=0; n < nloop ;n++) {
+        tridiag::solve(a, b, c, d, axis);
+      }
+      t2 = common::etime();
+
+      cout << boost::format("axis = %d : line by line %8.5f [sec], "
+                            "batched %8.5f [sec]\n")
+        % axis % (t1 - t0) % (t2 - t1);
+    }
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
@@ -0,0 +1,280 @@
+// -*- C++ -*-
+#ifndef _BOUNDARY_HPP_
+#define _BOUNDARY_HPP_
+
+///
+/// Physical Boundary Conditions for Ghosted NArray
+///
+/// Ghost cells of nb layers at a face of NArray of any rank are filled by a
+/// boundary operator. As in reconstruction.hpp, the array is regarded as
+/// [n0][n1][n2] with n1 along the axis normal to the face. The ghost cells
+/// at the lower face are 0 <= i < nb and those at the upper face are n1-nb
+/// <= i < n1; the others are interior (including those filled by the halo
+/// exchange).
+///
+/// An operator is a pointwise function object returning the value of the
+/// g-th ghost cell (g = 1, ..., nb counted outward from the face) in terms
+/// of the interior values a(d) at distance d = 0, 1, ... inward from the
+/// face, and a.opposite(d) from the opposite face:
+///
+///   Periodic       : a.opposite(g-1)
+///   Reflect(s)     : s a(g-1), with a sign s for each component
+///   ZeroGradient   : a(0)
+///   Extrapolate    : (g+1) a(0) - g a(1)
+///   Dirichlet(v)   : 2 v - a(g-1)           (value v at the face)
+///   Neumann(q, h)  : a(g-1) + (2g-1) h q    (outward derivative q)
+///
+/// Any functor of the same form (see Operator) may be used. apply() loops
+/// over the face with OpenMP threads across blocks of the face and "omp
+/// simd" along the contiguous dimension; for the last axis, the vectorized
+/// loop runs across lines with stride n1. Edges and corners are filled when
+/// the faces are applied one axis after another, since a face includes the
+/// ghost cells of the other axes.
+///
+/// Faces at a physical boundary of a decomposed domain are selected with
+/// mpiutils neighbors by boundary::Condition in mpiboundary.hpp.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace boundary
+{
+/// side of face
+enum { LOWER = 0, UPPER = 1 };
+
+/// number of elements of a face processed by a thread at once
+enum { BLOCK = 1024 };
+
+///
+/// @class Point boundary.hpp
+/// @brief interior values along the normal at a point of a face
+///
+template <class T>
+struct Point
+{
+  const T* RESTRICT p; ///< adjacent interior cell
+  const T* RESTRICT q; ///< adjacent interior cell of opposite face
+  int64 s;             ///< inward step
+
+  /// value at distance d inward from the face
+  T operator()(const int d) const
+  {
+    return p[d*s];
+  }
+
+  /// value at distance d inward from the opposite face
+  T opposite(const int d) const
+  {
+    return q[-d*s];
+  }
+};
+
+///
+/// @class Operator boundary.hpp
+/// @brief base of boundary operators
+///
+/// setup() is called by apply() with the shape of the array and the axis
+/// before the operator is applied to a face, and operator()(a, g, i0, i2)
+/// returns the value of the ghost cell g at (i0, i2) of the face.
+///
+struct Operator
+{
+  void setup(const uint64 *, const int, const int)
+  {
+  }
+};
+
+/// periodic (within the array)
+struct Periodic : public Operator
+{
+  template <class T>
+  T operator()(const Point<T> &a, const int g, const int64,
+               const int64) const
+  {
+    return a.opposite(g-1);
+  }
+};
+
+/// mirror with a sign flip for each component
+template <class T>
+class Reflect : public Operator
+{
+private:
+  std::vector<T> m_comp;
+  int            m_axis;
+  std::vector<T> m_sign0;
+  std::vector<T> m_sign2;
+
+public:
+  /// uniform sign
+  Reflect(const T sign) : m_comp(1, sign), m_axis(-1)
+  {
+  }
+
+  /// sign[c] for component c along the axis comp_axis of the array
+  Reflect(const T *sign, const int ncomp, const int comp_axis)
+    : m_comp(sign, sign+ncomp), m_axis(comp_axis)
+  {
+  }
+
+  // tables of sign for i0 and i2 of the face
+  void setup(const uint64 *shape, const int rank, const int axis)
+  {
+    int64 n0 = 1, n2 = 1;
+    for(int d=0; d < axis ;d++) n0 *= shape[d];
+    for(int d=axis+1; d < rank ;d++) n2 *= shape[d];
+
+    m_sign0.assign(n0, 1);
+    m_sign2.assign(n2, m_axis < 0 ? m_comp[0] : 1);
+    if( m_axis < 0 || m_axis == axis ) return;
+
+    // stride of components in the flat index i0 or i2
+    int64 stride = 1;
+    const int last = (m_axis < axis) ? axis : rank;
+    for(int d=m_axis+1; d < last ;d++) stride *= shape[d];
+    const int64 nc = shape[m_axis];
+    std::vector<T> &s = (m_axis < axis) ? m_sign0 : m_sign2;
+    for(size_t i=0; i < s.size() ;i++) {
+      s[i] = m_comp[(i / stride) % nc];
+    }
+  }
+
+  T operator()(const Point<T> &a, const int g, const int64 i0,
+               const int64 i2) const
+  {
+    return m_sign0[i0] * m_sign2[i2] * a(g-1);
+  }
+};
+
+/// zero normal gradient (copy of adjacent interior cell)
+struct ZeroGradient : public Operator
+{
+  template <class T>
+  T operator()(const Point<T> &a, const int, const int64,
+               const int64) const
+  {
+    return a(0);
+  }
+};
+
+/// linear extrapolation from two interior cells
+struct Extrapolate : public Operator
+{
+  template <class T>
+  T operator()(const Point<T> &a, const int g, const int64,
+               const int64) const
+  {
+    return (g+1)*a(0) - g*a(1);
+  }
+};
+
+/// fixed value at the face
+template <class T>
+struct Dirichlet : public Operator
+{
+  T value;
+
+  Dirichlet(const T v) : value(v)
+  {
+  }
+
+  T operator()(const Point<T> &a, const int g, const int64,
+               const int64) const
+  {
+    return 2*value - a(g-1);
+  }
+};
+
+/// fixed outward normal derivative at the face with grid spacing h
+template <class T>
+struct Neumann : public Operator
+{
+  T flux;
+
+  Neumann(const T q, const T h) : flux(q*h)
+  {
+  }
+
+  T operator()(const Point<T> &a, const int g, const int64,
+               const int64) const
+  {
+    return a(g-1) + (2*g-1)*flux;
+  }
+};
+
+///
+/// @brief fill nb layers of ghost cells at a face with an operator
+///
+/// @param[in,out] x    array
+/// @param[in]     axis axis normal to the face
+/// @param[in]     side LOWER or UPPER
+/// @param[in]     nb   number of ghost cells
+/// @param[in]     op   boundary operator
+///
+template <class T, int R, class Op>
+void apply(NArray<T,R> &x, const int axis, const int side, const int nb,
+           Op op)
+{
+  int64 n0 = 1, n2 = 1;
+  const int64 n1 = x.shape[axis];
+  for(int d=0; d < axis ;d++) n0 *= x.shape[d];
+  for(int d=axis+1; d < R ;d++) n2 *= x.shape[d];
+
+  op.setup(x.shape, R, axis);
+
+  // adjacent interior plane, its opposite, and inward direction
+  const int64 ic = (side == LOWER) ? nb : n1-nb-1;
+  const int64 io = (side == LOWER) ? n1-nb-1 : nb;
+  const int64 dg = (side == LOWER) ? 1 : -1;
+  T* RESTRICT p = x.data;
+
+  if( n2 > 1 ) {
+    // vectorized along the contiguous dimension
+    const int64 nblock = (n2 + BLOCK - 1) / BLOCK;
+#pragma omp parallel for collapse(3) schedule(static)
+    for(int64 i0=0; i0 < n0 ;i0++) {
+      for(int g=1; g <= nb ;g++) {
+        for(int64 ib=0; ib < nblock ;ib++) {
+          const int64 k0 = ib*BLOCK;
+          const int64 k1 = std::min(n2, k0 + BLOCK);
+          const int64 q  = i0*n1*n2;
+          T* RESTRICT dst = &p[q + (ic - g*dg)*n2];
+#pragma omp simd
+          for(int64 k=k0; k < k1 ;k++) {
+            Point<T> a = {&p[q + ic*n2 + k], &p[q + io*n2 + k], dg*n2};
+            dst[k] = op(a, g, i0, k);
+          }
+        }
+      }
+    }
+  } else {
+    // last axis: vectorized across lines with stride n1, and all the ghost
+    // cells of a block of lines are filled while the lines stay in cache
+    const int64 nline  = BLOCK / 4;
+    const int64 nblock = (n0 + nline - 1) / nline;
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < nblock ;ib++) {
+      const int64 i0 = ib*nline;
+      const int64 i1 = std::min(n0, i0 + nline);
+      for(int g=1; g <= nb ;g++) {
+        const int64 ig = ic - g*dg;
+#pragma omp simd
+        for(int64 i=i0; i < i1 ;i++) {
+          Point<T> a = {&p[i*n1 + ic], &p[i*n1 + io], dg};
+          p[i*n1 + ig] = op(a, g, i, 0);
+        }
+      }
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -41,6 +41,7 @@ typedef unsigned long uint64_t;
 
 #define INLINE   inline
 #define RESTRICT restrict
+#define FORCE_INLINE inline
 
 #elif defined(__FCC_VERSION) && defined(__sparcv9)
 //
@@ -55,6 +56,7 @@ typedef unsigned long uint64_t;
 
 #define INLINE   inline
 #define RESTRICT
+#define FORCE_INLINE inline
 
 //
 // Following MPI type specifications with explict data size should be defined
@@ -97,6 +99,7 @@ typedef unsigned long long uint64_t;
 
 #define INLINE   inline
 #define RESTRICT __restrict__
+#define FORCE_INLINE inline __attribute__((always_inline))
 
 #elif defined (__GNUC__)
 //
@@ -110,6 +113,7 @@ typedef unsigned long long uint64_t;
 
 #define INLINE   inline
 #define RESTRICT __restrict__
+#define FORCE_INLINE inline __attribute__((always_inline))
 
 #else
 // report error
@@ -100,7 +100,7 @@ void debug_write_array(T_array &array, const char* filename)
   ofs.write(reinterpret_cast<const char*>(&array.ndim), isize);
   ofs.write(reinterpret_cast<const char*>(&array.dims[0]), isize*array.ndim);
 
-  debug_write_array_data(ofs, array.ptr, array.size);
+  debug_write_array_data(ofs, array.ptr(), array.size);
 
   ofs.close();
   ofs.flush();
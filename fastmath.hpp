@@ -0,0 +1,535 @@
+// -*- C++ -*-
+#ifndef _FASTMATH_HPP_
+#define _FASTMATH_HPP_
+
+///
+/// Vectorizable Elementary Functions
+///
+/// Calls to libm (exp, log, sin, cos, ...) in a loop are not vectorized
+/// unless a vector math library is enabled by the compiler (which usually
+/// requires -ffast-math). This module provides branchless implementations of
+/// exp, log, pow, sincos (sin, cos), rsqrt and erf, which are inlined into
+/// "omp simd" loops such that the compiler generates vector code for them.
+/// The accuracy is selected by a template parameter:
+///
+///   FULL   : relative error of a few ulp (~1e-15)
+///   MEDIUM : relative error ~1e-7 (or better)
+///   LOW    : relative error ~1e-4 (or better)
+///
+/// where a lower accuracy uses fewer terms of the same approximation. For
+/// example,
+///
+///   #pragma omp simd
+///   for(int i=0; i < n ;i++) {
+///     y[i] = fastmath::exp<fastmath::MEDIUM>(-x[i]*x[i]);
+///   }
+///
+/// Batch versions apply a function to n elements of arrays or to all
+/// elements of NArray with "omp parallel for simd":
+///
+///   fastmath::log<fastmath::FULL>(x.data, y.data, n);
+///   fastmath::sincos<fastmath::LOW>(phase, s, c); // NArray
+///
+/// Implementation:
+///   exp    : exp(x) = 2^n exp(r) with |r| <= ln2/2, Taylor series for exp(r)
+///   log    : log(x) = e log2 + 2 atanh((m-1)/(m+1)), m in [sqrt(1/2),sqrt(2))
+///   pow    : pow(x,y) = exp(y log(x)), where y log(x) is computed in
+///            double-double arithmetic for FULL
+///   sincos : reduction by multiple of pi/2, Taylor series on |r| <= pi/4
+///   rsqrt  : 1/sqrt(x) (FULL), initial guess by bit manipulation and Newton
+///            iterations otherwise
+///   erf    : Chebyshev series of erf(x)/x for |x| < 2, and that of
+///            x exp(x^2) erfc(x) for |x| >= 2
+///
+/// Limitations:
+///   - only float64 (double) is supported
+///   - exp, log and erf handle 0, inf and NaN as libm does (except for errno
+///     and floating point exceptions), log returns NaN for x < 0
+///   - pow is for x >= 0; its relative error of MEDIUM and LOW is amplified
+///     by |y log(x)|
+///   - sincos is accurate for |x| up to about 1e5, beyond which the error of
+///     argument reduction grows in proportion to |x|
+///   - rsqrt of MEDIUM and LOW is for positive normal numbers
+///
+/// $Id$
+///
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace fastmath
+{
+/// accuracy
+enum { FULL = 0, MEDIUM, LOW };
+
+///
+/// @brief number of terms (or iterations) for each accuracy
+///
+template <int A>
+struct Terms;
+
+template <>
+struct Terms<FULL>
+{
+  enum { EXP = 13, LOG = 10, SIN = 8, COS = 9, NEWTON = 0,
+         ERF_SMALL = 17, ERF_LARGE = 15 };
+};
+
+template <>
+struct Terms<MEDIUM>
+{
+  enum { EXP = 8, LOG = 4, SIN = 5, COS = 6, NEWTON = 3,
+         ERF_SMALL = 10, ERF_LARGE = 5 };
+};
+
+template <>
+struct Terms<LOW>
+{
+  enum { EXP = 5, LOG = 3, SIN = 3, COS = 4, NEWTON = 2,
+         ERF_SMALL = 7, ERF_LARGE = 3 };
+};
+
+/// @name constants
+//@{
+// ln2 split into high (32 bits) and low parts
+static const float64 LN2_HI = 6.93147180369123816490e-01;
+static const float64 LN2_LO = 1.90821492927058770002e-10;
+// pi/2 split into three parts (33 bits each)
+static const float64 PIO2_1 = 1.57079632673412561417e+00;
+static const float64 PIO2_2 = 6.07710050630396597660e-11;
+static const float64 PIO2_3 = 2.02226624871116645580e-21;
+
+// 1/k! for k = 0, ..., 18
+static const float64 inv_factorial[] = {
+  1.0,
+  1.0,
+  0.5,
+  0.16666666666666666,
+  0.041666666666666664,
+  0.008333333333333333,
+  0.001388888888888889,
+  0.0001984126984126984,
+  2.48015873015873e-05,
+  2.7557319223985893e-06,
+  2.755731922398589e-07,
+  2.505210838544172e-08,
+  2.08767569878681e-09,
+  1.6059043836821613e-10,
+  1.1470745597729725e-11,
+  7.647163731819816e-13,
+  4.779477332387385e-14,
+  2.8114572543455206e-15,
+  1.5619206968586225e-16
+};
+
+// Chebyshev coefficients of erf(x)/x in u = x^2/2 - 1 for |x| < 2
+static const float64 erf_small[] = {
+  0.7415552820424018,
+  -0.30107107338659495,
+  0.06899483068983156,
+  -0.013916271264722188,
+  0.0024207995224334636,
+  -0.0003658639685848086,
+  4.862098443231905e-05,
+  -5.749256558035685e-06,
+  6.113243578434765e-07,
+  -5.8991015312958435e-08,
+  5.2070090920686485e-09,
+  -4.2329758799655433e-10,
+  3.188113506649175e-11,
+  -2.2361550188326843e-12,
+  1.467329847991085e-13,
+  -9.044001985381747e-15,
+  5.254813715470919e-16
+};
+
+// Chebyshev coefficients of x exp(x^2) erfc(x) in u = 6/x - 2 for x >= 2
+static const float64 erf_large[] = {
+  0.5353732068438819,
+  -0.023155412139469353,
+  -0.0016392210759605804,
+  0.00022227996277607014,
+  -8.78999954273534e-06,
+  -8.810395716790812e-07,
+  1.8418972159404269e-07,
+  -1.4087247661320117e-08,
+  -2.163390848477303e-10,
+  2.1064317309527063e-10,
+  -2.979314476337555e-11,
+  1.8153634618564103e-12,
+  1.4524503191869517e-13,
+  -5.475907229823179e-14,
+  7.611811795943645e-15
+};
+//@}
+
+/// @name helpers
+//@{
+/// reinterpret float64 as int64
+INLINE int64 as_int(const float64 x)
+{
+  int64 i;
+  std::memcpy(&i, &x, sizeof(i));
+  return i;
+}
+
+/// reinterpret int64 as float64
+INLINE float64 as_float(const int64 i)
+{
+  float64 x;
+  std::memcpy(&x, &i, sizeof(x));
+  return x;
+}
+
+/// 2^n for -1022 <= n <= 1023
+INLINE float64 pow2(const int64 n)
+{
+  return as_float((n + 1023) << 52);
+}
+
+/// polynomial sum_{k=0}^{N-1} c[k] x^k by Horner's rule
+template <int N>
+INLINE float64 horner(const float64 x, const float64 c[])
+{
+  float64 p = c[N-1];
+  for(int k=N-2; k >= 0 ;k--) {
+    p = p*x + c[k];
+  }
+  return p;
+}
+
+/// series sum_{k=0}^{N-1} (-1)^k z^k / (2k+O)! for O = 0 (cos) or 1 (sin)
+template <int N, int O>
+INLINE float64 alternating(const float64 z)
+{
+  float64 p = 0;
+  for(int k=N-1; k >= 0 ;k--) {
+    const float64 c = inv_factorial[2*k+O];
+    p = p*z + ((k & 1) ? -c : c);
+  }
+  return p;
+}
+
+/// Chebyshev series sum_{k=0}^{N-1} c[k] T_k(u) by Clenshaw's recurrence
+template <int N>
+INLINE float64 clenshaw(const float64 u, const float64 c[])
+{
+  float64 b1 = 0;
+  float64 b2 = 0;
+  for(int k=N-1; k >= 1 ;k--) {
+    const float64 b = 2*u*b1 - b2 + c[k];
+    b2 = b1;
+    b1 = b;
+  }
+  return u*b1 - b2 + c[0];
+}
+//@}
+
+/// exp(x + d) for a correction d much smaller than ulp of x
+template <int A>
+INLINE float64 exp_corrected(const float64 x, const float64 d)
+{
+  // x = n ln2 + r, where 2^n is computed as 2^n1 * 2^n2 to avoid overflow
+  const float64 y = std::min(std::max(x, -746.0), 710.0);
+  const float64 n = std::rint(y*M_LOG2E);
+  const float64 r = ((y - n*LN2_HI) - n*LN2_LO) + d;
+  const int64   n1 = static_cast<int64>(n) / 2;
+  const int64   n2 = static_cast<int64>(n) - n1;
+  const float64 p  = horner<Terms<A>::EXP>(r, inv_factorial);
+  return (x != x) ? x : p*pow2(n1)*pow2(n2);
+}
+
+/// x = 2^e m with m in [sqrt(1/2), sqrt(2)) for x > 0
+INLINE void log_reduce(const float64 x, float64 &e, float64 &m)
+{
+  // scale subnormal numbers by 2^52
+  const float64 scale = (x < DBL_MIN) ? 4503599627370496.0 : 1.0;
+  const int64   bits  = as_int(x*scale);
+
+  // the exponent is adjusted by arithmetic as a second selection by hi
+  // becomes a branch
+  const int64   e0 = ((bits >> 52) & 0x7ff) - (as_int(scale) >> 52);
+  const float64 m0 = as_float((bits & 0x000fffffffffffffLL) |
+                              0x3ff0000000000000LL);
+  const bool    hi = m0 > M_SQRT2;
+  m = hi ? 0.5*m0 : m0;
+  e = static_cast<float64>(e0 + static_cast<int64>(hi));
+}
+
+/// log(x) - log(x for 0 < x < inf) for special values 0, inf, x < 0 and NaN
+INLINE float64 log_special(const float64 x)
+{
+  // special values are added rather than selected, since the compiler does
+  // not speculate the division of log if the result may be discarded
+  const float64 inf = std::numeric_limits<float64>::infinity();
+  const float64 nan = std::numeric_limits<float64>::quiet_NaN();
+  const float64 c0  = (x == inf) ? inf : 0.0;
+  const float64 c1  = (x >= 0)   ? c0  : nan;
+  return (x == 0) ? -inf : c1;
+}
+
+/// exponential function
+template <int A>
+INLINE float64 exp(const float64 x)
+{
+  return exp_corrected<A>(x, 0.0);
+}
+
+/// natural logarithm
+template <int A>
+INLINE float64 log(const float64 x)
+{
+  float64 e, m;
+  log_reduce(x, e, m);
+
+  // log(m) = 2 atanh(f) = 2 f (1 + f^2/3 + f^4/5 + ...)
+  const float64 f = (m - 1)/(m + 1);
+  const float64 z = f*f;
+  float64 p = 0;
+  for(int k=Terms<A>::LOG-1; k >= 0 ;k--) {
+    p = p*z + 1.0/(2*k+1);
+  }
+  const float64 result = e*LN2_HI + (2*f*p + e*LN2_LO);
+
+  return result + log_special(x);
+}
+
+/// natural logarithm as hi + lo in double-double precision for x > 0
+INLINE float64 log_extended(const float64 x, float64 &lo)
+{
+  float64 e, m;
+  log_reduce(x, e, m);
+
+  // f = (m-1)/(m+1) as f + g, where m-1 is exact and m+1 = v + w
+  const float64 u = m - 1;
+  const float64 v = m + 1;
+  const float64 b = v - m;
+  const float64 w = (m - (v - b)) + (1 - b);
+  const float64 f = u/v;
+  const float64 g = (std::fma(-f, v, u) - f*w)/v;
+
+  // log(m) = 2 f + 2 g + 2 f (f^2/3 + f^4/5 + ...)
+  const float64 z = f*f;
+  float64 p = 0;
+  for(int k=Terms<FULL>::LOG-1; k >= 1 ;k--) {
+    p = p*z + 1.0/(2*k+1);
+  }
+
+  // e ln2 (exact high part) + 2 f by fast two-sum, as |e ln2| > |2 f|
+  const float64 a  = e*LN2_HI;
+  const float64 hi = a + 2*f;
+  lo = ((2*f - (hi - a)) + e*LN2_LO) + 2*(g + f*z*p);
+
+  return hi + log_special(x);
+}
+
+/// base of pow replaced by 1 for y = 0, so that pow(x, 0) = 1 even for x = 0,
+/// inf and NaN, where y log(x) is NaN
+INLINE float64 pow_base(const float64 x, const float64 y)
+{
+  // selected by bit mask, since the compiler branches on a selection of
+  // the constant to specialize log for it
+  const int64 mask = -static_cast<int64>(y == 0);
+  return as_float((as_int(x) & ~mask) | (as_int(1.0) & mask));
+}
+
+/// power function for x >= 0
+template <int A>
+INLINE float64 pow(const float64 x, const float64 y)
+{
+  return exp<A>(y*log<A>(pow_base(x, y)));
+}
+
+/// power function for x >= 0; y log(x) is computed in extended precision
+template <>
+INLINE float64 pow<FULL>(const float64 x, const float64 y)
+{
+  float64 lo;
+  const float64 hi = log_extended(pow_base(x, y), lo);
+
+  // y log(x) = h + d; the correction is dropped where exp over/underflows
+  const float64 h = y*hi;
+  const float64 d = (std::abs(h) < 746) ? std::fma(y, hi, -h) + y*lo : 0;
+  return exp_corrected<FULL>(h, d);
+}
+
+/// sine and cosine
+template <int A>
+INLINE void sincos(const float64 x, float64 &s, float64 &c)
+{
+  // x = q pi/2 + r with |r| <= pi/4
+  const float64 q  = std::rint(x*M_2_PI);
+  const float64 r  = ((x - q*PIO2_1) - q*PIO2_2) - q*PIO2_3;
+  const float64 z  = r*r;
+  const float64 ps = r*alternating<Terms<A>::SIN,1>(z);
+  const float64 pc = alternating<Terms<A>::COS,0>(z);
+
+  // select by quadrant
+  const int64   iq = static_cast<int64>(q);
+  const float64 ss = (iq & 1) ? pc : ps;
+  const float64 cc = (iq & 1) ? ps : pc;
+  s = (iq & 2)     ? -ss : ss;
+  c = ((iq+1) & 2) ? -cc : cc;
+}
+
+/// sine
+template <int A>
+INLINE float64 sin(const float64 x)
+{
+  float64 s, c;
+  sincos<A>(x, s, c);
+  return s;
+}
+
+/// cosine
+template <int A>
+INLINE float64 cos(const float64 x)
+{
+  float64 s, c;
+  sincos<A>(x, s, c);
+  return c;
+}
+
+/// reciprocal square root
+template <int A>
+INLINE float64 rsqrt(const float64 x)
+{
+  if( Terms<A>::NEWTON == 0 ) {
+    return 1/std::sqrt(x);
+  }
+
+  // initial guess with relative error of ~3.5e-2
+  const float64 h = 0.5*x;
+  float64 y = as_float(0x5fe6eb50c7b537a9LL - (as_int(x) >> 1));
+  for(int k=0; k < Terms<A>::NEWTON ;k++) {
+    y = y*(1.5 - h*y*y);
+  }
+  return y;
+}
+
+/// error function
+template <int A>
+INLINE float64 erf(const float64 x)
+{
+  const float64 a = std::min(std::abs(x), 6.0);
+
+  // |x| < 2
+  const float64 us    = 0.5*a*a - 1;
+  const float64 small = x*clenshaw<Terms<A>::ERF_SMALL>(us, erf_small);
+
+  // |x| >= 2 : erf(x) = 1 - exp(-x^2) g(x)/x
+  const float64 t     = 1/std::max(a, 2.0);
+  const float64 g     = clenshaw<Terms<A>::ERF_LARGE>(6*t - 2, erf_large);
+  const float64 large = std::copysign(1 - exp<A>(-a*a)*g*t, x);
+
+  return (a < 2) ? small : large;
+}
+
+/// @name batch versions for arrays
+//@{
+template <int A>
+void exp(const float64 *x, float64 *y, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    y[i] = exp<A>(x[i]);
+  }
+}
+
+template <int A>
+void log(const float64 *x, float64 *y, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    y[i] = log<A>(x[i]);
+  }
+}
+
+template <int A>
+void pow(const float64 *x, const float64 *y, float64 *z, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    z[i] = pow<A>(x[i], y[i]);
+  }
+}
+
+template <int A>
+void sincos(const float64 *x, float64 *s, float64 *c, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    sincos<A>(x[i], s[i], c[i]);
+  }
+}
+
+template <int A>
+void rsqrt(const float64 *x, float64 *y, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    y[i] = rsqrt<A>(x[i]);
+  }
+}
+
+template <int A>
+void erf(const float64 *x, float64 *y, const int64 n)
+{
+#pragma omp parallel for simd schedule(static)
+  for(int64 i=0; i < n ;i++) {
+    y[i] = erf<A>(x[i]);
+  }
+}
+//@}
+
+/// @name batch versions for NArray (output may be the same as input)
+//@{
+template <int A, int R>
+void exp(const NArray<float64,R> &x, NArray<float64,R> &y)
+{
+  exp<A>(x.data, y.data, x.getSize());
+}
+
+template <int A, int R>
+void log(const NArray<float64,R> &x, NArray<float64,R> &y)
+{
+  log<A>(x.data, y.data, x.getSize());
+}
+
+template <int A, int R>
+void pow(const NArray<float64,R> &x, const NArray<float64,R> &y,
+         NArray<float64,R> &z)
+{
+  pow<A>(x.data, y.data, z.data, x.getSize());
+}
+
+template <int A, int R>
+void sincos(const NArray<float64,R> &x, NArray<float64,R> &s,
+            NArray<float64,R> &c)
+{
+  sincos<A>(x.data, s.data, c.data, x.getSize());
+}
+
+template <int A, int R>
+void rsqrt(const NArray<float64,R> &x, NArray<float64,R> &y)
+{
+  rsqrt<A>(x.data, y.data, x.getSize());
+}
+
+template <int A, int R>
+void erf(const NArray<float64,R> &x, NArray<float64,R> &y)
+{
+  erf<A>(x.data, y.data, x.getSize());
+}
+//@}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
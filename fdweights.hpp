@@ -0,0 +1,158 @@
+// -*- C++ -*-
+#ifndef _FDWEIGHTS_HPP_
+#define _FDWEIGHTS_HPP_
+
+///
+/// Compile-time Finite Difference Weights
+///
+/// Weights of finite difference (and interpolation) stencils of arbitrary
+/// derivative order and arbitrary set of grid points are generated at compile
+/// time with Fornberg's algorithm, and materialized as constexpr SArray1D
+/// tables. Stencil kernels templated on the order of accuracy thus have all
+/// the coefficients folded into immediates.
+///
+/// Weights are given for unit grid spacing; the result of the M-th derivative
+/// should be divided by h^M.
+///
+/// @see B. Fornberg, Math. Comp. 51, 699 (1988)
+///
+/// $Id$
+///
+#include "config.hpp"
+#include "SArray.hpp"
+#include "SArrayMath.hpp"
+
+namespace fdweights
+{
+///
+/// @brief Fornberg's algorithm
+///
+/// Return weights w[j] of the M-th derivative at x0 with N grid points x[j]
+/// such that f^(M)(x0) ~ sum_j w[j] f(x[j]). This is a constexpr function,
+/// and may also be used at run time.
+///
+template <int M, int N>
+constexpr SArray1D<float64,N> fornberg(const SArray1D<float64,N> &x,
+                                       const float64 x0)
+{
+  float64 c[N][M+1] = {};
+  float64 c1 = 1;
+  float64 c4 = x.data[0] - x0;
+
+  c[0][0] = 1;
+  for(int i=1; i < N ;i++) {
+    const int mn = (i < M) ? i : M;
+    float64 c2 = 1;
+    float64 c5 = c4;
+    c4 = x.data[i] - x0;
+    for(int j=0; j < i ;j++) {
+      const float64 c3 = x.data[i] - x.data[j];
+      c2 = c2*c3;
+      if( j == i-1 ) {
+        for(int k=mn; k > 0 ;k--) {
+          c[i][k] = c1*(k*c[i-1][k-1] - c5*c[i-1][k])/c2;
+        }
+        c[i][0] = -c1*c5*c[i-1][0]/c2;
+      }
+      for(int k=mn; k > 0 ;k--) {
+        c[j][k] = (c4*c[j][k] - k*c[j][k-1])/c3;
+      }
+      c[j][0] = c4*c[j][0]/c3;
+    }
+    c1 = c2;
+  }
+
+  SArray1D<float64,N> w = {};
+  for(int j=0; j < N ;j++) {
+    w.data[j] = c[j][M];
+  }
+  return w;
+}
+
+///
+/// @brief return weights for grid points at j - S (j = 0, ..., N-1)
+///
+/// The derivative is evaluated at the grid point 0 if H = 0, and at the
+/// midpoint 1/2 between grid points 0 and 1 if H = 1.
+///
+template <int M, int N, int S, int H>
+constexpr SArray1D<float64,N> weights()
+{
+  SArray1D<float64,N> x = {};
+  for(int j=0; j < N ;j++) {
+    x.data[j] = j - S;
+  }
+  return fornberg<M,N>(x, 0.5*H);
+}
+
+///
+/// @class Stencil fdweights.hpp
+/// @brief Finite difference stencil with compile-time weights
+///
+/// M-th derivative with N grid points at offsets j - S (j = 0, ..., N-1),
+/// evaluated at the grid point (H = 0) or at the midpoint (H = 1).
+///
+template <int M, int N, int S, int H=0>
+struct Stencil
+{
+  static constexpr int order = M; ///< derivative order
+  static constexpr int size  = N; ///< number of grid points
+  static constexpr int shift = S; ///< offset of the first grid point
+
+  /// table of weights
+  static constexpr SArray1D<float64,N> weight = weights<M,N,S,H>();
+
+  ///
+  /// @brief apply stencil
+  ///
+  /// Return sum_j weight[j] * f[(j-S)*stride]. The sum is unrolled with
+  /// constant weights.
+  ///
+  template <class T>
+  static INLINE T apply(const T* RESTRICT f, const int64 stride=1)
+  {
+    T result = 0;
+    loopnest::static_for<0,N>([&](int j)
+                             {
+                               result += static_cast<T>(weight.data[j]) *
+                                 f[(j-S)*stride];
+                             });
+    return result;
+  }
+};
+
+// definition of static members (required for odr-use before C++17)
+template <int M, int N, int S, int H>
+constexpr SArray1D<float64,N> Stencil<M,N,S,H>::weight;
+template <int M, int N, int S, int H>
+constexpr int Stencil<M,N,S,H>::order;
+template <int M, int N, int S, int H>
+constexpr int Stencil<M,N,S,H>::size;
+template <int M, int N, int S, int H>
+constexpr int Stencil<M,N,S,H>::shift;
+
+/// @name common stencils of a given (even) order of accuracy
+//@{
+/// M-th derivative with centered stencil
+template <int M, int Order>
+using Centered = Stencil<M, 2*((Order+M-1)/2)+1, (Order+M-1)/2, 0>;
+
+/// M-th derivative (or interpolation if M = 0) at midpoint i+1/2
+template <int M, int Order>
+using Staggered = Stencil<M, 2*((Order+M)/2), (Order+M)/2-1, 1>;
+
+/// M-th derivative with one-sided stencil using points i, i+1, ...
+template <int M, int Order>
+using Forward = Stencil<M, Order+M, 0, 0>;
+
+/// M-th derivative with one-sided stencil using points i, i-1, ...
+template <int M, int Order>
+using Backward = Stencil<M, Order+M, Order+M-1, 0>;
+//@}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
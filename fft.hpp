@@ -0,0 +1,706 @@
+// -*- C++ -*-
+#ifndef _FFT_HPP_
+#define _FFT_HPP_
+
+///
+/// Batched Mixed-Radix FFT
+///
+/// One-dimensional discrete Fourier transforms
+///
+///   X[k] = sum_{j=0}^{n-1} x[j] exp(sign * 2 pi i j k / n)
+///
+/// are computed along a given axis of NArray for all the lines at once.
+/// Transforms are unnormalized as FFTW; a forward (sign = -1) and backward
+/// (sign = +1) transform give n times the original data.
+///
+/// A plan for each size is created once and cached (thread-safe). The size is
+/// factorized into radices 4, 2, 3, 5 with specialized butterflies, and other
+/// prime factors are handled by a generic O(p^2) butterfly. Each stage is a
+/// Stockham autosort step, so that neither bit reversal nor an index table is
+/// needed; stages alternate between the data and a compact scratch of BLOCK
+/// lines.
+///
+/// As in tridiag.hpp, SIMD lanes run across lines: for an axis other than the
+/// last one, the lines are interleaved in the contiguous dimension and
+/// transformed in-place directly on NArray data. For the last axis, LANES
+/// lines are transposed into scratch memory which stays in cache. (outer
+/// index, block) pairs are distributed across threads.
+///
+/// r2c() and c2r() transform real data of size n into n/2+1 complex
+/// coefficients and vice versa. For even n, the real data are packed into a
+/// complex transform of size n/2.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <map>
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace fft
+{
+/// direction of transform
+enum { FORWARD = -1, BACKWARD = +1 };
+
+/// number of interleaved lines transformed at once for an axis but the last
+enum { BLOCK = 32 };
+
+/// number of lines transposed at once for the last axis
+enum { LANES = 16 };
+
+///
+/// @class Plan fft.hpp
+/// @brief factorization and twiddle factors for complex transform of size n
+///
+template <class T>
+struct Plan
+{
+  struct Stage
+  {
+    int   radix;  ///< radix of stage
+    int64 len;    ///< length of sub-sequences divided by radix
+    int64 stride; ///< stride of sub-sequences
+    int64 offset; ///< offset of twiddle factors
+    int64 roots;  ///< offset of roots of unity for generic radix
+  };
+
+  int64              n;     ///< size of transform
+  std::vector<Stage> stage; ///< stages
+  std::vector<T>     tw;    ///< twiddle factors (cos, sin)
+  std::vector<T>     rw;    ///< exp(2 pi i k/p) for generic radix p (cos, sin)
+  std::vector<T>     rtw;   ///< exp(2 pi i k/2n) for k = 0, ..., n (cos, sin)
+
+  Plan(const int64 size) : n(size)
+  {
+    // factorize
+    std::vector<int> factor;
+    int64 m = n;
+    while( m % 4 == 0 ) {
+      factor.push_back(4);
+      m /= 4;
+    }
+    for(int p=2; p*p <= m ;p++) {
+      while( m % p == 0 ) {
+        factor.push_back(p);
+        m /= p;
+      }
+    }
+    if( m > 1 ) factor.push_back(m);
+
+    // stages and twiddle factors
+    int64 len    = n;
+    int64 stride = 1;
+    for(size_t s=0; s < factor.size() ;s++) {
+      const int r = factor[s];
+      Stage st = {r, len/r, stride, static_cast<int64>(tw.size()),
+                  static_cast<int64>(rw.size())};
+      for(int64 p=0; p < len/r ;p++) {
+        for(int u=1; u < r ;u++) {
+          const float64 theta = 2*M_PI*p*u/len;
+          tw.push_back(std::cos(theta));
+          tw.push_back(std::sin(theta));
+        }
+      }
+      if( r > 5 ) {
+        for(int k=0; k < r ;k++) {
+          rw.push_back(std::cos(2*M_PI*k/r));
+          rw.push_back(std::sin(2*M_PI*k/r));
+        }
+      }
+      stage.push_back(st);
+      len    /= r;
+      stride *= r;
+    }
+
+    // for real transform of size 2n
+    for(int64 k=0; k <= n ;k++) {
+      rtw.push_back(std::cos(M_PI*k/n));
+      rtw.push_back(std::sin(M_PI*k/n));
+    }
+  }
+};
+
+///
+/// @brief get cached plan for size n
+///
+template <class T>
+const Plan<T>& get_plan(const int64 n)
+{
+  static std::map< int64, std::unique_ptr< Plan<T> > > cache;
+  Plan<T> *plan;
+
+#pragma omp critical (fft_plan)
+  {
+    std::unique_ptr< Plan<T> > &p = cache[n];
+    if( !p ) p.reset(new Plan<T>(n));
+    plan = p.get();
+  }
+
+  return *plan;
+}
+
+/// @name butterflies (in-place DFT of size R, sgn is sign of exponent)
+//@{
+template <int R, class T>
+struct Butterfly;
+
+template <class T>
+struct Butterfly<2,T>
+{
+  static FORCE_INLINE void apply(T *ar, T *ai, const T)
+  {
+    const T br = ar[0] - ar[1];
+    const T bi = ai[0] - ai[1];
+    ar[0] += ar[1];
+    ai[0] += ai[1];
+    ar[1] = br;
+    ai[1] = bi;
+  }
+};
+
+template <class T>
+struct Butterfly<3,T>
+{
+  static FORCE_INLINE void apply(T *ar, T *ai, const T sgn)
+  {
+    const T c  = -0.5;
+    const T s  = sgn*static_cast<T>(0.86602540378443864676);
+    const T sr = ar[1] + ar[2];
+    const T si = ai[1] + ai[2];
+    const T dr = ar[1] - ar[2];
+    const T di = ai[1] - ai[2];
+    const T tr = ar[0] + c*sr;
+    const T ti = ai[0] + c*si;
+    ar[0] += sr;
+    ai[0] += si;
+    ar[1] = tr - s*di;
+    ai[1] = ti + s*dr;
+    ar[2] = tr + s*di;
+    ai[2] = ti - s*dr;
+  }
+};
+
+template <class T>
+struct Butterfly<4,T>
+{
+  static FORCE_INLINE void apply(T *ar, T *ai, const T sgn)
+  {
+    const T t0r = ar[0] + ar[2];
+    const T t0i = ai[0] + ai[2];
+    const T t1r = ar[0] - ar[2];
+    const T t1i = ai[0] - ai[2];
+    const T t2r = ar[1] + ar[3];
+    const T t2i = ai[1] + ai[3];
+    // (a1 - a3) * (sgn * i)
+    const T t3r = -sgn*(ai[1] - ai[3]);
+    const T t3i = +sgn*(ar[1] - ar[3]);
+    ar[0] = t0r + t2r;
+    ai[0] = t0i + t2i;
+    ar[1] = t1r + t3r;
+    ai[1] = t1i + t3i;
+    ar[2] = t0r - t2r;
+    ai[2] = t0i - t2i;
+    ar[3] = t1r - t3r;
+    ai[3] = t1i - t3i;
+  }
+};
+
+template <class T>
+struct Butterfly<5,T>
+{
+  static FORCE_INLINE void apply(T *ar, T *ai, const T sgn)
+  {
+    const T c1 = static_cast<T>(+0.30901699437494742410);
+    const T c2 = static_cast<T>(-0.80901699437494742410);
+    const T s1 = sgn*static_cast<T>(0.95105651629515357212);
+    const T s2 = sgn*static_cast<T>(0.58778525229247312917);
+    const T b1r = ar[1] + ar[4];
+    const T b1i = ai[1] + ai[4];
+    const T b2r = ar[2] + ar[3];
+    const T b2i = ai[2] + ai[3];
+    const T d1r = ar[1] - ar[4];
+    const T d1i = ai[1] - ai[4];
+    const T d2r = ar[2] - ar[3];
+    const T d2i = ai[2] - ai[3];
+    const T t1r = ar[0] + c1*b1r + c2*b2r;
+    const T t1i = ai[0] + c1*b1i + c2*b2i;
+    const T t2r = ar[0] + c2*b1r + c1*b2r;
+    const T t2i = ai[0] + c2*b1i + c1*b2i;
+    const T u1r = s1*d1r + s2*d2r;
+    const T u1i = s1*d1i + s2*d2i;
+    const T u2r = s2*d1r - s1*d2r;
+    const T u2i = s2*d1i - s1*d2i;
+    ar[0] += b1r + b2r;
+    ai[0] += b1i + b2i;
+    ar[1] = t1r - u1i;
+    ai[1] = t1i + u1r;
+    ar[4] = t1r + u1i;
+    ai[4] = t1i - u1r;
+    ar[2] = t2r - u2i;
+    ai[2] = t2i + u2r;
+    ar[3] = t2r + u2i;
+    ai[3] = t2i - u2r;
+  }
+};
+//@}
+
+///
+/// @brief Stockham stage of radix R for m interleaved lines
+///
+/// y[q + s*(R*p + u)] = W^{pu} sum_t x[q + s*(p + t*len)] W_R^{tu}, where the
+/// element e of the line l is at x[e*sx + l] and y[e*sy + l], respectively.
+/// Complex numbers are stored as (re, im) pairs.
+///
+template <int R, class T>
+void stage(const T* RESTRICT x, const int64 sx, T* RESTRICT y,
+           const int64 sy, const int64 m, const int64 len, const int64 s,
+           const T* RESTRICT tw, const T sgn)
+{
+  for(int64 p=0; p < len ;p++) {
+    T wr[R], wi[R];
+    wr[0] = 1;
+    wi[0] = 0;
+    for(int u=1; u < R ;u++) {
+      wr[u] = tw[2*(p*(R-1) + u-1) + 0];
+      wi[u] = tw[2*(p*(R-1) + u-1) + 1] * sgn;
+    }
+
+    for(int64 q=0; q < s ;q++) {
+      const T* RESTRICT xx = &x[2*(q + s*p)*sx];
+      T* RESTRICT yy = &y[2*(q + s*R*p)*sy];
+      const int64 dx = 2*s*len*sx;
+      const int64 dy = 2*s*sy;
+#pragma GCC ivdep
+      for(int64 l=0; l < m ;l++) {
+        T ar[R], ai[R];
+        for(int t=0; t < R ;t++) {
+          ar[t] = xx[t*dx + 2*l + 0];
+          ai[t] = xx[t*dx + 2*l + 1];
+        }
+        Butterfly<R,T>::apply(ar, ai, sgn);
+        for(int u=0; u < R ;u++) {
+          yy[u*dy + 2*l + 0] = ar[u]*wr[u] - ai[u]*wi[u];
+          yy[u*dy + 2*l + 1] = ar[u]*wi[u] + ai[u]*wr[u];
+        }
+      }
+    }
+  }
+}
+
+///
+/// @brief Stockham stage of generic radix r (see stage())
+///
+template <class T>
+void stage_generic(const T* RESTRICT x, const int64 sx, T* RESTRICT y,
+                   const int64 sy, const int64 m, const int64 len,
+                   const int64 s, const int r, const T* RESTRICT tw,
+                   const T* RESTRICT rw, const T sgn)
+{
+  for(int64 p=0; p < len ;p++) {
+    for(int64 q=0; q < s ;q++) {
+      const T* RESTRICT xx = &x[2*(q + s*p)*sx];
+      T* RESTRICT yy = &y[2*(q + s*r*p)*sy];
+      const int64 dx = 2*s*len*sx;
+      const int64 dy = 2*s*sy;
+      for(int u=0; u < r ;u++) {
+        const T wr = u == 0 ? 1 : tw[2*(p*(r-1) + u-1) + 0];
+        const T wi = u == 0 ? 0 : tw[2*(p*(r-1) + u-1) + 1] * sgn;
+#pragma omp simd
+        for(int64 l=0; l < m ;l++) {
+          T br = 0;
+          T bi = 0;
+          for(int t=0; t < r ;t++) {
+            const int k  = (t*u) % r;
+            const T   cr = rw[2*k + 0];
+            const T   ci = rw[2*k + 1] * sgn;
+            const T   ar = xx[t*dx + 2*l + 0];
+            const T   ai = xx[t*dx + 2*l + 1];
+            br += ar*cr - ai*ci;
+            bi += ar*ci + ai*cr;
+          }
+          yy[u*dy + 2*l + 0] = br*wr - bi*wi;
+          yy[u*dy + 2*l + 1] = br*wi + bi*wr;
+        }
+      }
+    }
+  }
+}
+
+///
+/// @brief transform m interleaved lines a[e*sa + l] with scratch b[e*m + l]
+///
+/// Returns true if the result is in b and false if it is in a.
+///
+template <class T>
+bool transform(const Plan<T> &plan, T *a, const int64 sa, T *b,
+               const int64 m, const int sign)
+{
+  const T sgn = sign;
+  T* src = a;
+  T* dst = b;
+  int64 ss = sa;
+  int64 sd = m;
+
+  for(size_t i=0; i < plan.stage.size() ;i++) {
+    const typename Plan<T>::Stage &st = plan.stage[i];
+    const T* tw = &plan.tw[st.offset];
+    switch( st.radix ) {
+    case 2:
+      stage<2>(src, ss, dst, sd, m, st.len, st.stride, tw, sgn);
+      break;
+    case 3:
+      stage<3>(src, ss, dst, sd, m, st.len, st.stride, tw, sgn);
+      break;
+    case 4:
+      stage<4>(src, ss, dst, sd, m, st.len, st.stride, tw, sgn);
+      break;
+    case 5:
+      stage<5>(src, ss, dst, sd, m, st.len, st.stride, tw, sgn);
+      break;
+    default:
+      stage_generic(src, ss, dst, sd, m, st.len, st.stride, st.radix, tw,
+                    &plan.rw[st.roots], sgn);
+      break;
+    }
+    std::swap(src, dst);
+    std::swap(ss, sd);
+  }
+
+  return src == b;
+}
+
+// view an NArray as [n0][n1][n2] with n1 along the axis
+template <class T, int Rank>
+void get_shape(const NArray<T,Rank> &x, const int axis, int64 &n0, int64 &n1,
+               int64 &n2)
+{
+  n0 = 1;
+  n1 = x.shape[axis];
+  n2 = 1;
+  for(int k=0; k < axis ;k++) n0 *= x.shape[k];
+  for(int k=axis+1; k < Rank ;k++) n2 *= x.shape[k];
+}
+
+///
+/// @brief complex-to-complex transform of array [n0][n1][n2] along n1
+///
+template <class T>
+void c2c(std::complex<T> *x, const int64 n0, const int64 n1, const int64 n2,
+         const int sign)
+{
+  if( n1 < 2 ) return;
+
+  const Plan<T> &plan = get_plan<T>(n1);
+  T* xx = reinterpret_cast<T*>(x);
+
+  if( n2 == 1 ) {
+    // transpose LANES contiguous lines into scratch
+    const int64 nb = (n0 + LANES - 1)/LANES;
+#pragma omp parallel
+    {
+      std::vector<T> buf(4*n1*LANES);
+      T* ta = &buf[0];
+      T* tb = &buf[2*n1*LANES];
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < nb ;ib++) {
+        const int64 l0 = ib*LANES;
+        const int64 m  = std::min<int64>(LANES, n0 - l0);
+        T* xp = &xx[2*l0*n1];
+
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            ta[2*(i*m + l) + 0] = xp[2*(l*n1 + i) + 0];
+            ta[2*(i*m + l) + 1] = xp[2*(l*n1 + i) + 1];
+          }
+        }
+
+        const T* tr = transform(plan, ta, m, tb, m, sign) ? tb : ta;
+
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            xp[2*(l*n1 + i) + 0] = tr[2*(i*m + l) + 0];
+            xp[2*(l*n1 + i) + 1] = tr[2*(i*m + l) + 1];
+          }
+        }
+      }
+    }
+  } else {
+    // interleaved lines without transpose
+    const int64 nb = (n2 + BLOCK - 1)/BLOCK;
+#pragma omp parallel
+    {
+      std::vector<T> buf(2*n1*BLOCK);
+      T* tb = &buf[0];
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < n0*nb ;ib++) {
+        const int64 i0 = ib / nb;
+        const int64 l0 = (ib % nb) * BLOCK;
+        const int64 m  = std::min<int64>(BLOCK, n2 - l0);
+        T* xp = &xx[2*(i0*n1*n2 + l0)];
+
+        if( transform(plan, xp, n2, tb, m, sign) ) {
+          for(int64 i=0; i < n1 ;i++) {
+#pragma omp simd
+            for(int64 l=0; l < 2*m ;l++) {
+              xp[2*i*n2 + l] = tb[2*i*m + l];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+///
+/// @brief complex-to-complex transform along a given axis in-place
+///
+template <class T, int Rank>
+void c2c(NArray<std::complex<T>,Rank> &x, const int axis, const int sign)
+{
+  int64 n0, n1, n2;
+  get_shape(x, axis, n0, n1, n2);
+  c2c(x.data, n0, n1, n2, sign);
+}
+
+// load m real lines x[e*es + l*ls] of size n into complex scratch a[e*m + l]
+template <class T>
+void load_real(const T* RESTRICT x, const int64 es, const int64 ls,
+               T* RESTRICT a, const int64 n, const int64 m)
+{
+  if( n % 2 == 0 ) {
+    // pack even and odd elements into real and imaginary parts
+    for(int64 e=0; e < n/2 ;e++) {
+      for(int64 l=0; l < m ;l++) {
+        a[2*(e*m + l) + 0] = x[(2*e+0)*es + l*ls];
+        a[2*(e*m + l) + 1] = x[(2*e+1)*es + l*ls];
+      }
+    }
+  } else {
+    for(int64 e=0; e < n ;e++) {
+      for(int64 l=0; l < m ;l++) {
+        a[2*(e*m + l) + 0] = x[e*es + l*ls];
+        a[2*(e*m + l) + 1] = 0;
+      }
+    }
+  }
+}
+
+// store m real lines from complex scratch a (see load_real())
+template <class T>
+void store_real(T* RESTRICT x, const int64 es, const int64 ls,
+                const T* RESTRICT a, const int64 n, const int64 m)
+{
+  if( n % 2 == 0 ) {
+    for(int64 e=0; e < n/2 ;e++) {
+      for(int64 l=0; l < m ;l++) {
+        x[(2*e+0)*es + l*ls] = a[2*(e*m + l) + 0];
+        x[(2*e+1)*es + l*ls] = a[2*(e*m + l) + 1];
+      }
+    }
+  } else {
+    for(int64 e=0; e < n ;e++) {
+      for(int64 l=0; l < m ;l++) {
+        x[e*es + l*ls] = a[2*(e*m + l) + 0];
+      }
+    }
+  }
+}
+
+///
+/// @brief real-to-complex forward transform along a given axis
+///
+/// y must have the same shape as x except for y.shape[axis] = n/2+1, where
+/// n = x.shape[axis].
+///
+template <class T, int Rank>
+void r2c(const NArray<T,Rank> &x, NArray<std::complex<T>,Rank> &y,
+         const int axis)
+{
+  int64 n0, n1, n2;
+  get_shape(x, axis, n0, n1, n2);
+
+  const bool  even = n1 % 2 == 0;
+  const int64 h    = n1/2;
+  const int64 nc   = even ? h : n1;
+  const Plan<T> &plan = get_plan<T>(nc);
+  const int64 mb = n2 == 1 ? int64(LANES) : int64(BLOCK);
+  const int64 nb = n2 == 1 ? (n0 + LANES - 1)/LANES : n0*((n2 + BLOCK - 1)/BLOCK);
+  const T* xx = x.data;
+  T* yy = reinterpret_cast<T*>(y.data);
+
+#pragma omp parallel
+  {
+    std::vector<T> buf(4*nc*mb);
+    T* ta = &buf[0];
+    T* tb = &buf[2*nc*mb];
+
+#pragma omp for schedule(static)
+    for(int64 ib=0; ib < nb ;ib++) {
+      int64 m, es, ls, ix, iy, ey, ly;
+      if( n2 == 1 ) {
+        const int64 l0 = ib*LANES;
+        m  = std::min<int64>(LANES, n0 - l0);
+        es = 1;
+        ls = n1;
+        ey = 1;
+        ly = h+1;
+        ix = l0*n1;
+        iy = l0*(h+1);
+      } else {
+        const int64 nb2 = (n2 + BLOCK - 1)/BLOCK;
+        const int64 i0  = ib / nb2;
+        const int64 l0  = (ib % nb2) * BLOCK;
+        m  = std::min<int64>(BLOCK, n2 - l0);
+        es = n2;
+        ls = 1;
+        ey = n2;
+        ly = 1;
+        ix = i0*n1*n2 + l0;
+        iy = i0*(h+1)*n2 + l0;
+      }
+
+      load_real(&xx[ix], es, ls, ta, n1, m);
+      const T* z = transform(plan, ta, m, tb, m, FORWARD) ? tb : ta;
+      T* yp = &yy[2*iy];
+
+      if( even ) {
+        // X[k] = (Z[k] + Z*[h-k])/2 - i W^k (Z[k] - Z*[h-k])/2
+        for(int64 k=0; k <= h ;k++) {
+          const int64 k0 = (k == h) ? 0 : k;
+          const int64 k1 = (k == 0) ? 0 : h - k;
+          const T wr = +plan.rtw[2*k + 0];
+          const T wi = -plan.rtw[2*k + 1];
+          for(int64 l=0; l < m ;l++) {
+            const T ar = z[2*(k0*m + l) + 0];
+            const T ai = z[2*(k0*m + l) + 1];
+            const T br = z[2*(k1*m + l) + 0];
+            const T bi = z[2*(k1*m + l) + 1];
+            const T er = ar + br;
+            const T ei = ai - bi;
+            const T or_ = ai + bi;
+            const T oi = br - ar;
+            yp[2*(k*ey + l*ly) + 0] = static_cast<T>(0.5)*(er + wr*or_ - wi*oi);
+            yp[2*(k*ey + l*ly) + 1] = static_cast<T>(0.5)*(ei + wr*oi + wi*or_);
+          }
+        }
+      } else {
+        for(int64 k=0; k <= h ;k++) {
+          for(int64 l=0; l < m ;l++) {
+            yp[2*(k*ey + l*ly) + 0] = z[2*(k*m + l) + 0];
+            yp[2*(k*ey + l*ly) + 1] = z[2*(k*m + l) + 1];
+          }
+        }
+      }
+    }
+  }
+}
+
+///
+/// @brief complex-to-real backward transform along a given axis
+///
+/// x must have the same shape as y except for x.shape[axis] = n, where
+/// y.shape[axis] = n/2+1; the shape of x thus distinguishes odd and even n.
+///
+template <class T, int Rank>
+void c2r(const NArray<std::complex<T>,Rank> &y, NArray<T,Rank> &x,
+         const int axis)
+{
+  int64 n0, n1, n2;
+  get_shape(x, axis, n0, n1, n2);
+
+  const bool  even = n1 % 2 == 0;
+  const int64 h    = n1/2;
+  const int64 nc   = even ? h : n1;
+  const Plan<T> &plan = get_plan<T>(nc);
+  const int64 mb = n2 == 1 ? int64(LANES) : int64(BLOCK);
+  const int64 nb = n2 == 1 ? (n0 + LANES - 1)/LANES : n0*((n2 + BLOCK - 1)/BLOCK);
+  const T* yy = reinterpret_cast<const T*>(y.data);
+  T* xx = x.data;
+
+#pragma omp parallel
+  {
+    std::vector<T> buf(4*nc*mb);
+    T* ta = &buf[0];
+    T* tb = &buf[2*nc*mb];
+
+#pragma omp for schedule(static)
+    for(int64 ib=0; ib < nb ;ib++) {
+      int64 m, es, ls, ix, iy, ey, ly;
+      if( n2 == 1 ) {
+        const int64 l0 = ib*LANES;
+        m  = std::min<int64>(LANES, n0 - l0);
+        es = 1;
+        ls = n1;
+        ey = 1;
+        ly = h+1;
+        ix = l0*n1;
+        iy = l0*(h+1);
+      } else {
+        const int64 nb2 = (n2 + BLOCK - 1)/BLOCK;
+        const int64 i0  = ib / nb2;
+        const int64 l0  = (ib % nb2) * BLOCK;
+        m  = std::min<int64>(BLOCK, n2 - l0);
+        es = n2;
+        ls = 1;
+        ey = n2;
+        ly = 1;
+        ix = i0*n1*n2 + l0;
+        iy = i0*(h+1)*n2 + l0;
+      }
+
+      const T* yp = &yy[2*iy];
+      if( even ) {
+        // Z[k] = (X[k] + X*[h-k]) + i W^{-k} (X[k] - X*[h-k])
+        for(int64 k=0; k < h ;k++) {
+          const T wr = plan.rtw[2*k + 0];
+          const T wi = plan.rtw[2*k + 1];
+          for(int64 l=0; l < m ;l++) {
+            const T ar = yp[2*(k*ey + l*ly) + 0];
+            const T ai = yp[2*(k*ey + l*ly) + 1];
+            const T br = yp[2*((h-k)*ey + l*ly) + 0];
+            const T bi = yp[2*((h-k)*ey + l*ly) + 1];
+            const T er = ar + br;
+            const T ei = ai - bi;
+            const T dr = ar - br;
+            const T di = ai + bi;
+            // o = W^{-k} d
+            const T or_ = wr*dr - wi*di;
+            const T oi = wr*di + wi*dr;
+            ta[2*(k*m + l) + 0] = er - oi;
+            ta[2*(k*m + l) + 1] = ei + or_;
+          }
+        }
+      } else {
+        // Hermitian symmetry X[n-k] = X*[k]
+        for(int64 k=0; k <= h ;k++) {
+          for(int64 l=0; l < m ;l++) {
+            ta[2*(k*m + l) + 0] = yp[2*(k*ey + l*ly) + 0];
+            ta[2*(k*m + l) + 1] = yp[2*(k*ey + l*ly) + 1];
+          }
+        }
+        for(int64 k=h+1; k < n1 ;k++) {
+          for(int64 l=0; l < m ;l++) {
+            ta[2*(k*m + l) + 0] = +yp[2*((n1-k)*ey + l*ly) + 0];
+            ta[2*(k*m + l) + 1] = -yp[2*((n1-k)*ey + l*ly) + 1];
+          }
+        }
+      }
+
+      const T* z = transform(plan, ta, m, tb, m, BACKWARD) ? tb : ta;
+      store_real(&xx[ix], es, ls, z, n1, m);
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
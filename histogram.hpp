@@ -0,0 +1,430 @@
+// -*- C++ -*-
+#ifndef _HISTOGRAM_HPP_
+#define _HISTOGRAM_HPP_
+
+///
+/// Parallel Histogram
+///
+/// Hist1D and Hist2D accumulate (optionally weighted) counts of values in
+/// uniform bins over [xmin, xmax) (and [ymin, ymax)); values outside the
+/// range and NaN are ignored. Counts are accumulated over successive calls
+/// of fill() until clear() is called, and are stored in NArray<float64,1>
+/// and NArray<float64,2>, respectively. The number of bins should be less
+/// than 2^31.
+///
+/// The input is a pointer with a stride, so that a component of particle
+/// data stored as [np][ncomp] is binned directly, or NArray of any rank:
+///
+///   histogram::Hist1D<double> h(64, -5.0, 5.0);
+///   h.fill(&particle(0,3), np, ncomp); // 4th component of particles
+///   h.fill(density);                   // all elements of NArray
+///
+/// The input is processed in batches of BATCH elements. Bin indices of a
+/// batch are computed by a vectorized loop, in which a value outside the
+/// range is mapped to an extra (discarded) bin so that no branch is needed.
+/// Counts are then added to thread-private sub-histograms; a small histogram
+/// has COPIES interleaved copies for each thread, so that successive values
+/// in the same bin do not wait for each other. Finally, the copies and the
+/// sub-histograms are merged by a binary tree (log2 of number of threads
+/// steps of vectorized additions) and added to the counts.
+///
+/// The sum over all processes is computed by histogram::allreduce() in
+/// mpihistogram.hpp.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace histogram
+{
+/// number of elements processed at once
+enum { BATCH = 256 };
+
+/// number of interleaved copies of a small histogram for each thread
+enum { COPIES = 4 };
+
+/// maximum number of bins for which interleaved copies are used
+enum { MAX_BIN_COPIES = 4096 };
+
+/// unit weight
+template <class T>
+struct Unit
+{
+  T operator()(const int64) const
+  {
+    return 1;
+  }
+};
+
+/// weight given by an array with a stride
+template <class T>
+struct Weight
+{
+  const T* RESTRICT w;
+  int64 stride;
+
+  T operator()(const int64 i) const
+  {
+    return w[i*stride];
+  }
+};
+
+///
+/// @class Engine histogram.hpp
+/// @brief thread-private sub-histograms with tree merge
+///
+class Engine
+{
+private:
+  std::vector<float64> m_private;
+
+public:
+  ///
+  /// @brief add (weighted) counts of n elements to counts[0..nbin-1]
+  ///
+  /// bin(i0, m, idx) computes bin indices idx[0..m-1] of elements i0, ...,
+  /// i0+m-1, where nbin denotes outside, and weight(i) returns the weight of
+  /// element i.
+  ///
+  template <class Bin, class W>
+  void run(float64 *counts, const int64 nbin, const int64 n, Bin bin,
+           W weight)
+  {
+#ifdef _OPENMP
+    const int nthread = omp_get_max_threads();
+#else
+    const int nthread = 1;
+#endif
+    // including a bin for outside
+    const bool  copies = nbin <= MAX_BIN_COPIES;
+    const int64 ncopy  = copies ? static_cast<int64>(COPIES) : 1;
+    const int64 size   = nbin + 1;
+    const int64 stride = ncopy*size;
+    m_private.resize(nthread*stride);
+
+    const int64 nbatch = (n + BATCH - 1) / BATCH;
+    float64 *hist = m_private.data();
+
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      const int tid = omp_get_thread_num();
+      const int nth = omp_get_num_threads();
+#else
+      const int tid = 0;
+      const int nth = 1;
+#endif
+      float64* RESTRICT h = &hist[tid*stride];
+      std::fill(h, h + stride, 0.0);
+
+      int32 idx[BATCH];
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < nbatch ;ib++) {
+        const int64 i0 = ib*BATCH;
+        const int   m  = std::min<int64>(BATCH, n - i0);
+        bin(i0, m, idx);
+
+        if( copies ) {
+          int i = 0;
+          for(; i+COPIES <= m ;i+=COPIES) {
+            h[         idx[i  ]] += weight(i0+i  );
+            h[  size + idx[i+1]] += weight(i0+i+1);
+            h[2*size + idx[i+2]] += weight(i0+i+2);
+            h[3*size + idx[i+3]] += weight(i0+i+3);
+          }
+          for(; i < m ;i++) {
+            h[idx[i]] += weight(i0+i);
+          }
+        } else {
+          for(int i=0; i < m ;i++) {
+            h[idx[i]] += weight(i0+i);
+          }
+        }
+      }
+
+      // fold copies
+      for(int64 c=1; c < ncopy ;c++) {
+        const float64* RESTRICT hc = &h[c*size];
+#pragma omp simd
+        for(int64 b=0; b < nbin ;b++) {
+          h[b] += hc[b];
+        }
+      }
+
+      // tree merge of sub-histograms
+      for(int s=1; s < nth ;s*=2) {
+#pragma omp barrier
+        if( tid % (2*s) == 0 && tid + s < nth ) {
+          const float64* RESTRICT hs = &hist[(tid+s)*stride];
+#pragma omp simd
+          for(int64 b=0; b < nbin ;b++) {
+            h[b] += hs[b];
+          }
+        }
+      }
+
+#pragma omp barrier
+#pragma omp for simd schedule(static)
+      for(int64 b=0; b < nbin ;b++) {
+        counts[b] += hist[b];
+      }
+    }
+  }
+};
+
+///
+/// @class Hist1D histogram.hpp
+/// @brief one-dimensional histogram
+///
+template <class T>
+class Hist1D
+{
+private:
+  int64   m_nbin;
+  float64 m_xmin;
+  float64 m_xmax;
+  Engine  m_engine;
+  NArray<float64,1> m_count;
+
+  // remain undefined
+  Hist1D(const Hist1D &);
+  Hist1D& operator=(const Hist1D &);
+
+  template <class W>
+  void accumulate(const T* RESTRICT x, const int64 n, const int64 stride,
+                  W weight)
+  {
+    const int32 nb = m_nbin;
+    const T xmin  = m_xmin;
+    const T xmax  = m_xmax;
+    const T scale = m_nbin / (m_xmax - m_xmin);
+
+    m_engine.run(m_count.data, nb, n,
+                 [=] (const int64 i0, const int m, int32* RESTRICT idx)
+                 {
+#pragma omp simd
+                   for(int i=0; i < m ;i++) {
+                     const T v = x[(i0+i)*stride];
+                     const bool in = v >= xmin && v < xmax;
+                     const T t = in ? (v - xmin)*scale : 0;
+                     const int32 b = static_cast<int32>(t);
+                     idx[i] = in ? std::min(b, nb-1) : nb;
+                   }
+                 },
+                 weight);
+  }
+
+public:
+  Hist1D(const int64 nbin, const float64 xmin, const float64 xmax)
+    : m_nbin(nbin), m_xmin(xmin), m_xmax(xmax), m_count(nbin)
+  {
+    clear();
+  }
+
+  /// reset counts
+  void clear()
+  {
+    std::fill(m_count.data, m_count.data + m_nbin, 0.0);
+  }
+
+  /// add n values x[i*stride]
+  void fill(const T *x, const int64 n, const int64 stride=1)
+  {
+    accumulate(x, n, stride, Unit<T>());
+  }
+
+  /// add n values x[i*stride] with weights w[i*stride]
+  void fill(const T *x, const T *w, const int64 n, const int64 stride=1)
+  {
+    Weight<T> weight = {w, stride};
+    accumulate(x, n, stride, weight);
+  }
+
+  /// add all elements of array
+  template <int R>
+  void fill(const NArray<T,R> &x)
+  {
+    fill(x.data, x.getSize());
+  }
+
+  /// add all elements of array with weights
+  template <int R>
+  void fill(const NArray<T,R> &x, const NArray<T,R> &w)
+  {
+    fill(x.data, w.data, x.getSize());
+  }
+
+  int64 getBins() const
+  {
+    return m_nbin;
+  }
+
+  /// center of bin i
+  float64 getCenter(const int64 i) const
+  {
+    return m_xmin + (i + 0.5)*(m_xmax - m_xmin)/m_nbin;
+  }
+
+  /// sum of all counts
+  float64 getTotal() const
+  {
+    float64 sum = 0;
+    for(int64 i=0; i < m_nbin ;i++) sum += m_count.data[i];
+    return sum;
+  }
+
+  NArray<float64,1>& getCounts()
+  {
+    return m_count;
+  }
+
+  float64 operator()(const int64 i) const
+  {
+    return m_count.data[i];
+  }
+};
+
+///
+/// @class Hist2D histogram.hpp
+/// @brief two-dimensional histogram
+///
+template <class T>
+class Hist2D
+{
+private:
+  int64   m_nbin[2];
+  float64 m_min[2];
+  float64 m_max[2];
+  Engine  m_engine;
+  NArray<float64,2> m_count;
+
+  // remain undefined
+  Hist2D(const Hist2D &);
+  Hist2D& operator=(const Hist2D &);
+
+  template <class W>
+  void accumulate(const T* RESTRICT x, const T* RESTRICT y, const int64 n,
+                  const int64 stride, W weight)
+  {
+    const int32 nx = m_nbin[0];
+    const int32 ny = m_nbin[1];
+    const int32 nb = nx*ny;
+    const T xmin = m_min[0];
+    const T xmax = m_max[0];
+    const T ymin = m_min[1];
+    const T ymax = m_max[1];
+    const T sx = nx / (m_max[0] - m_min[0]);
+    const T sy = ny / (m_max[1] - m_min[1]);
+
+    m_engine.run(m_count.data, nb, n,
+                 [=] (const int64 i0, const int m, int32* RESTRICT idx)
+                 {
+#pragma omp simd
+                   for(int i=0; i < m ;i++) {
+                     const T u = x[(i0+i)*stride];
+                     const T v = y[(i0+i)*stride];
+                     const bool in =
+                       u >= xmin && u < xmax && v >= ymin && v < ymax;
+                     const T tx = in ? (u - xmin)*sx : 0;
+                     const T ty = in ? (v - ymin)*sy : 0;
+                     const int32 bx = static_cast<int32>(tx);
+                     const int32 by = static_cast<int32>(ty);
+                     idx[i] = in ?
+                       std::min(bx, nx-1)*ny + std::min(by, ny-1) : nb;
+                   }
+                 },
+                 weight);
+  }
+
+public:
+  Hist2D(const int64 nx, const float64 xmin, const float64 xmax,
+         const int64 ny, const float64 ymin, const float64 ymax)
+    : m_count(nx, ny)
+  {
+    m_nbin[0] = nx;
+    m_nbin[1] = ny;
+    m_min[0]  = xmin;
+    m_min[1]  = ymin;
+    m_max[0]  = xmax;
+    m_max[1]  = ymax;
+    clear();
+  }
+
+  /// reset counts
+  void clear()
+  {
+    std::fill(m_count.data, m_count.data + m_count.getSize(), 0.0);
+  }
+
+  /// add n pairs (x[i*stride], y[i*stride])
+  void fill(const T *x, const T *y, const int64 n, const int64 stride=1)
+  {
+    accumulate(x, y, n, stride, Unit<T>());
+  }
+
+  /// add n pairs (x[i*stride], y[i*stride]) with weights w[i*stride]
+  void fill(const T *x, const T *y, const T *w, const int64 n,
+            const int64 stride=1)
+  {
+    Weight<T> weight = {w, stride};
+    accumulate(x, y, n, stride, weight);
+  }
+
+  /// add pairs of elements of arrays
+  template <int R>
+  void fill(const NArray<T,R> &x, const NArray<T,R> &y)
+  {
+    fill(x.data, y.data, x.getSize());
+  }
+
+  /// add pairs of elements of arrays with weights
+  template <int R>
+  void fill(const NArray<T,R> &x, const NArray<T,R> &y,
+            const NArray<T,R> &w)
+  {
+    fill(x.data, y.data, w.data, x.getSize());
+  }
+
+  int64 getBins(const int dim) const
+  {
+    return m_nbin[dim];
+  }
+
+  /// center of bin i along dimension dim
+  float64 getCenter(const int dim, const int64 i) const
+  {
+    return m_min[dim] + (i + 0.5)*(m_max[dim] - m_min[dim])/m_nbin[dim];
+  }
+
+  /// sum of all counts
+  float64 getTotal() const
+  {
+    float64 sum = 0;
+    for(uint64 i=0; i < m_count.getSize() ;i++) sum += m_count.data[i];
+    return sum;
+  }
+
+  NArray<float64,2>& getCounts()
+  {
+    return m_count;
+  }
+
+  float64 operator()(const int64 i, const int64 j) const
+  {
+    return m_count(i,j);
+  }
+};
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
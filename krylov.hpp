@@ -0,0 +1,450 @@
+// -*- C++ -*-
+#ifndef _KRYLOV_HPP_
+#define _KRYLOV_HPP_
+
+///
+/// Pipelined Krylov Subspace Solvers
+///
+/// Linear systems A x = b on distributed NArray<T,3> with nb ghost cells are
+/// solved by pipelined variants of Krylov subspace methods, in which global
+/// reductions (inner products) are non-blocking and overlapped with the
+/// operator and preconditioner applications:
+///
+///   cg()       : preconditioned pipelined CG (Ghysels & Vanroose 2014)
+///                with one non-blocking reduction per iteration
+///   bicgstab() : right-preconditioned pipelined BiCGStab (Cools &
+///                Vanroose 2017) with two non-blocking reductions per
+///                iteration (one for each half step), each hidden behind an
+///                operator application
+///
+/// Vector updates of an iteration are fused into a single pass over memory
+/// together with the local inner products for the following reduction.
+///
+/// The operator and preconditioner are functors A(x, y) and M(r, z), which
+/// compute y = A x and z = M^{-1} r in the interior, respectively. The
+/// operator is responsible for the ghost cells of x, which may be filled by
+/// boundary::exchange() or boundary::Condition of mpiboundary.hpp.
+/// Preconditioners Identity and Jacobi are provided, and any functor of the
+/// same form may be used.
+///
+/// Convergence is judged by |r| < tol*|b|. The iteration is terminated
+/// upon breakdown, i.e., when a denominator becomes smaller than NORMMIN
+/// relative to its scale.
+///
+/// $Id$
+///
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "mpiutils.hpp"
+
+namespace krylov
+{
+/// status of solver
+struct Status
+{
+  int     iteration; ///< number of iterations
+  float64 residual;  ///< relative residual |r|/|b|
+  bool    converged; ///< true if converged
+};
+
+/// @name interior loops
+//@{
+/// call f(p) for flat index p of the interior in parallel
+template <class T, class F>
+void for_interior(const NArray<T,3> &x, const int nb, F &&f)
+{
+  const int n0 = x.shape[0];
+  const int n1 = x.shape[1];
+  const int n2 = x.shape[2];
+
+#pragma omp parallel for collapse(2) schedule(static)
+  for(int i=nb; i < n0-nb ;i++) {
+    for(int j=nb; j < n1-nb ;j++) {
+      const int64 q = (static_cast<int64>(i)*n1 + j)*n2;
+#pragma omp simd
+      for(int k=nb; k < n2-nb ;k++) {
+        f(q + k);
+      }
+    }
+  }
+}
+
+/// call f(p, s) for flat index p of the interior and accumulate s[0..N-1]
+template <int N, class T, class F>
+void sum_interior(const NArray<T,3> &x, const int nb, float64 *s, F &&f)
+{
+  static_assert(N <= 6, "too many sums");
+  const int n0 = x.shape[0];
+  const int n1 = x.shape[1];
+  const int n2 = x.shape[2];
+
+  float64 s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0;
+#pragma omp parallel for collapse(2) schedule(static) \
+  reduction(+:s0,s1,s2,s3,s4,s5)
+  for(int i=nb; i < n0-nb ;i++) {
+    for(int j=nb; j < n1-nb ;j++) {
+      const int64 q = (static_cast<int64>(i)*n1 + j)*n2;
+#pragma omp simd reduction(+:s0,s1,s2,s3,s4,s5)
+      for(int k=nb; k < n2-nb ;k++) {
+        float64 t[6] = {0, 0, 0, 0, 0, 0};
+        f(q + k, t);
+        s0 += t[0];
+        s1 += t[1];
+        s2 += t[2];
+        s3 += t[3];
+        s4 += t[4];
+        s5 += t[5];
+      }
+    }
+  }
+
+  const float64 ss[6] = {s0, s1, s2, s3, s4, s5};
+  for(int n=0; n < N ;n++) s[n] = ss[n];
+}
+//@}
+
+/// @name preconditioners
+//@{
+///
+/// @class Identity krylov.hpp
+/// @brief no preconditioning
+///
+struct Identity
+{
+  int nb; ///< number of ghost cells
+
+  Identity(const int n) : nb(n)
+  {
+  }
+
+  template <class T>
+  void operator()(const NArray<T,3> &r, NArray<T,3> &z) const
+  {
+    const T* RESTRICT pr = r.data;
+    T* RESTRICT pz = z.data;
+    for_interior(r, nb, [&](int64 p) { pz[p] = pr[p]; });
+  }
+};
+
+///
+/// @class Jacobi krylov.hpp
+/// @brief diagonal (Jacobi) preconditioner with given inverse of diagonal
+///
+template <class T>
+struct Jacobi
+{
+  const NArray<T,3> &dinv; ///< inverse of diagonal elements
+  int nb;                  ///< number of ghost cells
+
+  Jacobi(const NArray<T,3> &d, const int n) : dinv(d), nb(n)
+  {
+  }
+
+  void operator()(const NArray<T,3> &r, NArray<T,3> &z) const
+  {
+    const T* RESTRICT pd = dinv.data;
+    const T* RESTRICT pr = r.data;
+    T* RESTRICT pz = z.data;
+    for_interior(r, nb, [&](int64 p) { pz[p] = pd[p]*pr[p]; });
+  }
+};
+//@}
+
+// work vectors of the same shape
+template <class T>
+class Workspace
+{
+private:
+  std::vector< std::unique_ptr< NArray<T,3> > > m_vec;
+
+public:
+  Workspace(const NArray<T,3> &x, const int n)
+  {
+    for(int i=0; i < n ;i++) {
+      m_vec.emplace_back(new NArray<T,3>(x.shape[0], x.shape[1], x.shape[2]));
+      NArray<T,3> &v = *m_vec.back();
+      for(uint64 p=0; p < v.getSize() ;p++) v.data[p] = 0;
+    }
+  }
+
+  NArray<T,3>& operator[](const int i)
+  {
+    return *m_vec[i];
+  }
+};
+
+///
+/// @brief preconditioned pipelined CG for symmetric positive definite A
+///
+/// x is the initial guess on input and the solution on output. A single
+/// non-blocking reduction of (r,u), (w,u), (r,r) is overlapped with the
+/// preconditioner and operator applications in each iteration.
+///
+template <class T, class Op, class Pc>
+Status cg(Op &A, Pc &M, const NArray<T,3> &b, NArray<T,3> &x, const int nb,
+          const float64 tol=TOLERANCE, const int maxiter=1000)
+{
+  Workspace<T> ws(x, 9);
+  NArray<T,3> &r = ws[0];
+  NArray<T,3> &u = ws[1];
+  NArray<T,3> &w = ws[2];
+  NArray<T,3> &m = ws[3];
+  NArray<T,3> &n = ws[4];
+  NArray<T,3> &z = ws[5];
+  NArray<T,3> &q = ws[6];
+  NArray<T,3> &s = ws[7];
+  NArray<T,3> &p = ws[8];
+
+  T* RESTRICT px = x.data;
+  T* RESTRICT pr = r.data;
+  T* RESTRICT pu = u.data;
+  T* RESTRICT pw = w.data;
+  T* RESTRICT pm = m.data;
+  T* RESTRICT pn = n.data;
+  T* RESTRICT pz = z.data;
+  T* RESTRICT pq = q.data;
+  T* RESTRICT ps = s.data;
+  T* RESTRICT pp = p.data;
+  const T* RESTRICT pb = b.data;
+
+  Status status = {0, 0, false};
+  float64 local[4], global[4];
+  float64 bnorm = 1, alpha = 0, gamma0 = 0;
+  MPI_Request req;
+
+  // r = b - A x, u = M^{-1} r, w = A u
+  A(x, r);
+  for_interior(x, nb, [&](int64 i) { pr[i] = pb[i] - pr[i]; });
+  M(r, u);
+  A(u, w);
+  sum_interior<4>(x, nb, local, [&](int64 i, float64 *t)
+                  {
+                    t[0] = pr[i]*pu[i];
+                    t[1] = pw[i]*pu[i];
+                    t[2] = pr[i]*pr[i];
+                    t[3] = pb[i]*pb[i];
+                  });
+
+  for(int it=0; it <= maxiter ;it++) {
+    mpiutils::reduce_begin(local, global, it == 0 ? 4 : 3, MPI_DOUBLE,
+                           MPI_SUM, &req);
+
+    // overlapped with reduction
+    M(w, m);
+    A(m, n);
+
+    mpiutils::wait(&req, 1);
+    if( it == 0 && global[3] > 0 ) bnorm = std::sqrt(global[3]);
+
+    const float64 gamma = global[0];
+    const float64 delta = global[1];
+    status.iteration = it;
+    status.residual  = std::sqrt(global[2]) / bnorm;
+    if( status.residual < tol ) {
+      status.converged = true;
+      break;
+    }
+
+    float64 beta = 0;
+    float64 den  = delta;
+    if( it > 0 ) {
+      beta = gamma / gamma0;
+      den  = delta - beta*gamma/alpha;
+    }
+    if( std::fabs(den) <= NORMMIN*std::fabs(gamma) || it == maxiter ) break;
+    alpha  = gamma / den;
+    gamma0 = gamma;
+
+    // fused vector updates and local inner products
+    const T a = alpha;
+    const T c = beta;
+    sum_interior<3>(x, nb, local, [&](int64 i, float64 *t)
+                    {
+                      pz[i] = pn[i] + c*pz[i];
+                      pq[i] = pm[i] + c*pq[i];
+                      ps[i] = pw[i] + c*ps[i];
+                      pp[i] = pu[i] + c*pp[i];
+                      px[i] = px[i] + a*pp[i];
+                      pr[i] = pr[i] - a*ps[i];
+                      pu[i] = pu[i] - a*pq[i];
+                      pw[i] = pw[i] - a*pz[i];
+                      t[0] = pr[i]*pu[i];
+                      t[1] = pw[i]*pu[i];
+                      t[2] = pr[i]*pr[i];
+                    });
+  }
+
+  return status;
+}
+
+///
+/// @brief right-preconditioned pipelined BiCGStab
+///
+/// x is the initial guess on input and the solution on output. The method
+/// is applied to A M^{-1} e = r0 for the correction x - x0 = M^{-1} e, so
+/// that the residual is that of the original system.
+///
+template <class T, class Op, class Pc>
+Status bicgstab(Op &A, Pc &M, const NArray<T,3> &b, NArray<T,3> &x,
+                const int nb, const float64 tol=TOLERANCE,
+                const int maxiter=1000)
+{
+  Workspace<T> ws(x, 12);
+  NArray<T,3> &r  = ws[0];
+  NArray<T,3> &rh = ws[1];
+  NArray<T,3> &w  = ws[2];
+  NArray<T,3> &t  = ws[3];
+  NArray<T,3> &p  = ws[4];
+  NArray<T,3> &s  = ws[5];
+  NArray<T,3> &z  = ws[6];
+  NArray<T,3> &v  = ws[7];
+  NArray<T,3> &q  = ws[8];
+  NArray<T,3> &y  = ws[9];
+  NArray<T,3> &e  = ws[10];
+  NArray<T,3> &h  = ws[11];
+
+  T* RESTRICT px  = x.data;
+  T* RESTRICT pr  = r.data;
+  T* RESTRICT prh = rh.data;
+  T* RESTRICT pw  = w.data;
+  T* RESTRICT pt  = t.data;
+  T* RESTRICT pp  = p.data;
+  T* RESTRICT ps  = s.data;
+  T* RESTRICT pz  = z.data;
+  T* RESTRICT pv  = v.data;
+  T* RESTRICT pq  = q.data;
+  T* RESTRICT py  = y.data;
+  T* RESTRICT pe  = e.data;
+  T* RESTRICT ph  = h.data;
+  const T* RESTRICT pb = b.data;
+
+  // preconditioned operator out = A M^{-1} in
+  auto B = [&](NArray<T,3> &in, NArray<T,3> &out)
+    {
+      M(in, h);
+      A(h, out);
+    };
+
+  Status status = {0, 0, false};
+  float64 local[5], global[5];
+  float64 bnorm = 1, alpha = 0, beta = 0, omega = 0, rho = 0, qy = 0;
+  MPI_Request req;
+
+  // r = b - A x, rh = r, w = B r, t = B w
+  A(x, r);
+  for_interior(x, nb, [&](int64 i)
+               {
+                 pr[i]  = pb[i] - pr[i];
+                 prh[i] = pr[i];
+               });
+  B(r, w);
+  sum_interior<4>(x, nb, local, [&](int64 i, float64 *u)
+                  {
+                    u[0] = prh[i]*pr[i];
+                    u[1] = prh[i]*pw[i];
+                    u[2] = pr[i]*pr[i];
+                    u[3] = pb[i]*pb[i];
+                  });
+  mpiutils::reduce_begin(local, global, 4, MPI_DOUBLE, MPI_SUM, &req);
+  B(w, t);
+  mpiutils::wait(&req, 1);
+
+  if( global[3] > 0 ) bnorm = std::sqrt(global[3]);
+  status.residual = std::sqrt(global[2]) / bnorm;
+  if( status.residual < tol ) {
+    status.converged = true;
+    return status;
+  }
+  // lower bound of inner products for breakdown
+  const float64 eps = NORMMIN*NORMMIN*bnorm*bnorm;
+
+  if( std::fabs(global[1]) < eps ) return status;
+  rho   = global[0];
+  alpha = rho / global[1];
+
+  for(int it=1; it <= maxiter ;it++) {
+    status.iteration = it;
+
+    // first half step
+    {
+      const T a  = alpha;
+      const T c  = beta;
+      const T cw = beta*omega;
+      sum_interior<3>(x, nb, local, [&](int64 i, float64 *u)
+                      {
+                        pp[i] = pr[i] + c*pp[i] - cw*ps[i];
+                        ps[i] = pw[i] + c*ps[i] - cw*pz[i];
+                        pz[i] = pt[i] + c*pz[i] - cw*pv[i];
+                        pq[i] = pr[i] - a*ps[i];
+                        py[i] = pw[i] - a*pz[i];
+                        u[0] = pq[i]*py[i];
+                        u[1] = py[i]*py[i];
+                        u[2] = pq[i]*pq[i];
+                      });
+      mpiutils::reduce_begin(local, global, 3, MPI_DOUBLE, MPI_SUM, &req);
+      B(z, v);
+      mpiutils::wait(&req, 1);
+
+      if( global[1] < eps ) {
+        // omega is undefined; stop at the first half step with residual q
+        for_interior(x, nb, [&](int64 i) { pe[i] += a*pp[i]; });
+        status.residual  = std::sqrt(global[2]) / bnorm;
+        status.converged = status.residual < tol;
+        break;
+      }
+      qy    = global[0];
+      omega = qy / global[1];
+    }
+
+    // second half step
+    {
+      const T a = alpha;
+      const T o = omega;
+      sum_interior<5>(x, nb, local, [&](int64 i, float64 *u)
+                      {
+                        pe[i] = pe[i] + a*pp[i] + o*pq[i];
+                        pr[i] = pq[i] - o*py[i];
+                        pw[i] = py[i] - o*(pt[i] - a*pv[i]);
+                        u[0] = prh[i]*pr[i];
+                        u[1] = prh[i]*pw[i];
+                        u[2] = prh[i]*ps[i];
+                        u[3] = prh[i]*pz[i];
+                        u[4] = pr[i]*pr[i];
+                      });
+      mpiutils::reduce_begin(local, global, 5, MPI_DOUBLE, MPI_SUM, &req);
+      B(w, t);
+      mpiutils::wait(&req, 1);
+
+      status.residual = std::sqrt(global[4]) / bnorm;
+      if( status.residual < tol ) {
+        status.converged = true;
+        break;
+      }
+
+      // omega = (q,y)/(y,y) vanishes relative to the scale of (q,y)
+      if( std::fabs(rho) < eps || std::fabs(qy) < eps ) break;
+      beta = (alpha/omega) * (global[0]/rho);
+      rho  = global[0];
+
+      const float64 den = global[1] + beta*global[2] - beta*omega*global[3];
+      if( std::fabs(den) < eps ) break;
+      alpha = rho / den;
+    }
+  }
+
+  // x = x0 + M^{-1} e
+  M(e, h);
+  for_interior(x, nb, [&](int64 i) { px[i] += ph[i]; });
+
+  return status;
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,309 @@
+// -*- C++ -*-
+#ifndef _LOOPNEST_HPP_
+#define _LOOPNEST_HPP_
+
+///
+/// Compile-Time Loop Nest Generator
+///
+/// static_for and static_nd_for expand loops with compile-time bounds (e.g.,
+/// over SArray dimensions) completely, passing indices to the loop body as
+/// constants (std::integral_constant, implicitly converted to int).
+///
+/// nd_for generates a rank-generic loop nest over an index range of NArray
+/// with run-time bounds. The loop order and tile sizes are given as template
+/// parameters, and the innermost loop is vectorized with "omp simd". The
+/// kernel is always called as f(i0, i1, ..., iR-1) in the dimension order,
+/// irrespective of the loop order, so that it is written only once. Indices
+/// are passed as int (as NArray::operator()), such that the compiler can
+/// prove that the innermost access is contiguous:
+///
+///   // row-major order without tiling, excluding one ghost cell
+///   loopnest::nd_for(loopnest::range(a, 1),
+///                    [&](int i, int j, int k) { ... });
+///
+///   // loop order i -> k -> j (innermost) with 16x16 tiles in i and k
+///   typedef loopnest::Order<0,2,1>   O;
+///   typedef loopnest::Tile<16,0,16>  T;
+///   loopnest::nd_for<O,T>(loopnest::range(a), kernel);
+///
+/// Tile loops are nested in the same order as the element loops. Note that
+/// the kernel must be safe for SIMD execution along the innermost loop.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace loopnest
+{
+/// @name compile-time loops
+//@{
+template <int I, int N>
+struct StaticFor
+{
+  template <class F>
+  static INLINE void apply(F &&f)
+  {
+    f(std::integral_constant<int,I>());
+    StaticFor<I+1,N>::apply(f);
+  }
+};
+
+template <int N>
+struct StaticFor<N,N>
+{
+  template <class F>
+  static INLINE void apply(F &&)
+  {
+  }
+};
+
+template <size_t... N>
+struct StaticNDFor;
+
+template <>
+struct StaticNDFor<>
+{
+  template <class F, class... I>
+  static INLINE void apply(F &&f, I... i)
+  {
+    f(i...);
+  }
+};
+
+template <size_t N0, size_t... N>
+struct StaticNDFor<N0, N...>
+{
+  template <class F, class... I>
+  static INLINE void apply(F &&f, I... i)
+  {
+    StaticFor<0,N0>::apply([&](auto k)
+                           {
+                             StaticNDFor<N...>::apply(f, i..., k);
+                           });
+  }
+};
+
+template <class A, class F, size_t... I>
+INLINE void static_array_for(F &&f, std::index_sequence<I...>)
+{
+  StaticNDFor<A::dims[I]...>::apply(f);
+}
+
+/// call f(K) for K = B, ..., E-1
+template <int B, int E, class F>
+INLINE void static_for(F &&f)
+{
+  StaticFor<B,E>::apply(f);
+}
+
+/// call f(K0, K1, ...) for 0 <= Kd < Nd in row-major order
+template <size_t... N, class F>
+INLINE void static_nd_for(F &&f)
+{
+  StaticNDFor<N...>::apply(f);
+}
+
+/// call f(K0, K1, ...) for all the indices of SArray type A
+template <class A, class F>
+INLINE void static_nd_for(F &&f)
+{
+  static_array_for<A>(f, std::make_index_sequence<A::ndim>());
+}
+//@}
+
+/// @name loop nest specification
+//@{
+/// loop order from outermost to innermost dimension
+template <int... I>
+struct Order
+{
+  enum { rank = sizeof...(I) };
+  static constexpr int value[sizeof...(I)] = {I...};
+};
+
+template <int... I>
+constexpr int Order<I...>::value[];
+
+/// tile size for each dimension (0 for no tiling)
+template <int... N>
+struct Tile
+{
+  enum { rank = sizeof...(N) };
+  static constexpr int value[sizeof...(N)] = {N...};
+};
+
+template <int... N>
+constexpr int Tile<N...>::value[];
+
+template <class S>
+struct Default;
+
+template <int... I>
+struct Default< std::integer_sequence<int,I...> >
+{
+  typedef Order<I...>     order;
+  typedef Tile<(I*0)...>  tile;
+};
+
+/// row-major order
+template <int R>
+using RowMajor = typename Default< std::make_integer_sequence<int,R> >::order;
+
+/// no tiling
+template <int R>
+using NoTile = typename Default< std::make_integer_sequence<int,R> >::tile;
+
+/// index range [lo, hi) in each dimension
+template <int R>
+struct Range
+{
+  int64 lo[R];
+  int64 hi[R];
+};
+
+/// return index range of NArray excluding margin (e.g., ghost cells)
+template <class T, int R>
+Range<R> range(const NArray<T,R> &a, const int64 margin=0)
+{
+  Range<R> r;
+  for(int d=0; d < R ;d++) {
+    r.lo[d] = margin;
+    r.hi[d] = a.shape[d] - margin;
+  }
+  return r;
+}
+//@}
+
+///
+/// @class Nest loopnest.hpp
+/// @brief loop nest with given order and tile sizes
+///
+template <class O, class T, int R>
+struct Nest
+{
+  static_assert(O::rank == R && T::rank == R, "rank mismatch");
+
+  // call kernel with index of dimension In replaced by i
+  template <int In, class F, size_t... I>
+  static INLINE void call(F &f, const int *idx, const int i,
+                          std::index_sequence<I...>)
+  {
+    f((static_cast<int>(I) == In ? i : idx[I])...);
+  }
+
+  // element loop at depth D
+  template <int D, bool Inner = (D == R-1)>
+  struct Point
+  {
+    template <class F>
+    static INLINE void apply(F &f, const int64 *lo, const int64 *hi,
+                             int *idx)
+    {
+      const int d = O::value[D];
+      for(int i=lo[d]; i < hi[d] ;i++) {
+        idx[d] = i;
+        Point<D+1>::apply(f, lo, hi, idx);
+      }
+    }
+  };
+
+  // innermost element loop
+  template <int D>
+  struct Point<D,true>
+  {
+    template <class F>
+    static INLINE void apply(F &f, const int64 *lo, const int64 *hi,
+                             int *idx)
+    {
+      const int d = O::value[D];
+      const int l = lo[d];
+      const int h = hi[d];
+      int j[R];
+      for(int k=0; k < R ;k++) j[k] = idx[k];
+#pragma omp simd
+      for(int i=l; i < h ;i++) {
+        call<d>(f, j, i, std::make_index_sequence<R>());
+      }
+    }
+  };
+
+  // tile loop at depth D
+  template <int D, bool Last = (D == R)>
+  struct Block
+  {
+    template <class F>
+    static INLINE void apply(F &f, const int64 *lo, const int64 *hi,
+                             int64 *blo, int64 *bhi)
+    {
+      const int   d = O::value[D];
+      const int64 n = T::value[d];
+      if( n > 0 ) {
+        for(int64 b=lo[d]; b < hi[d] ;b+=n) {
+          blo[d] = b;
+          bhi[d] = std::min(b+n, hi[d]);
+          Block<D+1>::apply(f, lo, hi, blo, bhi);
+        }
+      } else {
+        blo[d] = lo[d];
+        bhi[d] = hi[d];
+        Block<D+1>::apply(f, lo, hi, blo, bhi);
+      }
+    }
+  };
+
+  // all tile loops are done
+  template <int D>
+  struct Block<D,true>
+  {
+    template <class F>
+    static INLINE void apply(F &f, const int64 *, const int64 *,
+                             int64 *blo, int64 *bhi)
+    {
+      int idx[R] = {};
+      Point<0>::apply(f, blo, bhi, idx);
+    }
+  };
+
+  template <class F>
+  static void apply(const Range<R> &r, F &f)
+  {
+    int64 blo[R];
+    int64 bhi[R];
+    Block<0>::apply(f, r.lo, r.hi, blo, bhi);
+  }
+};
+
+/// @name rank-generic loop nest
+//@{
+/// row-major order without tiling
+template <int R, class F>
+INLINE void nd_for(const Range<R> &r, F &&f)
+{
+  Nest<RowMajor<R>,NoTile<R>,R>::apply(r, f);
+}
+
+/// given loop order without tiling
+template <class O, int R, class F>
+INLINE void nd_for(const Range<R> &r, F &&f)
+{
+  Nest<O,NoTile<R>,R>::apply(r, f);
+}
+
+/// given loop order and tile sizes
+template <class O, class T, int R, class F>
+INLINE void nd_for(const Range<R> &r, F &&f)
+{
+  Nest<O,T,R>::apply(r, f);
+}
+//@}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
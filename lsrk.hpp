@@ -0,0 +1,382 @@
+// -*- C++ -*-
+#ifndef _LSRK_HPP_
+#define _LSRK_HPP_
+
+///
+/// Low-Storage Runge-Kutta Time Integrators
+///
+/// Explicit Runge-Kutta schemes for du/dt = L(t, u), where u is a set of
+/// fields (NArray of the same type and rank, not necessarily the same shape),
+/// which need only a few registers of the size of u instead of one register
+/// for each stage.
+///
+/// RK2N implements 2N-storage schemes of Williamson: for each stage s
+///
+///   du := A[s] du + dt L(t + C[s] dt, u)
+///   u  := u + B[s] du
+///
+/// RK3S implements 3S* schemes of Ketcheson: with S1 = u, S2 = 0, S3 = u at
+/// the beginning, for each stage s
+///
+///   S2 := S2 + D[s] S1
+///   S1 := G1[s] S1 + G2[s] S2 + G3[s] S3 + B[s] dt L(t + C[s] dt, S1)
+///
+/// The right-hand side is given as a function object called for each stage
+///
+///   rhs(t, u, du, a, b)
+///
+/// which should compute du := a du + b L(t, u) for each field, where u and du
+/// are std::vector of pointers to NArray. Evaluating L with a stencil and
+/// accumulating in the same loop makes a 2N scheme really need only two
+/// registers (u and du). Note that du should not be read if a = 0. For a 3S*
+/// scheme, L(S1) is computed into one more register with a = 0, because L
+/// cannot be evaluated in-place with a stencil; S2 (and S3) are allocated
+/// only if the scheme uses them.
+///
+/// The register updates of a stage are fused into a single elementwise loop
+/// (parallelized by OpenMP), which reads only the registers with nonzero
+/// coefficients. The stage times C are computed from the coefficients.
+///
+/// Available schemes are (stages, order):
+/// - WILLIAMSON3 (3, 3) : Williamson (1980)
+/// - CARPENTER4  (5, 4) : Carpenter and Kennedy (1994)
+/// - SSP33       (3, 3) : Shu and Osher (1988), SSP coefficient 1
+/// - SSP104     (10, 4) : Ketcheson (2008), SSP coefficient 6
+///
+/// $Id$
+///
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace lsrk
+{
+/// 2N-storage schemes
+enum { WILLIAMSON3 = 0, CARPENTER4 };
+
+/// 3S* schemes
+enum { SSP33 = 0, SSP104 };
+
+/// @name allocate array of the same shape
+//@{
+template <class T>
+NArray<T,1>* create(const NArray<T,1> &x)
+{
+  return new NArray<T,1>(x.shape[0]);
+}
+
+template <class T>
+NArray<T,2>* create(const NArray<T,2> &x)
+{
+  return new NArray<T,2>(x.shape[0], x.shape[1]);
+}
+
+template <class T>
+NArray<T,3>* create(const NArray<T,3> &x)
+{
+  return new NArray<T,3>(x.shape[0], x.shape[1], x.shape[2]);
+}
+
+template <class T>
+NArray<T,4>* create(const NArray<T,4> &x)
+{
+  return new NArray<T,4>(x.shape[0], x.shape[1], x.shape[2], x.shape[3]);
+}
+//@}
+
+///
+/// @class Register lsrk.hpp
+/// @brief zero-filled storage of the same shape as a set of fields
+///
+template <class T, int R>
+class Register
+{
+public:
+  typedef std::vector< NArray<T,R>* > Fields;
+
+private:
+  std::vector< std::unique_ptr< NArray<T,R> > > m_store;
+  Fields m_field;
+
+public:
+  /// allocate (again) if the fields do not match
+  void allocate(const Fields &u)
+  {
+    bool match = m_store.size() == u.size();
+    for(size_t f=0; match && f < u.size() ;f++) {
+      match = m_store[f]->getSize() == u[f]->getSize();
+    }
+    if( match ) return;
+
+    m_store.clear();
+    m_field.clear();
+    for(size_t f=0; f < u.size() ;f++) {
+      m_store.emplace_back(create(*u[f]));
+      m_field.push_back(m_store.back().get());
+
+      T* RESTRICT p = m_field.back()->data;
+      const int64 n = m_field.back()->getSize();
+#pragma omp parallel for simd schedule(static)
+      for(int64 i=0; i < n ;i++) {
+        p[i] = 0;
+      }
+    }
+  }
+
+  Fields& get()
+  {
+    return m_field;
+  }
+
+  NArray<T,R>& operator[](const int f)
+  {
+    return *m_field[f];
+  }
+};
+
+///
+/// @class RK2N lsrk.hpp
+/// @brief 2N-storage Runge-Kutta scheme of Williamson
+///
+template <class T, int R>
+class RK2N
+{
+public:
+  typedef std::vector< NArray<T,R>* > Fields;
+
+private:
+  std::vector<float64> m_a;
+  std::vector<float64> m_b;
+  std::vector<float64> m_c;
+  Register<T,R>        m_du;
+
+public:
+  RK2N(const int scheme=CARPENTER4)
+  {
+    if( scheme == WILLIAMSON3 ) {
+      const float64 a[3] = {0.0, -5.0/9.0, -153.0/128.0};
+      const float64 b[3] = {1.0/3.0, 15.0/16.0, 8.0/15.0};
+      m_a.assign(a, a+3);
+      m_b.assign(b, b+3);
+    } else {
+      const float64 a[5] = {
+        0.0,
+        -567301805773.0 / 1357537059087.0,
+        -2404267990393.0 / 2016746695238.0,
+        -3550918686646.0 / 2091501179385.0,
+        -1275806237668.0 / 842570457699.0 };
+      const float64 b[5] = {
+        1432997174477.0 / 9575080441755.0,
+        5161836677717.0 / 13612068292357.0,
+        1720146321549.0 / 2090206949498.0,
+        3134564353537.0 / 4481467310338.0,
+        2277821191437.0 / 14882151754819.0 };
+      m_a.assign(a, a+5);
+      m_b.assign(b, b+5);
+    }
+
+    // stage time: du = a du + (1, ...) and u = u + b du in terms of sum of L
+    float64 cu = 0, cd = 0;
+    for(size_t s=0; s < m_a.size() ;s++) {
+      m_c.push_back(cu);
+      cd = m_a[s]*cd + 1;
+      cu = cu + m_b[s]*cd;
+    }
+  }
+
+  int getStages() const
+  {
+    return m_a.size();
+  }
+
+  /// advance u from t to t + dt
+  template <class Rhs>
+  void step(Rhs &rhs, Fields &u, const float64 t, const float64 dt)
+  {
+    m_du.allocate(u);
+    Fields &du = m_du.get();
+
+    for(size_t s=0; s < m_a.size() ;s++) {
+      rhs(t + m_c[s]*dt, u, du, static_cast<T>(m_a[s]), static_cast<T>(dt));
+
+      const T b = m_b[s];
+      for(size_t f=0; f < u.size() ;f++) {
+        T* RESTRICT       up = u[f]->data;
+        const T* RESTRICT dp = du[f]->data;
+        const int64 n = u[f]->getSize();
+#pragma omp parallel for simd schedule(static)
+        for(int64 i=0; i < n ;i++) {
+          up[i] += b*dp[i];
+        }
+      }
+    }
+  }
+};
+
+///
+/// @class RK3S lsrk.hpp
+/// @brief 3S* low-storage Runge-Kutta scheme of Ketcheson
+///
+template <class T, int R>
+class RK3S
+{
+public:
+  typedef std::vector< NArray<T,R>* > Fields;
+
+private:
+  std::vector<float64> m_g1;
+  std::vector<float64> m_g2;
+  std::vector<float64> m_g3;
+  std::vector<float64> m_b;
+  std::vector<float64> m_d;
+  std::vector<float64> m_c;
+  bool                 m_use2;
+  bool                 m_use3;
+  Register<T,R>        m_s2;
+  Register<T,R>        m_s3;
+  Register<T,R>        m_du;
+
+  // mode of S2 and S3 in a stage: not used, initialized, or updated
+  enum { NONE = 0, INIT, UPDATE };
+
+  // fused stage update: S2 is zero and S3 = S1 when initialized
+  template <int M2, int M3>
+  void update(const int s, Fields &u)
+  {
+    const T g1 = m_g1[s];
+    const T g2 = m_g2[s];
+    const T g3 = m_g3[s];
+    const T d  = m_d[s];
+
+    for(size_t f=0; f < u.size() ;f++) {
+      T* RESTRICT       s1 = u[f]->data;
+      T* RESTRICT       s2 = M2 != NONE ? m_s2[f].data : 0;
+      T* RESTRICT       s3 = M3 != NONE ? m_s3[f].data : 0;
+      const T* RESTRICT dp = m_du[f].data;
+      const int64 n = u[f]->getSize();
+#pragma omp parallel for simd schedule(static)
+      for(int64 i=0; i < n ;i++) {
+        const T x1 = s1[i];
+        T v = g1*x1 + dp[i];
+        if( M2 != NONE ) {
+          const T x2 = (M2 == INIT ? 0 : s2[i]) + d*x1;
+          s2[i] = x2;
+          v += g2*x2;
+        }
+        if( M3 != NONE ) {
+          if( M3 == INIT ) s3[i] = x1;
+          v += g3*(M3 == INIT ? x1 : s3[i]);
+        }
+        s1[i] = v;
+      }
+    }
+  }
+
+  template <int M2>
+  void update(const int s, Fields &u, const int m3)
+  {
+    switch( m3 ) {
+    case NONE:
+      update<M2, NONE>(s, u);
+      break;
+    case INIT:
+      update<M2, INIT>(s, u);
+      break;
+    default:
+      update<M2, UPDATE>(s, u);
+      break;
+    }
+  }
+
+  void update(const int s, Fields &u, const int m2, const int m3)
+  {
+    switch( m2 ) {
+    case NONE:
+      update<NONE>(s, u, m3);
+      break;
+    case INIT:
+      update<INIT>(s, u, m3);
+      break;
+    default:
+      update<UPDATE>(s, u, m3);
+      break;
+    }
+  }
+
+public:
+  RK3S(const int scheme=SSP104)
+  {
+    if( scheme == SSP33 ) {
+      const float64 g1[3] = {1.0, 1.0/4.0, 2.0/3.0};
+      const float64 g3[3] = {0.0, 3.0/4.0, 1.0/3.0};
+      const float64 b[3]  = {1.0, 1.0/4.0, 2.0/3.0};
+      m_g1.assign(g1, g1+3);
+      m_g2.assign(3, 0.0);
+      m_g3.assign(g3, g3+3);
+      m_b.assign(b, b+3);
+      m_d.assign(3, 0.0);
+    } else {
+      // five forward Euler steps of dt/6, a combination, and five more
+      const float64 g1[10] = {1, 1, 1, 1, 2.0/5.0, 1, 1, 1, 1, 3.0/5.0};
+      const float64 g3[10] = {0, 0, 0, 0, 3.0/5.0, 0, 0, 0, 0, -1.0/2.0};
+      const float64 b[10]  = {1.0/6.0, 1.0/6.0, 1.0/6.0, 1.0/6.0, 1.0/15.0,
+                              1.0/6.0, 1.0/6.0, 1.0/6.0, 1.0/6.0, 1.0/10.0};
+      m_g1.assign(g1, g1+10);
+      m_g2.assign(10, 0.0);
+      m_g2[9] = 1.0;
+      m_g3.assign(g3, g3+10);
+      m_b.assign(b, b+10);
+      m_d.assign(10, 0.0);
+      m_d[5] = 9.0/10.0;
+    }
+
+    // stage time in terms of sum of coefficients of L in each register
+    float64 c1 = 0, c2 = 0;
+    m_use2 = false;
+    m_use3 = false;
+    for(size_t s=0; s < m_b.size() ;s++) {
+      m_c.push_back(c1);
+      c2 = c2 + m_d[s]*c1;
+      c1 = m_g1[s]*c1 + m_g2[s]*c2 + m_b[s];
+      m_use2 |= m_d[s] != 0 || m_g2[s] != 0;
+      m_use3 |= m_g3[s] != 0;
+    }
+  }
+
+  int getStages() const
+  {
+    return m_b.size();
+  }
+
+  /// advance u from t to t + dt
+  template <class Rhs>
+  void step(Rhs &rhs, Fields &u, const float64 t, const float64 dt)
+  {
+    if( m_use2 ) m_s2.allocate(u);
+    if( m_use3 ) m_s3.allocate(u);
+    m_du.allocate(u);
+
+    bool zero2 = true;
+    for(size_t s=0; s < m_b.size() ;s++) {
+      rhs(t + m_c[s]*dt, u, m_du.get(), static_cast<T>(0),
+          static_cast<T>(m_b[s]*dt));
+
+      // S2 = 0 until the first stage which uses it, and S3 = u at first
+      int m2 = NONE;
+      if( m_d[s] != 0 || m_g2[s] != 0 ) {
+        m2 = zero2 ? INIT : UPDATE;
+        zero2 = false;
+      }
+      const int m3 = !m_use3 ? NONE : (s == 0) ? INIT : UPDATE;
+      update(s, u, m2, m3);
+    }
+  }
+};
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
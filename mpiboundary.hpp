@@ -0,0 +1,194 @@
+// -*- C++ -*-
+#ifndef _MPIBOUNDARY_HPP_
+#define _MPIBOUNDARY_HPP_
+
+///
+/// Boundary Conditions for Distributed NArray
+///
+/// Ghost cells of NArray decomposed by mpiutils are filled by the halo
+/// exchange with neighbors and, at a physical boundary where mpiutils reports
+/// MPI_PROC_NULL as the neighbor (non-periodic direction), by a boundary
+/// operator of boundary.hpp. Directions 0, 1, 2 of mpiutils correspond to the
+/// first three dimensions of the array; the others (e.g., components in the
+/// last index of NArray<T,4>) are not decomposed.
+///
+/// Condition holds an operator for each of the six faces:
+///
+///   boundary::Condition<double,3> bc;
+///   bc.set(0, boundary::LOWER, boundary::Dirichlet<double>(1.0));
+///   bc.set(0, boundary::UPPER, boundary::ZeroGradient());
+///   ...
+///   bc.fill(u, nb); // exchange and physical boundary
+///
+/// Directions are processed one after another, so that edges and corners
+/// are also filled. Slabs are packed and unpacked row by row in parallel, via
+/// a buffer which is kept across calls to avoid allocation at every exchange.
+///
+/// $Id$
+///
+#include <functional>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "mpiutils.hpp"
+#include "boundary.hpp"
+
+namespace boundary
+{
+// copy slab [off, off+nb) along n1 of [n0][n1][n2] from/to contiguous buffer
+template <class T>
+void copy_slab(T* RESTRICT x, T* RESTRICT buf, const int64 n0,
+               const int64 n1, const int64 n2, const int64 off,
+               const int nb, const bool pack)
+{
+#pragma omp parallel for collapse(2) schedule(static)
+  for(int64 i=0; i < n0 ;i++) {
+    for(int j=0; j < nb ;j++) {
+      T* RESTRICT p = &x[(i*n1 + off + j)*n2];
+      T* RESTRICT b = &buf[(i*nb + j)*n2];
+      if( pack ) {
+#pragma omp simd
+        for(int64 k=0; k < n2 ;k++) b[k] = p[k];
+      } else {
+#pragma omp simd
+        for(int64 k=0; k < n2 ;k++) p[k] = b[k];
+      }
+    }
+  }
+}
+
+// buffer for slabs of element type T shared by exchange_dir() calls
+template <class T>
+std::vector<T>& exchange_buffer()
+{
+  static std::vector<T> buf;
+  return buf;
+}
+
+///
+/// @brief halo exchange of nb ghost cells along a direction via mpiutils
+///
+/// The slabs include ghost cells of the other directions. Ghost cells at a
+/// physical boundary (MPI_PROC_NULL) are not modified. The buffer buf grows
+/// to the largest slabs and is reused by later calls.
+///
+template <class T, int R>
+void exchange_dir(NArray<T,R> &x, const int nb, const int dir,
+                  std::vector<T> &buf)
+{
+  int nbr[3][2];
+  mpiutils::getNeighbors(nbr);
+
+  int64 n0 = 1, n2 = 1;
+  const int64 n1 = x.shape[dir];
+  for(int d=0; d < dir ;d++) n0 *= x.shape[d];
+  for(int d=dir+1; d < R ;d++) n2 *= x.shape[d];
+
+  // slabs: send lower, send upper, recv lower, recv upper
+  const int64 count = n0*nb*n2;
+  const int64 off[4] = {nb, n1-2*nb, 0, n1-nb};
+
+  if( buf.size() < static_cast<size_t>(4*count) ) {
+    buf.resize(4*count);
+  }
+  MPI_Request req[4];
+
+  for(int s=0; s < 2 ;s++) {
+    copy_slab(x.data, &buf[s*count], n0, n1, n2, off[s], nb, true);
+  }
+
+  mpiutils::bc_exchange_dir_begin(dir, buf.data(), sizeof(T),
+                                 static_cast<int>(count), req);
+  mpiutils::wait(req, 4);
+
+  for(int s=2; s < 4 ;s++) {
+    if( nbr[dir][s-2] == MPI_PROC_NULL ) continue;
+    copy_slab(x.data, &buf[s*count], n0, n1, n2, off[s], nb, false);
+  }
+}
+
+///
+/// @brief halo exchange of nb ghost cells along a direction
+///
+/// This uses a buffer shared by all the calls for the element type T, and
+/// should not be called concurrently by multiple threads.
+///
+template <class T, int R>
+void exchange_dir(NArray<T,R> &x, const int nb, const int dir)
+{
+  exchange_dir(x, nb, dir, exchange_buffer<T>());
+}
+
+///
+/// @brief halo exchange of nb ghost cells in all directions
+///
+template <class T, int R>
+void exchange(NArray<T,R> &x, const int nb)
+{
+  for(int dir=0; dir < 3 && dir < R ;dir++) {
+    exchange_dir(x, nb, dir);
+  }
+}
+
+///
+/// @class Condition mpiboundary.hpp
+/// @brief boundary operators for faces at physical boundaries
+///
+template <class T, int R>
+class Condition
+{
+private:
+  typedef std::function<void(NArray<T,R>&, int)> Apply;
+
+  Apply m_apply[3][2];
+
+public:
+  /// set operator for a face (no operator leaves the ghost cells untouched)
+  template <class Op>
+  void set(const int dir, const int side, const Op &op)
+  {
+    m_apply[dir][side] = [dir, side, op] (NArray<T,R> &x, const int nb)
+      {
+        apply(x, dir, side, nb, op);
+      };
+  }
+
+  /// set the same operator for all faces
+  template <class Op>
+  void set(const Op &op)
+  {
+    for(int dir=0; dir < 3 ;dir++) {
+      set(dir, LOWER, op);
+      set(dir, UPPER, op);
+    }
+  }
+
+  /// fill nb ghost cells of the faces at physical boundaries
+  void apply_physical(NArray<T,R> &x, const int nb, const int dir)
+  {
+    int nbr[3][2];
+    mpiutils::getNeighbors(nbr);
+
+    for(int side=0; side < 2 ;side++) {
+      if( nbr[dir][side] == MPI_PROC_NULL && m_apply[dir][side] ) {
+        m_apply[dir][side](x, nb);
+      }
+    }
+  }
+
+  /// fill nb ghost cells by halo exchange and physical boundary conditions
+  void fill(NArray<T,R> &x, const int nb)
+  {
+    for(int dir=0; dir < 3 && dir < R ;dir++) {
+      exchange_dir(x, nb, dir);
+      apply_physical(x, nb, dir);
+    }
+  }
+};
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,340 @@
+// -*- C++ -*-
+#ifndef _MPIFFT_HPP_
+#define _MPIFFT_HPP_
+
+///
+/// Distributed Pencil-Decomposed 3D FFT
+///
+/// A three-dimensional complex transform of global size N0 x N1 x N2 on the
+/// P0 x P1 x 1 cartesian topology of mpiutils is computed with the 2D pencil
+/// decomposition, which allows up to min(N0 N1, N1 N2) processes compared to
+/// N0 of the slab decomposition. Data are redistributed between three pencil
+/// layouts (local NArray shapes):
+///
+///   z-pencil : [N0/P0][N1/P1][N2]     (input of forward, by mpiutils)
+///   y-pencil : [N0/P0][N1][N2/P1]     (internal)
+///   x-pencil : [N0][N1/P0][N2/P1]     (output of forward)
+///
+/// The z- to y-pencil transpose is an all-to-all on the process line along
+/// direction 1 (row), and the y- to x-pencil transpose is an all-to-all on
+/// the process line along direction 0 (column), which are sub-communicators
+/// of the cartesian topology given by mpiutils::getLineComm(). Neither of
+/// them involves all the processes.
+///
+/// Both transposes keep the index along axis 0 of the z- and y-pencils, so
+/// that the work is split into chunks of rows along axis 0. Each chunk is
+/// transformed with the batched 1D FFT of fft.hpp, packed into contiguous
+/// blocks for each destination and sent by MPI_Ialltoall, so that the
+/// exchange of a chunk overlaps with the transform of the following chunks.
+/// The backward transform reverses the steps.
+///
+/// The forward transform is unnormalized with sign -1 as fft.hpp; the
+/// backward transform thus gives N0 N1 N2 times the original data.
+///
+/// N0 and N1 must be divisible by P0, and N1 and N2 by P1.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "fft.hpp"
+#include "mpiutils.hpp"
+
+namespace fft
+{
+///
+/// @class Pencil mpifft.hpp
+/// @brief pencil-decomposed 3D FFT
+///
+template <class T>
+class Pencil
+{
+private:
+  typedef std::complex<T> Complex;
+
+  int m_nchunk;     ///< number of chunks
+  int m_proc[2];    ///< number of processes in direction 0 and 1
+  int m_global[3];  ///< global shape
+  int m_zshape[3];  ///< local shape of z-pencil
+  int m_yshape[3];  ///< local shape of y-pencil
+  int m_xshape[3];  ///< local shape of x-pencil
+
+  std::vector<int>     m_row;  ///< first row of chunks along axis 0
+  std::vector<Complex> m_y;    ///< y-pencil
+  std::vector<Complex> m_sbuf; ///< send buffer
+  std::vector<Complex> m_rbuf; ///< receive buffer
+
+  // remain undefined
+  Pencil();
+  Pencil(const Pencil &);
+  Pencil& operator=(const Pencil &);
+
+  // z-pencil <-> buffer [q][i][j][k] for rows [r0, r1) of chunk
+  void zpack(Complex *z, Complex *buf, const int r0, const int r1,
+             const bool pack)
+  {
+    const int m1 = m_zshape[1];
+    const int n2 = m_zshape[2];
+    const int k2 = m_yshape[2];
+    const int rc = r1 - r0;
+
+    for(int q=0; q < m_proc[1] ;q++) {
+      for(int i=0; i < rc ;i++) {
+        for(int j=0; j < m1 ;j++) {
+          Complex* b = &buf[((static_cast<int64>(q)*rc + i)*m1 + j)*k2];
+          Complex* p = &z[(static_cast<int64>(r0 + i)*m1 + j)*n2 + q*k2];
+          if( pack ) {
+            std::copy(p, p + k2, b);
+          } else {
+            std::copy(b, b + k2, p);
+          }
+        }
+      }
+    }
+  }
+
+  // y-pencil <-> buffer [q][i][j][k] for exchange with z-pencil
+  void ypack_row(Complex *buf, const int r0, const int r1, const bool pack)
+  {
+    const int m1 = m_zshape[1];
+    const int n1 = m_yshape[1];
+    const int k2 = m_yshape[2];
+    const int rc = r1 - r0;
+
+    for(int q=0; q < m_proc[1] ;q++) {
+      for(int i=0; i < rc ;i++) {
+        for(int j=0; j < m1 ;j++) {
+          Complex* b = &buf[((static_cast<int64>(q)*rc + i)*m1 + j)*k2];
+          Complex* p = &m_y[(static_cast<int64>(r0 + i)*n1 + q*m1 + j)*k2];
+          if( pack ) {
+            std::copy(p, p + k2, b);
+          } else {
+            std::copy(b, b + k2, p);
+          }
+        }
+      }
+    }
+  }
+
+  // y-pencil <-> buffer [p][i][j][k] for exchange with x-pencil
+  void ypack_col(Complex *buf, const int r0, const int r1, const bool pack)
+  {
+    const int n1 = m_yshape[1];
+    const int j0 = m_xshape[1];
+    const int k2 = m_yshape[2];
+    const int rc = r1 - r0;
+
+    for(int p=0; p < m_proc[0] ;p++) {
+      for(int i=0; i < rc ;i++) {
+        Complex* b = &buf[(static_cast<int64>(p)*rc + i)*j0*k2];
+        Complex* y = &m_y[(static_cast<int64>(r0 + i)*n1 + p*j0)*k2];
+        if( pack ) {
+          std::copy(y, y + j0*k2, b);
+        } else {
+          std::copy(b, b + j0*k2, y);
+        }
+      }
+    }
+  }
+
+  // x-pencil <-> buffer [p][i][j][k] for rows [r0, r1) of chunk
+  void xpack(Complex *x, Complex *buf, const int r0, const int r1,
+             const bool pack)
+  {
+    const int m0 = m_zshape[0];
+    const int j0 = m_xshape[1];
+    const int k2 = m_xshape[2];
+    const int rc = r1 - r0;
+
+    for(int p=0; p < m_proc[0] ;p++) {
+      for(int i=0; i < rc ;i++) {
+        Complex* b = &buf[(static_cast<int64>(p)*rc + i)*j0*k2];
+        Complex* q = &x[static_cast<int64>(p*m0 + r0 + i)*j0*k2];
+        if( pack ) {
+          std::copy(q, q + j0*k2, b);
+        } else {
+          std::copy(b, b + j0*k2, q);
+        }
+      }
+    }
+  }
+
+  // offset of chunk c in buffers for row or column exchange
+  int64 offset(const int c, const bool row) const
+  {
+    return row ?
+      static_cast<int64>(m_row[c])*m_zshape[1]*m_zshape[2] :
+      static_cast<int64>(m_row[c])*m_yshape[1]*m_yshape[2];
+  }
+
+  // start all-to-all of chunk c
+  void start(const int c, const bool row, MPI_Request *req)
+  {
+    const int   nproc = row ? m_proc[1] : m_proc[0];
+    const int64 size  = (offset(c+1, row) - offset(c, row)) / nproc;
+    const int64 off   = offset(c, row);
+    MPI_Comm    comm  = mpiutils::getLineComm(row ? 1 : 0);
+
+    MPI_Ialltoall(&m_sbuf[off], size*sizeof(Complex), MPI_BYTE,
+                  &m_rbuf[off], size*sizeof(Complex), MPI_BYTE, comm, req);
+  }
+
+public:
+  ///
+  /// @brief constructor
+  ///
+  /// shape is the global shape of array, and the rows of local z-pencil are
+  /// divided into nchunk chunks for overlapping communication.
+  ///
+  Pencil(const int shape[3], const int nchunk=4)
+  {
+    int dims[3], period[3], coord[3];
+    MPI_Cart_get(mpiutils::getComm(), 3, dims, period, coord);
+
+    m_proc[0] = dims[0];
+    m_proc[1] = dims[1];
+    for(int d=0; d < 3 ;d++) {
+      m_global[d] = shape[d];
+    }
+
+    m_zshape[0] = shape[0] / m_proc[0];
+    m_zshape[1] = shape[1] / m_proc[1];
+    m_zshape[2] = shape[2];
+    m_yshape[0] = shape[0] / m_proc[0];
+    m_yshape[1] = shape[1];
+    m_yshape[2] = shape[2] / m_proc[1];
+    m_xshape[0] = shape[0];
+    m_xshape[1] = shape[1] / m_proc[0];
+    m_xshape[2] = shape[2] / m_proc[1];
+
+    // partition of rows
+    m_nchunk = std::max(1, std::min(nchunk, m_zshape[0]));
+    for(int c=0; c <= m_nchunk ;c++) {
+      m_row.push_back((c * m_zshape[0]) / m_nchunk);
+    }
+
+    const int64 size =
+      static_cast<int64>(m_yshape[0])*m_yshape[1]*m_yshape[2];
+    m_y.resize(size);
+    m_sbuf.resize(size);
+    m_rbuf.resize(size);
+  }
+
+  /// local shape of z-pencil (input of forward)
+  void getShapeZ(int shape[3]) const
+  {
+    std::copy(m_zshape, m_zshape+3, shape);
+  }
+
+  /// local shape of x-pencil (output of forward)
+  void getShapeX(int shape[3]) const
+  {
+    std::copy(m_xshape, m_xshape+3, shape);
+  }
+
+  ///
+  /// @brief forward transform from z-pencil to x-pencil
+  ///
+  /// z is overwritten by the transform along the last axis.
+  ///
+  void forward(NArray<Complex,3> &z, NArray<Complex,3> &x)
+  {
+    transform(z, x, FORWARD);
+  }
+
+  ///
+  /// @brief backward transform from x-pencil to z-pencil
+  ///
+  /// x is overwritten by the transform along the first axis.
+  ///
+  void backward(NArray<Complex,3> &x, NArray<Complex,3> &z)
+  {
+    transform(x, z, BACKWARD);
+  }
+
+private:
+  void transform(NArray<Complex,3> &in, NArray<Complex,3> &out,
+                 const int sign)
+  {
+    const int nc = m_nchunk;
+    std::vector<MPI_Request> req(nc);
+
+    const int m1 = m_zshape[1];
+    const int n1 = m_yshape[1];
+    const int n2 = m_zshape[2];
+    const int k2 = m_yshape[2];
+
+    if( sign == FORWARD ) {
+      Complex* z = in.data;
+      Complex* x = out.data;
+
+      // transform along axis 2 and z- to y-pencil
+      for(int c=0; c < nc ;c++) {
+        const int r0 = m_row[c];
+        const int r1 = m_row[c+1];
+        c2c(&z[static_cast<int64>(r0)*m1*n2], (r1-r0)*m1, n2, 1, sign);
+        zpack(z, &m_sbuf[offset(c, true)], r0, r1, true);
+        start(c, true, &req[c]);
+      }
+
+      // transform along axis 1 and y- to x-pencil
+      for(int c=0; c < nc ;c++) {
+        const int r0 = m_row[c];
+        const int r1 = m_row[c+1];
+        mpiutils::wait(&req[c], 1);
+        ypack_row(&m_rbuf[offset(c, true)], r0, r1, false);
+        c2c(&m_y[static_cast<int64>(r0)*n1*k2], r1-r0, n1, k2, sign);
+        ypack_col(&m_sbuf[offset(c, false)], r0, r1, true);
+        start(c, false, &req[c]);
+      }
+
+      for(int c=0; c < nc ;c++) {
+        mpiutils::wait(&req[c], 1);
+        xpack(x, &m_rbuf[offset(c, false)], m_row[c], m_row[c+1], false);
+      }
+
+      // transform along axis 0
+      c2c(out, 0, sign);
+    } else {
+      Complex* x = in.data;
+      Complex* z = out.data;
+
+      // transform along axis 0 and x- to y-pencil
+      c2c(in, 0, sign);
+      for(int c=0; c < nc ;c++) {
+        xpack(x, &m_sbuf[offset(c, false)], m_row[c], m_row[c+1], true);
+        start(c, false, &req[c]);
+      }
+
+      // transform along axis 1 and y- to z-pencil
+      for(int c=0; c < nc ;c++) {
+        const int r0 = m_row[c];
+        const int r1 = m_row[c+1];
+        mpiutils::wait(&req[c], 1);
+        ypack_col(&m_rbuf[offset(c, false)], r0, r1, false);
+        c2c(&m_y[static_cast<int64>(r0)*n1*k2], r1-r0, n1, k2, sign);
+        ypack_row(&m_sbuf[offset(c, true)], r0, r1, true);
+        start(c, true, &req[c]);
+      }
+
+      // transform along axis 2
+      for(int c=0; c < nc ;c++) {
+        const int r0 = m_row[c];
+        const int r1 = m_row[c+1];
+        mpiutils::wait(&req[c], 1);
+        zpack(z, &m_rbuf[offset(c, true)], r0, r1, false);
+        c2c(&z[static_cast<int64>(r0)*m1*n2], (r1-r0)*m1, n2, 1, sign);
+      }
+    }
+  }
+};
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
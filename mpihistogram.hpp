@@ -0,0 +1,54 @@
+// -*- C++ -*-
+#ifndef _MPIHISTOGRAM_HPP_
+#define _MPIHISTOGRAM_HPP_
+
+///
+/// Global Reduction of Histogram
+///
+/// Counts of Hist1D and Hist2D of histogram.hpp are summed over all the
+/// processes of mpiutils. The reduction is either blocking (allreduce) or
+/// non-blocking, in which case the counts must not be accessed until wait()
+/// returns:
+///
+///   MPI_Request req;
+///   histogram::allreduce_begin(h, &req);
+///   ... (other work) ...
+///   mpiutils::wait(&req, 1);
+///
+/// The counts are replaced by the global sum on every process; clear() them
+/// before the next accumulation, otherwise the local counts of the next step
+/// are added to the global sum of this step.
+///
+/// $Id$
+///
+#include "config.hpp"
+#include "mpiutils.hpp"
+#include "histogram.hpp"
+
+namespace histogram
+{
+/// begin non-blocking sum of counts over all processes
+template <class Hist>
+void allreduce_begin(Hist &h, MPI_Request *req)
+{
+  float64 *data = h.getCounts().data;
+  const int count = static_cast<int>(h.getCounts().getSize());
+  mpiutils::reduce_begin(MPI_IN_PLACE, data, count, MPI_DOUBLE, MPI_SUM,
+                         req);
+}
+
+/// sum of counts over all processes
+template <class Hist>
+void allreduce(Hist &h)
+{
+  MPI_Request req;
+  allreduce_begin(h, &req);
+  mpiutils::wait(&req, 1);
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
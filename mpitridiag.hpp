@@ -0,0 +1,370 @@
+// -*- C++ -*-
+#ifndef _MPITRIDIAG_HPP_
+#define _MPITRIDIAG_HPP_
+
+///
+/// Distributed Tridiagonal Solver
+///
+/// Tridiagonal systems along a direction split across the process line of
+/// the cartesian decomposition of mpiutils are solved by the partitioned
+/// Thomas algorithm without gathering lines:
+///
+/// 1. Each process eliminates its local rows such that every local unknown
+///    is expressed by the first and last local unknowns x[0] and x[n-1]:
+///
+///      x[i] = d[i] - a[i]*x[0] - c[i]*x[n-1]   (0 < i < n-1)
+///
+///    The first and last rows then form a reduced tridiagonal system of 2P
+///    unknowns for P processes, in which each process has two rows.
+///
+/// 2. The reduced systems are distributed over the process line by lines:
+///    each process receives the reduced rows of 1/P of the lines from all
+///    the processes by a single MPI_Alltoallv, so that the communication cost
+///    is amortized over the lines, and solves them (batched and vectorized
+///    across lines as in tridiag.hpp). A periodic system gives a cyclic
+///    reduced system. The solution is returned by another MPI_Alltoallv.
+///
+/// 3. Each process substitutes x[0] and x[n-1] to obtain the other unknowns.
+///
+/// Local elimination and substitution work in place and are vectorized
+/// across lines which are interleaved in the contiguous dimension; lines
+/// along the last axis are transposed LANES at a time into scratch memory for
+/// the elimination, and the substitution is vectorized along the lines. Only
+/// the first and last rows are copied for communication. The memory and work
+/// for the reduced systems are thus O(nl) per process for nl local lines.
+///
+/// The number of local rows must be at least 2.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "tridiag.hpp"
+#include "mpiutils.hpp"
+
+namespace tridiag
+{
+///
+/// @brief local elimination of m interleaved partitioned systems
+///
+/// a, c, d are overwritten by the coefficients of the reduced form:
+/// a[0]*x[-1] + x[0] + c[0]*x[n-1] = d[0] for the first row,
+/// a[n-1]*x[0] + x[n-1] + c[n-1]*x[n] = d[n-1] for the last row, and
+/// a[i]*x[0] + x[i] + c[i]*x[n-1] = d[i] for the others.
+///
+template <class T>
+void partition(T* RESTRICT a, const T* RESTRICT b, T* RESTRICT c,
+               T* RESTRICT d, const int64 n, const int64 stride,
+               const int64 m)
+{
+  // normalize first two rows
+  for(int64 i=0; i < 2 ;i++) {
+    const int64 ic = i*stride;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      const T r = 1/b[ic+l];
+      a[ic+l] *= r;
+      c[ic+l] *= r;
+      d[ic+l] *= r;
+    }
+  }
+
+  // forward elimination keeping coupling to x[0]
+  for(int64 i=2; i < n ;i++) {
+    const int64 ic = i*stride;
+    const int64 im = ic - stride;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      const T r = 1/(b[ic+l] - a[ic+l]*c[im+l]);
+      d[ic+l] = (d[ic+l] - a[ic+l]*d[im+l])*r;
+      a[ic+l] = -a[ic+l]*a[im+l]*r;
+      c[ic+l] = c[ic+l]*r;
+    }
+  }
+
+  // backward elimination keeping coupling to x[n-1]
+  for(int64 i=n-3; i >= 1 ;i--) {
+    const int64 ic = i*stride;
+    const int64 ip = ic + stride;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      d[ic+l] -= c[ic+l]*d[ip+l];
+      a[ic+l] -= c[ic+l]*a[ip+l];
+      c[ic+l]  = -c[ic+l]*c[ip+l];
+    }
+  }
+
+  // first row
+  if( n > 2 ) {
+    const int64 ip = stride;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      const T r = 1/(1 - c[l]*a[ip+l]);
+      d[l] = (d[l] - c[l]*d[ip+l])*r;
+      a[l] = a[l]*r;
+      c[l] = -c[l]*c[ip+l]*r;
+    }
+  }
+}
+
+///
+/// @brief substitution of x[0] and x[n-1] for m interleaved systems
+///
+/// On input, d[0] and d[n-1] are the solution of the reduced system.
+///
+template <class T>
+void substitute(const T* RESTRICT a, const T* RESTRICT c, T* RESTRICT d,
+                const int64 n, const int64 stride, const int64 m)
+{
+  const int64 in = (n-1)*stride;
+  for(int64 i=1; i < n-1 ;i++) {
+    const int64 ic = i*stride;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      d[ic+l] -= a[ic+l]*d[l] + c[ic+l]*d[in+l];
+    }
+  }
+}
+
+// substitution of x[0] and x[n-1] for m contiguous lines of size n
+template <class T>
+void substitute_lines(const T* RESTRICT a, const T* RESTRICT c, T* RESTRICT d,
+                      const int64 n, const int64 m)
+{
+  for(int64 l=0; l < m ;l++) {
+    const int64 ip = l*n;
+    const T x0 = d[ip];
+    const T xn = d[ip+n-1];
+#pragma omp simd
+    for(int64 i=ip+1; i < ip+n-1 ;i++) {
+      d[i] -= a[i]*x0 + c[i]*xn;
+    }
+  }
+}
+
+///
+/// @brief solve tridiagonal systems distributed along a direction
+///
+/// The arrays are local parts of the systems along the given axis, which is
+/// decomposed along the direction dir of mpiutils. d is overwritten by the
+/// solution, and a and c are destroyed. If periodic is true, the global
+/// systems are cyclic, where a[0] of the first process and c[n-1] of the last
+/// process are the corner coefficients.
+///
+template <class T, int Rank>
+void solve_distributed(NArray<T,Rank> &a, const NArray<T,Rank> &b,
+                       NArray<T,Rank> &c, NArray<T,Rank> &d,
+                       const int axis, const int dir,
+                       const bool periodic=false)
+{
+  MPI_Comm comm = mpiutils::getLineComm(dir);
+  int nproc, rank;
+  MPI_Comm_size(comm, &nproc);
+  MPI_Comm_rank(comm, &rank);
+
+  int64 n0 = 1;
+  int64 n1 = d.shape[axis];
+  int64 n2 = 1;
+  for(int k=0; k < axis ;k++) n0 *= d.shape[k];
+  for(int k=axis+1; k < Rank ;k++) n2 *= d.shape[k];
+
+  const int64 nl = n0*n2;       // number of lines
+  const int64 nr = 2*nproc;     // size of reduced system
+
+  T* aa = a.data;
+  const T* bb = b.data;
+  T* cc = c.data;
+  T* dd = d.data;
+
+  // lines [lo[p], lo[p+1]) of reduced systems are solved by process p
+  std::vector<int64> lo(nproc+1);
+  for(int p=0; p <= nproc ;p++) {
+    lo[p] = nl*p/nproc;
+  }
+  const int64 ml = lo[rank+1] - lo[rank];
+
+  // first and last rows of lines to be sent: [process][a, c, d][row][line]
+  std::vector<T> sbuf(6*nl);
+  auto pack = [&](const int64 l, const int64 ip, const int64 in)
+    {
+      const int p = static_cast<int>(std::upper_bound(&lo[0], &lo[nproc],
+                                                      l) - &lo[1]);
+      const int64 m = lo[p+1] - lo[p];
+      T* q = &sbuf[6*lo[p] + (l - lo[p])];
+      q[0*m] = aa[ip];
+      q[1*m] = aa[in];
+      q[2*m] = cc[ip];
+      q[3*m] = cc[in];
+      q[4*m] = dd[ip];
+      q[5*m] = dd[in];
+    };
+
+  // local elimination
+  if( n2 == 1 ) {
+    // transpose LANES contiguous lines into scratch
+    const int64 nb = (n0 + LANES - 1)/LANES;
+#pragma omp parallel
+    {
+      std::vector<T> buf(4*n1*LANES);
+      T* ta = &buf[0*n1*LANES];
+      T* tb = &buf[1*n1*LANES];
+      T* tc = &buf[2*n1*LANES];
+      T* td = &buf[3*n1*LANES];
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < nb ;ib++) {
+        const int64 l0 = ib*LANES;
+        const int64 m  = std::min<int64>(LANES, n0 - l0);
+
+        const int64 ip = l0*n1;
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            ta[i*LANES + l] = aa[ip + l*n1 + i];
+            tb[i*LANES + l] = bb[ip + l*n1 + i];
+            tc[i*LANES + l] = cc[ip + l*n1 + i];
+            td[i*LANES + l] = dd[ip + l*n1 + i];
+          }
+        }
+
+        partition(ta, tb, tc, td, n1, LANES, m);
+
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            aa[ip + l*n1 + i] = ta[i*LANES + l];
+            cc[ip + l*n1 + i] = tc[i*LANES + l];
+            dd[ip + l*n1 + i] = td[i*LANES + l];
+          }
+        }
+        for(int64 l=0; l < m ;l++) {
+          pack(l0 + l, ip + l*n1, ip + l*n1 + n1-1);
+        }
+      }
+    }
+  } else {
+    // interleaved lines without transpose
+    const int64 nb = (n2 + BLOCK - 1)/BLOCK;
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < n0*nb ;ib++) {
+      const int64 i0 = ib / nb;
+      const int64 l0 = (ib % nb) * BLOCK;
+      const int64 m  = std::min<int64>(BLOCK, n2 - l0);
+      const int64 ip = i0*n1*n2 + l0;
+      const int64 in = ip + (n1-1)*n2;
+      partition(&aa[ip], &bb[ip], &cc[ip], &dd[ip], n1, n2, m);
+      for(int64 l=0; l < m ;l++) {
+        pack(i0*n2 + l0 + l, ip + l, in + l);
+      }
+    }
+  }
+
+  // distribute reduced rows: [process][a, c, d][row][line]
+  std::vector<int> scount(nproc), sdispl(nproc), rcount(nproc), rdispl(nproc);
+  for(int p=0; p < nproc ;p++) {
+    scount[p] = static_cast<int>(6*(lo[p+1] - lo[p])*sizeof(T));
+    sdispl[p] = static_cast<int>(6*lo[p]*sizeof(T));
+    rcount[p] = static_cast<int>(6*ml*sizeof(T));
+    rdispl[p] = static_cast<int>(6*ml*p*sizeof(T));
+  }
+  std::vector<T> rbuf(6*ml*nproc);
+  MPI_Alltoallv(sbuf.data(), scount.data(), sdispl.data(), MPI_BYTE,
+                rbuf.data(), rcount.data(), rdispl.data(), MPI_BYTE, comm);
+
+  // solve reduced systems of ml lines: [a, b, c, d][row][line]
+  std::vector<T> red(4*nr*ml);
+  T* ra = &red[0*nr*ml];
+  T* rb = &red[1*nr*ml];
+  T* rc = &red[2*nr*ml];
+  T* rd = &red[3*nr*ml];
+#pragma omp parallel for schedule(static)
+  for(int64 i=0; i < nr ;i++) {
+    const T* q = &rbuf[(i/2)*6*ml + (i%2)*ml];
+    for(int64 l=0; l < ml ;l++) {
+      ra[i*ml + l] = q[0*ml + l];
+      rb[i*ml + l] = 1;
+      rc[i*ml + l] = q[2*ml + l];
+      rd[i*ml + l] = q[4*ml + l];
+    }
+  }
+  if( periodic && nproc == 1 ) {
+    // both couplings of the 2x2 system refer to the other unknown
+    for(int64 l=0; l < ml ;l++) {
+      rc[l] += ra[l];
+      ra[ml + l] += rc[ml + l];
+    }
+  }
+
+  const bool cyclic = periodic && nproc > 1;
+  const int64 nrb = (ml + BLOCK - 1)/BLOCK;
+#pragma omp parallel
+  {
+    std::vector<T> buf((2*nr + 1)*BLOCK);
+
+#pragma omp for schedule(static)
+    for(int64 ib=0; ib < nrb ;ib++) {
+      const int64 l0 = ib*BLOCK;
+      const int64 m  = std::min<int64>(BLOCK, ml - l0);
+      solve_lines(&ra[l0], &rb[l0], &rc[l0], &rd[l0], buf.data(),
+                  nr, ml, m, cyclic);
+    }
+  }
+
+  // return solution of first and last rows: [process][row][line]
+  for(int p=0; p < nproc ;p++) {
+    scount[p] = static_cast<int>(2*ml*sizeof(T));
+    sdispl[p] = static_cast<int>(2*ml*p*sizeof(T));
+    rcount[p] = static_cast<int>(2*(lo[p+1] - lo[p])*sizeof(T));
+    rdispl[p] = static_cast<int>(2*lo[p]*sizeof(T));
+  }
+  sbuf.resize(2*nl);
+  MPI_Alltoallv(rd, scount.data(), sdispl.data(), MPI_BYTE,
+                sbuf.data(), rcount.data(), rdispl.data(), MPI_BYTE, comm);
+
+  // substitution
+  auto unpack = [&](const int64 l, const int64 ip, const int64 in)
+    {
+      const int p = static_cast<int>(std::upper_bound(&lo[0], &lo[nproc],
+                                                      l) - &lo[1]);
+      const int64 m = lo[p+1] - lo[p];
+      const T* q = &sbuf[2*lo[p] + (l - lo[p])];
+      dd[ip] = q[0*m];
+      dd[in] = q[1*m];
+    };
+
+  if( n2 == 1 ) {
+    // contiguous lines
+    const int64 nb = (n0 + LANES - 1)/LANES;
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < nb ;ib++) {
+      const int64 l0 = ib*LANES;
+      const int64 m  = std::min<int64>(LANES, n0 - l0);
+      const int64 ip = l0*n1;
+      for(int64 l=0; l < m ;l++) {
+        unpack(l0 + l, ip + l*n1, ip + l*n1 + n1-1);
+      }
+      substitute_lines(&aa[ip], &cc[ip], &dd[ip], n1, m);
+    }
+  } else {
+    const int64 nb = (n2 + BLOCK - 1)/BLOCK;
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < n0*nb ;ib++) {
+      const int64 i0 = ib / nb;
+      const int64 l0 = (ib % nb) * BLOCK;
+      const int64 m  = std::min<int64>(BLOCK, n2 - l0);
+      const int64 ip = i0*n1*n2 + l0;
+      const int64 in = ip + (n1-1)*n2;
+      for(int64 l=0; l < m ;l++) {
+        unpack(i0*n2 + l0 + l, ip + l, in + l);
+      }
+      substitute(&aa[ip], &cc[ip], &dd[ip], n1, n2, m);
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
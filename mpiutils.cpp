@@ -98,6 +98,16 @@ void mpiutils::bc_exchange_dir_begin(int dir, mpiutils::Buffer *buf)
             comm, &buf->request[3]);
 }
 
+//
+// begin non-blocking global reduction over all the processes
+//
+void mpiutils::reduce_begin(const void *sbuf, void *rbuf, int count,
+                            MPI_Datatype dtype, MPI_Op op,
+                            MPI_Request *req)
+{
+  MPI_Iallreduce(sbuf, rbuf, count, dtype, op, instance->m_cart, req);
+}
+
 //
 // wait for all MPI requests to complete
 //
@@ -213,6 +223,24 @@ int main(int argc, char **argv)
                              buf2[3*N2+0], buf2[3*N2+1], buf2[3*N2+2]);
   }
 
+  // test non-blocking reduction
+  {
+    const int rank = mpiutils::getThisRank();
+    const int np   = mpiutils::getNProcess();
+    mpiutils::Reduction rmax, rmin;
+
+    rmax.begin(rank + 0.5, MPI_MAX);
+    rmin.begin(rank + 0.5, MPI_MIN);
+
+    // results
+    double gmax = rmax.get();
+    double gmin = rmin.get();
+    std::cerr << "--- results of non-blocking reduction ---" << std::endl;
+    std::cerr << tfm::format("max = %5.1f (expected %5.1f)\n"
+                             "min = %5.1f (expected %5.1f)\n",
+                             gmax, np - 0.5, gmin, 0.5);
+  }
+
   // finalize
   mpiutils::finalize();
 
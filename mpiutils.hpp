@@ -130,6 +130,7 @@ private:
   int m_rank_dim[3];      ///< rank of current process in eash dir.
   int m_nb_dim[3][2];     ///< neighbor process
   int m_coord[3];         ///< carteisan topology coordinate
+  MPI_Comm m_line[3];     ///< communicator of process line in each dir.
 
   // for stdout/stderr
   bool            m_concat; ///< flag for concatenate cerr/cout
@@ -187,6 +188,11 @@ private:
       MPI_Cart_shift(m_cart, 2, +1, &m_nb_dim[2][0], &m_nb_dim[2][1]);
       // coordinate
       MPI_Cart_coords(m_cart, m_thisrank, 3, m_coord);
+      // sub-communicators along each direction
+      for(int dir=0; dir < 3 ;dir++) {
+        int remain[3] = {dir == 0, dir == 1, dir == 2};
+        MPI_Cart_sub(m_cart, remain, &m_line[dir]);
+      }
     }
 
     // open dummy standard error stream
@@ -222,6 +228,9 @@ private:
     }
 
     // finalize
+    for(int dir=0; dir < 3 ;dir++) {
+      MPI_Comm_free(&m_line[dir]);
+    }
     MPI_Finalize();
 
     // set null
@@ -301,6 +310,52 @@ public:
     }
   };
 
+  ///
+  /// non-blocking global reduction of a scalar
+  ///
+  /// The reduction over all the processes is started by begin(), and the
+  /// result is obtained by get() which waits for completion if necessary.
+  /// The latency is thus overlapped with work in between, e.g.,
+  ///
+  ///   mpiutils::Reduction dt;
+  ///   dt.begin(local_dt, MPI_MIN);
+  ///   ... (other work) ...
+  ///   double global_dt = dt.get();
+  ///
+  class Reduction
+  {
+  public:
+    float64     local;   ///< local value
+    float64     global;  ///< global value
+    MPI_Request request; ///< request for reduction
+
+    Reduction() : local(0), global(0), request(MPI_REQUEST_NULL)
+    {
+    }
+
+    /// begin reduction of value with op (MPI_MAX, MPI_MIN, MPI_SUM, etc.)
+    void begin(const float64 value, MPI_Op op)
+    {
+      local = value;
+      mpiutils::reduce_begin(&local, &global, 1, MPI_DOUBLE, op, &request);
+    }
+
+    /// return true if the reduction has been completed
+    bool test()
+    {
+      int flag;
+      MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+      return flag != 0;
+    }
+
+    /// return result
+    float64 get()
+    {
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+      return global;
+    }
+  };
+
   /// initialize MPI call
   static mpiutils* initialize(int *argc, char*** argv,
                               int period[3], bool concat=true)
@@ -350,6 +405,18 @@ public:
     coord[2] = instance->m_coord[2];
   }
 
+  /// get cartesian topology communicator
+  static MPI_Comm getComm()
+  {
+    return instance->m_cart;
+  }
+
+  /// get communicator of process line along dir (rank = coordinate)
+  static MPI_Comm getLineComm(int dir)
+  {
+    return instance->m_line[dir];
+  }
+
   /// get neighbors
   static void getNeighbors(int neighbors[3][2])
   {
@@ -445,6 +512,11 @@ public:
   /// begin directional boundary exchange with non-blocking send/recv
   static void bc_exchange_dir_begin(int dir, mpiutils::Buffer *buf);
 
+  /// begin global reduction with non-blocking collective
+  static void reduce_begin(const void *sbuf, void *rbuf, int count,
+                           MPI_Datatype dtype, MPI_Op op,
+                           MPI_Request *req);
+
   /// wait requests
   static void wait(MPI_Request req[], int n);
 };
@@ -0,0 +1,650 @@
+// -*- C++ -*-
+#ifndef _MULTIGRID_HPP_
+#define _MULTIGRID_HPP_
+
+///
+/// Geometric Multigrid Solver
+///
+/// The Helmholtz (or Poisson for lambda = 0) equation
+///
+///   - (d^2/dx^2 + d^2/dy^2 + d^2/dz^2) u + lambda u = f
+///
+/// discretized by the 7-point stencil on a cell-centered grid is solved by
+/// multigrid V-cycles on distributed NArray<T,3> with a single ghost cell.
+/// The domain is decomposed by mpiutils; each direction is either periodic
+/// or has homogeneous Dirichlet boundaries (u = 0 at the cell face) as given
+/// by the periodicity of the cartesian topology.
+///
+/// Components of a V-cycle are:
+///
+/// - smoother  : red-black Gauss-Seidel with both colors fused into a single
+///               pass per sweep; red cells of a plane are relaxed together
+///               with black cells of the previous plane, so that a few planes
+///               stay in cache. Only black cells next to the ghost cells wait
+///               for the second halo exchange of a sweep
+/// - restrict  : full weighting (average of 8 fine cells); the residual is
+///               computed on the fly and never stored, so that computing and
+///               restricting the residual is a single pass over fine level
+/// - prolong   : trilinear interpolation fused with the correction
+///
+/// Levels are coarsened by a factor of 2 as long as the local grid size
+/// stays at least nmin. The processes are then agglomerated: each block of 2
+/// processes in a direction (or all of them for an odd number) gathers its
+/// grids onto the first process of the block, where the local grid is thus
+/// larger by the block size. Coarsening continues on a cartesian communicator
+/// of these processes while the others wait for the solution to be scattered
+/// back. This is repeated until a single process holds the whole grid, which
+/// is coarsened down to a few cells and solved by Gauss-Seidel iterations.
+/// With even numbers of processes, every agglomeration divides the number of
+/// active processes by 8 at the same local grid size, so that a V-cycle costs
+/// O(N) work per process plus O(log P) gathers of grids of about nmin^3.
+///
+/// The grid size should thus be divisible by a power of two. For a fully
+/// periodic system with lambda = 0, f must have zero mean.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "mpiutils.hpp"
+#include "krylov.hpp"
+#include "mpiboundary.hpp"
+#include "stencil.hpp"
+
+namespace multigrid
+{
+///
+/// @class Solver multigrid.hpp
+/// @brief multigrid solver for Helmholtz equation
+///
+template <class T>
+class Solver
+{
+private:
+  typedef NArray<T,3> Array;
+
+  // grid level
+  struct Level
+  {
+    int      n[3];      ///< number of interior cells
+    float64  h[3];      ///< grid spacing
+    MPI_Comm comm;      ///< cartesian communicator of distributed level
+    int      dims[3];   ///< number of processes in comm
+    int      nbr[3][2]; ///< neighbors in comm
+    MPI_Comm block;     ///< block gathered onto next level or MPI_COMM_NULL
+    int      bsize[3];  ///< number of processes of block
+    Array   *u;         ///< solution
+    Array   *f;         ///< right-hand-side
+  };
+
+  std::vector<Level> m_level;
+  std::vector< std::unique_ptr<Array> > m_store;
+  std::vector<MPI_Comm> m_comm;
+  std::vector<T> m_buf;
+  float64 m_lambda;
+  int     m_period[3];
+
+  // remain undefined
+  Solver();
+  Solver(const Solver &);
+  Solver& operator=(const Solver &);
+
+  Array* allocate(const int n[3])
+  {
+    m_store.emplace_back(new Array(n[0]+2, n[1]+2, n[2]+2));
+    Array *a = m_store.back().get();
+    for(uint64 p=0; p < a->getSize() ;p++) a->data[p] = 0;
+    return a;
+  }
+
+  void push(const int n[3], const float64 h[3], MPI_Comm comm)
+  {
+    Level l;
+    int period[3], coord[3];
+    MPI_Cart_get(comm, 3, l.dims, period, coord);
+    for(int d=0; d < 3 ;d++) {
+      l.n[d] = n[d];
+      l.h[d] = h[d];
+      l.bsize[d] = 1;
+      MPI_Cart_shift(comm, d, 1, &l.nbr[d][0], &l.nbr[d][1]);
+    }
+    l.comm  = comm;
+    l.block = MPI_COMM_NULL;
+    l.u = allocate(n);
+    l.f = allocate(n);
+    m_level.push_back(l);
+  }
+
+  // coarsen the last level as long as the local grid size is at least nmin
+  void coarsen(int m[3], float64 g[3], const int nmin)
+  {
+    while( m[0]%2 == 0 && m[1]%2 == 0 && m[2]%2 == 0 &&
+           m[0]/2 >= nmin && m[1]/2 >= nmin && m[2]/2 >= nmin ) {
+      for(int d=0; d < 3 ;d++) {
+        m[d] /= 2;
+        g[d] *= 2;
+      }
+      push(m, g, m_level.back().comm);
+    }
+  }
+
+  // gather the last level within blocks; return communicator of next level
+  MPI_Comm agglomerate(int m[3])
+  {
+    Level &l = m_level.back();
+    int rank, dims[3], period[3], coord[3], next[3];
+    MPI_Comm_rank(l.comm, &rank);
+    MPI_Cart_get(l.comm, 3, dims, period, coord);
+
+    // blocks of 2 processes or all processes in a direction of odd number
+    int color = 0;
+    int key   = 0;
+    for(int d=0; d < 3 ;d++) {
+      l.bsize[d] = (dims[d] % 2 == 0) ? 2 : dims[d];
+      next[d] = dims[d] / l.bsize[d];
+      color   = color*next[d] + coord[d] / l.bsize[d];
+      key     = key*l.bsize[d] + coord[d] % l.bsize[d];
+      m[d]   *= l.bsize[d];
+    }
+    MPI_Comm_split(l.comm, color, key, &l.block);
+    m_comm.push_back(l.block);
+
+    // the first process of each block goes on to the next level
+    MPI_Comm root;
+    MPI_Comm comm = MPI_COMM_NULL;
+    MPI_Comm_split(l.comm, key == 0 ? 0 : MPI_UNDEFINED, rank, &root);
+    if( root != MPI_COMM_NULL ) {
+      MPI_Cart_create(root, 3, next, m_period, 0, &comm);
+      MPI_Comm_free(&root);
+      m_comm.push_back(comm);
+    }
+
+    return comm;
+  }
+
+  // halo exchange of a ghost cell along direction d in communicator of l
+  void exchange(const Level &l, Array &x, const int d)
+  {
+    int64 n0 = 1, n2 = 1;
+    const int64 n1 = x.shape[d];
+    for(int e=0; e < d ;e++) n0 *= x.shape[e];
+    for(int e=d+1; e < 3 ;e++) n2 *= x.shape[e];
+
+    // slabs: send lower, send upper, recv lower, recv upper
+    const int64 count = n0*n2;
+    const int   bytes = static_cast<int>(count*sizeof(T));
+    if( m_buf.size() < static_cast<size_t>(4*count) ) {
+      m_buf.resize(4*count);
+    }
+    T *buf = m_buf.data();
+
+    boundary::copy_slab(x.data, &buf[0], n0, n1, n2, 1, 1, true);
+    boundary::copy_slab(x.data, &buf[count], n0, n1, n2, n1-2, 1, true);
+    MPI_Sendrecv(&buf[0], bytes, MPI_BYTE, l.nbr[d][0], 0,
+                 &buf[3*count], bytes, MPI_BYTE, l.nbr[d][1], 0,
+                 l.comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&buf[count], bytes, MPI_BYTE, l.nbr[d][1], 1,
+                 &buf[2*count], bytes, MPI_BYTE, l.nbr[d][0], 1,
+                 l.comm, MPI_STATUS_IGNORE);
+    if( l.nbr[d][0] != MPI_PROC_NULL ) {
+      boundary::copy_slab(x.data, &buf[2*count], n0, n1, n2, 0, 1, false);
+    }
+    if( l.nbr[d][1] != MPI_PROC_NULL ) {
+      boundary::copy_slab(x.data, &buf[3*count], n0, n1, n2, n1-1, 1, false);
+    }
+  }
+
+  // fill ghost cells including edges and corners
+  void fill(const Level &l, Array &x)
+  {
+    for(int d=0; d < 3 ;d++) {
+      if( l.dims[d] > 1 ) {
+        exchange(l, x, d);
+      } else if( m_period[d] ) {
+        boundary::apply(x, d, boundary::LOWER, 1, boundary::Periodic());
+        boundary::apply(x, d, boundary::UPPER, 1, boundary::Periodic());
+      }
+      for(int side=0; side < 2 ;side++) {
+        if( l.nbr[d][side] == MPI_PROC_NULL ) {
+          boundary::apply(x, d, side, 1, boundary::Dirichlet<T>(0));
+        }
+      }
+    }
+  }
+
+  // red-black Gauss-Seidel fused into a single pass per sweep
+  void smooth(const Level &l, const int nsweep)
+  {
+    const T cx = 1/(l.h[0]*l.h[0]);
+    const T cy = 1/(l.h[1]*l.h[1]);
+    const T cz = 1/(l.h[2]*l.h[2]);
+    const T rd = 1/(2*(cx + cy + cz) + m_lambda);
+    const int n0 = l.n[0];
+    const int n1 = l.n[1];
+    const int n2 = l.n[2];
+    const int64 sx = static_cast<int64>(n1+2)*(n2+2);
+    const int64 sy = n2+2;
+
+    // slabs of planes for threads
+    const int ns = std::max(1, std::min(stencil::get_num_threads(), n0/2));
+
+    Array &u = *l.u;
+    Array &f = *l.f;
+    T* RESTRICT pu = u.data;
+    const T* RESTRICT pf = f.data;
+
+    // relax cells of a color in rows [j0, j1] and columns [k0, k1] of plane i
+    auto relax = [&](const int i, const int color, const int j0, const int j1,
+                     const int k0, const int k1)
+      {
+        for(int j=j0; j <= j1 ;j++) {
+          const int64 q = i*sx + j*sy;
+#pragma omp simd
+          for(int k=k0 + ((i + j + k0 + color) & 1); k <= k1 ;k+=2) {
+            const int64 p = q + k;
+            pu[p] = rd*(pf[p]
+                        + cx*(pu[p-sx] + pu[p+sx])
+                        + cy*(pu[p-sy] + pu[p+sy])
+                        + cz*(pu[p-1]  + pu[p+1]));
+          }
+        }
+      };
+
+    // black cells next to ghost cells of plane i (relaxing twice is harmless)
+    auto relax_edge = [&](const int i)
+      {
+        relax(i, 1, 1, 1, 1, n2);
+        relax(i, 1, n1, n1, 1, n2);
+        relax(i, 1, 2, n1-1, 1, 1);
+        relax(i, 1, 2, n1-1, n2, n2);
+      };
+
+    for(int s=0; s < nsweep ;s++) {
+      fill(l, u);
+
+      // red on plane i and black on plane i-1 within a slab
+#pragma omp parallel for schedule(static)
+      for(int is=0; is < ns ;is++) {
+        const int i0 = 1 + is*n0/ns;
+        const int i1 = 1 + (is+1)*n0/ns;
+        for(int i=i0; i < i1 ;i++) {
+          relax(i, 0, 1, n1, 1, n2);
+          if( i-1 > i0 ) relax(i-1, 1, 2, n1-1, 2, n2-1);
+        }
+      }
+
+      fill(l, u);
+
+      // black on the end planes of slabs and next to ghost cells
+#pragma omp parallel for schedule(static)
+      for(int is=0; is < ns ;is++) {
+        const int i0 = 1 + is*n0/ns;
+        const int i1 = 1 + (is+1)*n0/ns;
+        relax(i0, 1, 1, n1, 1, n2);
+        for(int i=i0+1; i < i1-1 ;i++) {
+          relax_edge(i);
+        }
+        if( i1-1 > i0 ) relax(i1-1, 1, 1, n1, 1, n2);
+      }
+    }
+  }
+
+  // restriction of residual from fine level l to coarse level c
+  void restrict_residual(const Level &l, Level &c)
+  {
+    fill(l, *l.u);
+
+    const T cx = 1/(l.h[0]*l.h[0]);
+    const T cy = 1/(l.h[1]*l.h[1]);
+    const T cz = 1/(l.h[2]*l.h[2]);
+    const T dd = 2*(cx + cy + cz) + m_lambda;
+    const int64 sx = static_cast<int64>(l.n[1]+2)*(l.n[2]+2);
+    const int64 sy = l.n[2]+2;
+    const int64 tx = static_cast<int64>(c.n[1]+2)*(c.n[2]+2);
+    const int64 ty = c.n[2]+2;
+    const int m0 = c.n[0];
+    const int m1 = c.n[1];
+    const int m2 = c.n[2];
+
+    const T* RESTRICT pu = l.u->data;
+    const T* RESTRICT pf = l.f->data;
+    T* RESTRICT qf = c.f->data;
+    T* RESTRICT qu = c.u->data;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for(int ic=1; ic <= m0 ;ic++) {
+      for(int jc=1; jc <= m1 ;jc++) {
+        const int64 qc = ic*tx + jc*ty;
+#pragma omp simd
+        for(int kc=1; kc <= m2 ;kc++) {
+          T sum = 0;
+          for(int a=0; a < 2 ;a++) {
+            for(int b=0; b < 2 ;b++) {
+              for(int e=0; e < 2 ;e++) {
+                const int64 p = (2*ic-1+a)*sx + (2*jc-1+b)*sy + (2*kc-1+e);
+                sum += pf[p] - dd*pu[p]
+                  + cx*(pu[p-sx] + pu[p+sx])
+                  + cy*(pu[p-sy] + pu[p+sy])
+                  + cz*(pu[p-1]  + pu[p+1]);
+              }
+            }
+          }
+          qf[qc+kc] = sum*static_cast<T>(0.125);
+          qu[qc+kc] = 0;
+        }
+      }
+    }
+  }
+
+  // trilinear interpolation of coarse level c added to fine level l
+  void prolong_correct(Level &l, const Level &c)
+  {
+    fill(c, *c.u);
+
+    const int64 sx = static_cast<int64>(l.n[1]+2)*(l.n[2]+2);
+    const int64 sy = l.n[2]+2;
+    const int64 tx = static_cast<int64>(c.n[1]+2)*(c.n[2]+2);
+    const int64 ty = c.n[2]+2;
+    const int n0 = l.n[0];
+    const int n1 = l.n[1];
+    const int n2 = l.n[2];
+
+    T* RESTRICT pu = l.u->data;
+    const T* RESTRICT qu = c.u->data;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for(int i=1; i <= n0 ;i++) {
+      for(int j=1; j <= n1 ;j++) {
+        // fine cell i lies between coarse cells (i+1)/2 and (i+1)/2 +/- 1
+        const int64 ox = (i & 1) ? -tx : +tx;
+        const int64 oy = (j & 1) ? -ty : +ty;
+        const int64 qc = ((i+1)/2)*tx + ((j+1)/2)*ty;
+        const int64 qf = i*sx + j*sy;
+#pragma omp simd
+        for(int k=1; k <= n2 ;k++) {
+          const int64 oz = (k & 1) ? -1 : +1;
+          const int64 q  = qc + (k+1)/2;
+          const T u0 = 3*qu[q]    + qu[q+oz];
+          const T u1 = 3*qu[q+oy] + qu[q+oy+oz];
+          const T u2 = 3*qu[q+ox] + qu[q+ox+oz];
+          const T u3 = 3*qu[q+ox+oy] + qu[q+ox+oy+oz];
+          pu[qf+k] += static_cast<T>(1.0/64) *
+            (3*(3*u0 + u1) + (3*u2 + u3));
+        }
+      }
+    }
+  }
+
+  // copy interior cells of level l at block offset o of a from/to buffer
+  void copy_block(const Level &l, const int o[3], Array &a, T *buf,
+                  const bool pack)
+  {
+    const int n0 = l.n[0];
+    const int n1 = l.n[1];
+    const int n2 = l.n[2];
+
+    for(int i=0; i < n0 ;i++) {
+      for(int j=0; j < n1 ;j++) {
+        T *p = &a(o[0]*n0+i+1, o[1]*n1+j+1, o[2]*n2+1);
+        T *b = &buf[(static_cast<int64>(i)*n1 + j)*n2];
+        if( pack ) {
+          for(int k=0; k < n2 ;k++) b[k] = p[k];
+        } else {
+          for(int k=0; k < n2 ;k++) p[k] = b[k];
+        }
+      }
+    }
+  }
+
+  // block offset of process r in block of level l
+  static void offset(const Level &l, const int r, int o[3])
+  {
+    o[0] = r / (l.bsize[1]*l.bsize[2]);
+    o[1] = (r / l.bsize[2]) % l.bsize[1];
+    o[2] = r % l.bsize[2];
+  }
+
+  // gather level k within block onto level k+1 of the first process
+  void gather(const int k)
+  {
+    Level &l = m_level[k];
+    const int   zero[3] = {0, 0, 0};
+    const int64 size    = static_cast<int64>(l.n[0])*l.n[1]*l.n[2];
+    const int   bytes   = static_cast<int>(2*size*sizeof(T));
+    const bool  root    = k+1 < static_cast<int>(m_level.size());
+    int nb;
+    MPI_Comm_size(l.block, &nb);
+
+    std::vector<T> sbuf(2*size);
+    std::vector<T> rbuf(root ? 2*size*nb : 0);
+    copy_block(l, zero, *l.u, &sbuf[0], true);
+    copy_block(l, zero, *l.f, &sbuf[size], true);
+    MPI_Gather(sbuf.data(), bytes, MPI_BYTE, rbuf.data(), bytes, MPI_BYTE, 0,
+               l.block);
+    if( !root ) return;
+
+    Level &c = m_level[k+1];
+    for(int r=0; r < nb ;r++) {
+      int o[3];
+      offset(l, r, o);
+      copy_block(l, o, *c.u, &rbuf[2*r*size], false);
+      copy_block(l, o, *c.f, &rbuf[(2*r+1)*size], false);
+    }
+  }
+
+  // scatter solution of level k+1 of the first process back to block
+  void scatter(const int k)
+  {
+    Level &l = m_level[k];
+    const int   zero[3] = {0, 0, 0};
+    const int64 size    = static_cast<int64>(l.n[0])*l.n[1]*l.n[2];
+    const int   bytes   = static_cast<int>(size*sizeof(T));
+    const bool  root    = k+1 < static_cast<int>(m_level.size());
+    int nb;
+    MPI_Comm_size(l.block, &nb);
+
+    std::vector<T> sbuf(root ? size*nb : 0);
+    std::vector<T> rbuf(size);
+    if( root ) {
+      Level &c = m_level[k+1];
+      for(int r=0; r < nb ;r++) {
+        int o[3];
+        offset(l, r, o);
+        copy_block(l, o, *c.u, &sbuf[r*size], true);
+      }
+    }
+    MPI_Scatter(sbuf.data(), bytes, MPI_BYTE, rbuf.data(), bytes, MPI_BYTE, 0,
+                l.block);
+    copy_block(l, zero, *l.u, rbuf.data(), false);
+  }
+
+  void vcycle(const int k)
+  {
+    Level &l = m_level[k];
+
+    if( l.block != MPI_COMM_NULL ) {
+      // only the first process of the block has the next level
+      gather(k);
+      if( k+1 < static_cast<int>(m_level.size()) ) {
+        vcycle(k+1);
+      }
+      scatter(k);
+      return;
+    }
+
+    if( k+1 == static_cast<int>(m_level.size()) ) {
+      // coarsest level
+      int nmax = std::max(l.n[0], std::max(l.n[1], l.n[2]));
+      smooth(l, std::min(4*nmax*nmax, 1000));
+      return;
+    }
+
+    Level &c = m_level[k+1];
+    smooth(l, npre);
+    restrict_residual(l, c);
+    vcycle(k+1);
+    prolong_correct(l, c);
+    smooth(l, npost);
+  }
+
+public:
+  int npre;  ///< number of pre-smoothing sweeps
+  int npost; ///< number of post-smoothing sweeps
+
+  ///
+  /// @brief constructor
+  ///
+  /// n is the local number of interior cells, h the grid spacing, and nmin
+  /// the minimum local number of cells on distributed levels.
+  ///
+  Solver(const int n[3], const float64 h[3], const float64 lambda=0,
+         const int nmin=4)
+    : m_lambda(lambda), npre(2), npost(2)
+  {
+    int dims[3], coord[3];
+    MPI_Comm comm = mpiutils::getComm();
+    MPI_Cart_get(comm, 3, dims, m_period, coord);
+
+    int     m[3] = {n[0], n[1], n[2]};
+    float64 g[3] = {h[0], h[1], h[2]};
+    push(m, g, comm);
+
+    // agglomerate until a single process is left
+    while( dims[0]*dims[1]*dims[2] > 1 ) {
+      coarsen(m, g, nmin);
+      comm = agglomerate(m);
+      if( comm == MPI_COMM_NULL ) return;
+      MPI_Cart_get(comm, 3, dims, m_period, coord);
+      push(m, g, comm);
+    }
+
+    // levels on a single process
+    coarsen(m, g, 2);
+  }
+
+  ///
+  /// @brief destructor
+  ///
+  ~Solver()
+  {
+    for(size_t i=0; i < m_comm.size() ;i++) {
+      MPI_Comm_free(&m_comm[i]);
+    }
+  }
+
+  /// number of levels (on this process)
+  int getLevels() const
+  {
+    return m_level.size();
+  }
+
+  ///
+  /// @brief fill ghost cells of finest level by halo exchange and boundary
+  ///
+  void fill(NArray<T,3> &u)
+  {
+    fill(m_level[0], u);
+  }
+
+  ///
+  /// @brief global L2 norm of residual f - A u
+  ///
+  float64 residual(NArray<T,3> &u, const NArray<T,3> &f)
+  {
+    Level &l = m_level[0];
+    fill(l, u);
+
+    const T cx = 1/(l.h[0]*l.h[0]);
+    const T cy = 1/(l.h[1]*l.h[1]);
+    const T cz = 1/(l.h[2]*l.h[2]);
+    const T dd = 2*(cx + cy + cz) + m_lambda;
+    const int64 sx = static_cast<int64>(l.n[1]+2)*(l.n[2]+2);
+    const int64 sy = l.n[2]+2;
+    const T* RESTRICT pu = u.data;
+    const T* RESTRICT pf = f.data;
+
+    float64 sum[1];
+    krylov::sum_interior<1>(u, 1, sum, [&](int64 p, float64 *t)
+                            {
+                              const T r = pf[p] - dd*pu[p]
+                                + cx*(pu[p-sx] + pu[p+sx])
+                                + cy*(pu[p-sy] + pu[p+sy])
+                                + cz*(pu[p-1]  + pu[p+1]);
+                              t[0] = r*r;
+                            });
+    MPI_Allreduce(MPI_IN_PLACE, sum, 1, MPI_DOUBLE, MPI_SUM,
+                  mpiutils::getComm());
+
+    return std::sqrt(sum[0]);
+  }
+
+  ///
+  /// @brief perform a V-cycle
+  ///
+  /// u (initial guess and solution) and f are local arrays with interior
+  /// shape n and a ghost cell.
+  ///
+  void cycle(NArray<T,3> &u, const NArray<T,3> &f)
+  {
+    Level &l = m_level[0];
+    const T* RESTRICT pf = f.data;
+    T* RESTRICT pu = u.data;
+    T* RESTRICT qf = l.f->data;
+    T* RESTRICT qu = l.u->data;
+
+    krylov::for_interior(u, 1, [&](int64 p)
+                         {
+                           qu[p] = pu[p];
+                           qf[p] = pf[p];
+                         });
+    vcycle(0);
+    krylov::for_interior(u, 1, [&](int64 p) { pu[p] = qu[p]; });
+  }
+
+  ///
+  /// @brief solve by V-cycles until |f - A u| < tol*|f|
+  ///
+  krylov::Status solve(NArray<T,3> &u, const NArray<T,3> &f,
+                       const float64 tol=TOLERANCE, const int maxcycle=100)
+  {
+    const T* RESTRICT pf = f.data;
+    float64 fnorm[1];
+    krylov::sum_interior<1>(f, 1, fnorm, [&](int64 p, float64 *t)
+                            {
+                              t[0] = pf[p]*pf[p];
+                            });
+    MPI_Allreduce(MPI_IN_PLACE, fnorm, 1, MPI_DOUBLE, MPI_SUM,
+                  mpiutils::getComm());
+    fnorm[0] = fnorm[0] > 0 ? std::sqrt(fnorm[0]) : 1;
+
+    krylov::Status status = {0, residual(u, f)/fnorm[0], false};
+    while( status.residual >= tol && status.iteration < maxcycle ) {
+      cycle(u, f);
+      status.iteration++;
+      status.residual = residual(u, f)/fnorm[0];
+    }
+    status.converged = status.residual < tol;
+
+    return status;
+  }
+
+  ///
+  /// @brief a V-cycle with zero initial guess as a preconditioner z = M^{-1} r
+  ///
+  void operator()(const NArray<T,3> &r, NArray<T,3> &z)
+  {
+    krylov::for_interior(z, 1, [&](int64 p) { z.data[p] = 0; });
+    cycle(z, r);
+  }
+};
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,289 @@
+// -*- C++ -*-
+#ifndef _RECONSTRUCTION_HPP_
+#define _RECONSTRUCTION_HPP_
+
+///
+/// Reconstruction of Interface States
+///
+/// For cell averages u[i] along a line, a reconstruction scheme gives the
+/// values at the cell faces: wm[i] at i-1/2 and wp[i] at i+1/2. The left and
+/// right states at the interface i+1/2 are then wp[i] and wm[i+1].
+///
+/// Schemes are functors with a compile-time stencil radius R, which compute
+/// (wm, wp) from the 2R+1 values v[0..2R] centered at the cell:
+///
+///   PLM<L>  : piecewise linear (MUSCL) with a limiter L of limiter.hpp
+///   PPM     : piecewise parabolic (Colella & Woodward 1984)
+///   WENO5   : 5th order WENO (Jiang & Shu 1996)
+///   WENOZ   : 5th order WENO-Z (Borges et al. 2008)
+///
+/// reconstruct() applies a scheme along any axis of NArray of any rank, so
+/// that a multi-component field (e.g., NArray<T,4> with components in the
+/// first or last index) is handled in the same way. The array is regarded
+/// as [n0][n1][n2] with n1 along the axis. For an axis other than the last
+/// one, the lines along the axis are interleaved in the contiguous dimension
+/// n2, and the vectorized loop runs across lines. The n2 dimension is split
+/// into blocks of BLOCK lines such that the 2R+1 rows of a block stay in L1
+/// cache, and (n0, block) pairs are distributed across threads. For the last
+/// axis, each line is contiguous and the vectorized loop runs along the line.
+/// In either case, no copy into scratch memory is needed.
+///
+/// Faces are computed for cells with a complete stencil, i.e., R <= i < n1-R.
+/// The others are not modified.
+///
+/// $Id$
+///
+#include <cmath>
+#include <algorithm>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "limiter.hpp"
+#include "loopnest.hpp"
+
+namespace reconstruction
+{
+/// number of lines processed at once for an axis other than the last one
+enum { BLOCK = 512 };
+
+///
+/// @class PLM reconstruction.hpp
+/// @brief piecewise linear reconstruction with a slope limiter
+///
+template <class L = limiter::MC>
+struct PLM
+{
+  enum { RADIUS = 1 };
+
+  L lim; ///< slope limiter
+
+  PLM(const L &l = L()) : lim(l)
+  {
+  }
+
+  template <class T>
+  INLINE void operator()(const T *v, T &wm, T &wp) const
+  {
+    const T du = static_cast<T>(0.5)*lim(v[1] - v[0], v[2] - v[1]);
+    wm = v[1] - du;
+    wp = v[1] + du;
+  }
+};
+
+///
+/// @class PPM reconstruction.hpp
+/// @brief piecewise parabolic reconstruction
+///
+/// Face values are interpolated with 4th order, bounded by the adjacent
+/// cell averages, and then modified by the monotonicity constraints of
+/// Colella & Woodward (1984).
+///
+struct PPM
+{
+  enum { RADIUS = 2 };
+
+  // interpolated face value between v1 and v2 bounded by them
+  template <class T>
+  static INLINE T face(const T v0, const T v1, const T v2, const T v3)
+  {
+    const T a  = static_cast<T>(7.0/12.0)*(v1 + v2) -
+      static_cast<T>(1.0/12.0)*(v0 + v3);
+    const T lo = limiter::min2(v1, v2);
+    const T hi = limiter::max2(v1, v2);
+    return limiter::max2(limiter::min2(a, hi), lo);
+  }
+
+  template <class T>
+  INLINE void operator()(const T *v, T &wm, T &wp) const
+  {
+    const T u0 = v[2];
+    const T am = face(v[0], v[1], v[2], v[3]);
+    const T ap = face(v[1], v[2], v[3], v[4]);
+
+    const T dq = ap - am;
+    const T q6 = 6*(u0 - static_cast<T>(0.5)*(am + ap));
+
+    const bool flat = (ap - u0)*(u0 - am) <= 0;
+    const bool cm   = dq*q6 > +dq*dq;
+    const bool cp   = dq*q6 < -dq*dq;
+
+    wm = flat ? u0 : (cm ? 3*u0 - 2*ap : am);
+    wp = flat ? u0 : (cp ? 3*u0 - 2*am : ap);
+  }
+};
+
+///
+/// @class WENO5 reconstruction.hpp
+/// @brief 5th order WENO reconstruction (Jiang & Shu)
+///
+struct WENO5
+{
+  enum { RADIUS = 2 };
+
+  float64 epsilon; ///< small parameter in nonlinear weights
+
+  WENO5(const float64 e=1.0e-6) : epsilon(e)
+  {
+  }
+
+  // value at the right face of v2
+  template <class T>
+  INLINE T face(const T v0, const T v1, const T v2, const T v3,
+                const T v4) const
+  {
+    const T c13 = static_cast<T>(13.0/12.0);
+    const T c14 = static_cast<T>(0.25);
+    const T e   = static_cast<T>(epsilon);
+
+    const T q0 = (2*v0 - 7*v1 + 11*v2) * static_cast<T>(1.0/6.0);
+    const T q1 = ( -v1 + 5*v2 +  2*v3) * static_cast<T>(1.0/6.0);
+    const T q2 = (2*v2 + 5*v3 -    v4) * static_cast<T>(1.0/6.0);
+
+    const T b0 = c13*(v0 - 2*v1 + v2)*(v0 - 2*v1 + v2) +
+      c14*(v0 - 4*v1 + 3*v2)*(v0 - 4*v1 + 3*v2);
+    const T b1 = c13*(v1 - 2*v2 + v3)*(v1 - 2*v2 + v3) +
+      c14*(v1 - v3)*(v1 - v3);
+    const T b2 = c13*(v2 - 2*v3 + v4)*(v2 - 2*v3 + v4) +
+      c14*(3*v2 - 4*v3 + v4)*(3*v2 - 4*v3 + v4);
+
+    const T a0 = static_cast<T>(0.1) / ((e + b0)*(e + b0));
+    const T a1 = static_cast<T>(0.6) / ((e + b1)*(e + b1));
+    const T a2 = static_cast<T>(0.3) / ((e + b2)*(e + b2));
+
+    return (a0*q0 + a1*q1 + a2*q2) / (a0 + a1 + a2);
+  }
+
+  template <class T>
+  INLINE void operator()(const T *v, T &wm, T &wp) const
+  {
+    wm = face(v[4], v[3], v[2], v[1], v[0]);
+    wp = face(v[0], v[1], v[2], v[3], v[4]);
+  }
+};
+
+///
+/// @class WENOZ reconstruction.hpp
+/// @brief 5th order WENO-Z reconstruction (Borges et al.)
+///
+struct WENOZ
+{
+  enum { RADIUS = 2 };
+
+  float64 epsilon; ///< small parameter in nonlinear weights
+
+  WENOZ(const float64 e=1.0e-40) : epsilon(e)
+  {
+  }
+
+  // value at the right face of v2
+  template <class T>
+  INLINE T face(const T v0, const T v1, const T v2, const T v3,
+                const T v4) const
+  {
+    const T c13 = static_cast<T>(13.0/12.0);
+    const T c14 = static_cast<T>(0.25);
+    const T e   = static_cast<T>(epsilon);
+
+    const T q0 = (2*v0 - 7*v1 + 11*v2) * static_cast<T>(1.0/6.0);
+    const T q1 = ( -v1 + 5*v2 +  2*v3) * static_cast<T>(1.0/6.0);
+    const T q2 = (2*v2 + 5*v3 -    v4) * static_cast<T>(1.0/6.0);
+
+    const T b0 = c13*(v0 - 2*v1 + v2)*(v0 - 2*v1 + v2) +
+      c14*(v0 - 4*v1 + 3*v2)*(v0 - 4*v1 + 3*v2);
+    const T b1 = c13*(v1 - 2*v2 + v3)*(v1 - 2*v2 + v3) +
+      c14*(v1 - v3)*(v1 - v3);
+    const T b2 = c13*(v2 - 2*v3 + v4)*(v2 - 2*v3 + v4) +
+      c14*(3*v2 - 4*v3 + v4)*(3*v2 - 4*v3 + v4);
+
+    const T tau = std::fabs(b0 - b2);
+    const T a0 = static_cast<T>(0.1) * (1 + tau/(b0 + e));
+    const T a1 = static_cast<T>(0.6) * (1 + tau/(b1 + e));
+    const T a2 = static_cast<T>(0.3) * (1 + tau/(b2 + e));
+
+    return (a0*q0 + a1*q1 + a2*q2) / (a0 + a1 + a2);
+  }
+
+  template <class T>
+  INLINE void operator()(const T *v, T &wm, T &wp) const
+  {
+    wm = face(v[4], v[3], v[2], v[1], v[0]);
+    wp = face(v[0], v[1], v[2], v[3], v[4]);
+  }
+};
+
+///
+/// @brief apply scheme to n positions
+///
+/// Position p has the center u[p] and the stencil u[p + (k-R)*stride]
+/// (k = 0, ..., 2R). The results are stored in wm[p] and wp[p].
+///
+/// Note that "ivdep" is used instead of "omp simd"; GCC fails to vectorize
+/// the stencil array v as a per-lane private array of an "omp simd" loop,
+/// and too many run-time alias checks are needed without any directive.
+///
+template <class S, class T>
+INLINE void apply(const S &scheme, const T* RESTRICT u, T* RESTRICT wm,
+                  T* RESTRICT wp, const int64 stride, const int64 n)
+{
+  const int R = S::RADIUS;
+
+#pragma GCC ivdep
+  for(int64 p=0; p < n ;p++) {
+    T v[2*R+1];
+    loopnest::static_for<0,2*R+1>([&](int k)
+                                  {
+                                    v[k] = u[p + (k-R)*stride];
+                                  });
+    scheme(v, wm[p], wp[p]);
+  }
+}
+
+///
+/// @brief reconstruct face values along a given axis of NArray
+///
+template <class S, class T, int Rank>
+void reconstruct(const S &scheme, const NArray<T,Rank> &u,
+                 NArray<T,Rank> &wm, NArray<T,Rank> &wp, const int axis)
+{
+  const int R = S::RADIUS;
+
+  int64 n0 = 1;
+  int64 n1 = u.shape[axis];
+  int64 n2 = 1;
+  for(int d=0; d < axis ;d++) n0 *= u.shape[d];
+  for(int d=axis+1; d < Rank ;d++) n2 *= u.shape[d];
+
+  if( n1 <= 2*R ) return;
+
+  const T* RESTRICT uu = u.data;
+  T* RESTRICT mm = wm.data;
+  T* RESTRICT pp = wp.data;
+
+  if( n2 == 1 ) {
+    // along contiguous lines
+#pragma omp parallel for schedule(static)
+    for(int64 i0=0; i0 < n0 ;i0++) {
+      const int64 ip = i0*n1 + R;
+      apply(scheme, &uu[ip], &mm[ip], &pp[ip], 1, n1-2*R);
+    }
+  } else {
+    // across interleaved lines
+    const int64 nb = (n2 + BLOCK - 1)/BLOCK;
+#pragma omp parallel for schedule(static)
+    for(int64 ib=0; ib < n0*nb ;ib++) {
+      const int64 i0 = ib / nb;
+      const int64 b0 = (ib % nb) * BLOCK;
+      const int64 nn = std::min<int64>(BLOCK, n2 - b0);
+      for(int64 i1=R; i1 < n1-R ;i1++) {
+        const int64 ip = (i0*n1 + i1)*n2 + b0;
+        apply(scheme, &uu[ip], &mm[ip], &pp[ip], n2, nn);
+      }
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,519 @@
+// -*- C++ -*-
+#ifndef _RIEMANN_HPP_
+#define _RIEMANN_HPP_
+
+///
+/// Approximate Riemann Solvers
+///
+/// Numerical fluxes at cell interfaces are computed from the left and right
+/// states of primitive variables. An equation set is given by a traits class
+/// with the number of variables, the conversion to conservative variables,
+/// the physical flux and the fastest signal speed along x:
+///
+///   Hydro : adiabatic hydrodynamics (ro, vx, vy, vz, pr)
+///   MHD   : adiabatic MHD (ro, vx, vy, vz, pr, bx, by, bz)
+///
+/// Conservative variables are stored in the same order, with the momentum
+/// in the velocity slots and the total energy in the pressure slot. The
+/// magnetic field is in units such that the magnetic pressure is B^2/2.
+///
+/// Solvers are functors templated on the equation set:
+///
+///   HLL<E>      : HLL for any equation set
+///   HLLC<Hydro> : HLLC (Toro et al. 1994)
+///   HLLD<MHD>   : HLLD (Miyoshi & Kusano 2005)
+///
+/// HLLC and HLLD are specialized only for the equation set they are derived
+/// for, so that a mismatch is detected at compile time. All the solvers are
+/// branchless; fluxes of all the waves are computed and the right one is
+/// selected by comparison, such that the compiler generates vector code.
+/// Note that the code must be compiled with -fno-math-errno (as in Makefile);
+/// otherwise, the compiler does not vectorize the square root. Member
+/// functions are forcibly inlined, since the loop in solve() is vectorized
+/// only if the whole solver is inlined into it.
+///
+/// solve() applies a solver to many interfaces at once, given as arrays of
+/// each variable (structure of arrays) or as NArray with the variable in the
+/// first index, and the loop over interfaces is vectorized. Fluxes along y
+/// or z are obtained by passing the variables in the rotated order (e.g.,
+/// vy, vz, vx for the velocity).
+///
+/// $Id$
+///
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace riemann
+{
+/// number of interfaces processed at once by a thread
+enum { BLOCK = 1024 };
+
+///
+/// @class Hydro riemann.hpp
+/// @brief traits of adiabatic hydrodynamic equations
+///
+struct Hydro
+{
+  enum { NVAR = 5, IRO = 0, IVX = 1, IVY = 2, IVZ = 3, IPR = 4 };
+
+  float64 gamma; ///< ratio of specific heats
+
+  Hydro(const float64 g=5.0/3.0) : gamma(g)
+  {
+  }
+
+  /// conservative variables
+  template <class T>
+  FORCE_INLINE void conserved(const T *w, T *u) const
+  {
+    const T gm1 = static_cast<T>(gamma - 1);
+    const T vv  = w[IVX]*w[IVX] + w[IVY]*w[IVY] + w[IVZ]*w[IVZ];
+    u[IRO] = w[IRO];
+    u[IVX] = w[IRO]*w[IVX];
+    u[IVY] = w[IRO]*w[IVY];
+    u[IVZ] = w[IRO]*w[IVZ];
+    u[IPR] = w[IPR]/gm1 + static_cast<T>(0.5)*w[IRO]*vv;
+  }
+
+  /// flux along x
+  template <class T>
+  FORCE_INLINE void flux(const T *w, const T *u, T *f) const
+  {
+    f[IRO] = u[IVX];
+    f[IVX] = u[IVX]*w[IVX] + w[IPR];
+    f[IVY] = u[IVY]*w[IVX];
+    f[IVZ] = u[IVZ]*w[IVX];
+    f[IPR] = (u[IPR] + w[IPR])*w[IVX];
+  }
+
+  /// sound speed
+  template <class T>
+  FORCE_INLINE T fastspeed(const T *w) const
+  {
+    return std::sqrt(static_cast<T>(gamma)*w[IPR]/w[IRO]);
+  }
+};
+
+///
+/// @class MHD riemann.hpp
+/// @brief traits of adiabatic MHD equations
+///
+/// The normal magnetic field bx must be identical on both sides; it is set
+/// to the average of the left and right states by the solvers.
+///
+struct MHD
+{
+  enum { NVAR = 8, IRO = 0, IVX = 1, IVY = 2, IVZ = 3, IPR = 4,
+         IBX = 5, IBY = 6, IBZ = 7 };
+
+  float64 gamma; ///< ratio of specific heats
+
+  MHD(const float64 g=5.0/3.0) : gamma(g)
+  {
+  }
+
+  /// conservative variables
+  template <class T>
+  FORCE_INLINE void conserved(const T *w, T *u) const
+  {
+    const T gm1 = static_cast<T>(gamma - 1);
+    const T vv  = w[IVX]*w[IVX] + w[IVY]*w[IVY] + w[IVZ]*w[IVZ];
+    const T bb  = w[IBX]*w[IBX] + w[IBY]*w[IBY] + w[IBZ]*w[IBZ];
+    u[IRO] = w[IRO];
+    u[IVX] = w[IRO]*w[IVX];
+    u[IVY] = w[IRO]*w[IVY];
+    u[IVZ] = w[IRO]*w[IVZ];
+    u[IPR] = w[IPR]/gm1 + static_cast<T>(0.5)*(w[IRO]*vv + bb);
+    u[IBX] = w[IBX];
+    u[IBY] = w[IBY];
+    u[IBZ] = w[IBZ];
+  }
+
+  /// flux along x
+  template <class T>
+  FORCE_INLINE void flux(const T *w, const T *u, T *f) const
+  {
+    const T bb = w[IBX]*w[IBX] + w[IBY]*w[IBY] + w[IBZ]*w[IBZ];
+    const T vb = w[IVX]*w[IBX] + w[IVY]*w[IBY] + w[IVZ]*w[IBZ];
+    const T pt = w[IPR] + static_cast<T>(0.5)*bb;
+    f[IRO] = u[IVX];
+    f[IVX] = u[IVX]*w[IVX] + pt - w[IBX]*w[IBX];
+    f[IVY] = u[IVY]*w[IVX] - w[IBX]*w[IBY];
+    f[IVZ] = u[IVZ]*w[IVX] - w[IBX]*w[IBZ];
+    f[IPR] = (u[IPR] + pt)*w[IVX] - w[IBX]*vb;
+    f[IBX] = 0;
+    f[IBY] = w[IBY]*w[IVX] - w[IBX]*w[IVY];
+    f[IBZ] = w[IBZ]*w[IVX] - w[IBX]*w[IVZ];
+  }
+
+  /// fast magnetosonic speed
+  template <class T>
+  FORCE_INLINE T fastspeed(const T *w) const
+  {
+    const T gp = static_cast<T>(gamma)*w[IPR];
+    const T bb = w[IBX]*w[IBX] + w[IBY]*w[IBY] + w[IBZ]*w[IBZ];
+    const T a  = (gp + bb)/w[IRO];
+    const T d  = a*a - 4*gp*w[IBX]*w[IBX]/(w[IRO]*w[IRO]);
+    return std::sqrt(static_cast<T>(0.5)*(a + std::sqrt(std::max(d, T(0)))));
+  }
+};
+
+// set normal magnetic field to the average of both sides
+template <class E, class T>
+FORCE_INLINE void normal_field(T *wl, T *wr, std::true_type)
+{
+  const T bx = static_cast<T>(0.5)*(wl[E::IBX] + wr[E::IBX]);
+  wl[E::IBX] = bx;
+  wr[E::IBX] = bx;
+}
+
+template <class E, class T>
+FORCE_INLINE void normal_field(T *, T *, std::false_type)
+{
+}
+
+template <class E, class T>
+FORCE_INLINE void normal_field(T *wl, T *wr)
+{
+  normal_field<E>(wl, wr, std::integral_constant<bool, (E::NVAR > 5)>());
+}
+
+///
+/// @class HLL riemann.hpp
+/// @brief HLL solver for any equation set
+///
+template <class E>
+struct HLL
+{
+  typedef E equation;
+  enum { NVAR = E::NVAR };
+
+  E eq; ///< equation set
+
+  HLL(const E &e = E()) : eq(e)
+  {
+  }
+
+  template <class T>
+  FORCE_INLINE void operator()(const T *wl_, const T *wr_, T *f) const
+  {
+    T wl[NVAR], wr[NVAR];
+    T ul[NVAR], ur[NVAR];
+    T fl[NVAR], fr[NVAR];
+
+    for(int v=0; v < NVAR ;v++) {
+      wl[v] = wl_[v];
+      wr[v] = wr_[v];
+    }
+    normal_field<E>(wl, wr);
+    eq.conserved(wl, ul);
+    eq.conserved(wr, ur);
+    eq.flux(wl, ul, fl);
+    eq.flux(wr, ur, fr);
+
+    // signal speeds (Davis 1988) including zero
+    const T cl = eq.fastspeed(wl);
+    const T cr = eq.fastspeed(wr);
+    const T sl = std::min(std::min(wl[E::IVX] - cl, wr[E::IVX] - cr), T(0));
+    const T sr = std::max(std::max(wl[E::IVX] + cl, wr[E::IVX] + cr), T(0));
+    const T rd = 1/(sr - sl);
+
+    for(int v=0; v < NVAR ;v++) {
+      f[v] = (sr*fl[v] - sl*fr[v] + sl*sr*(ur[v] - ul[v])) * rd;
+    }
+  }
+};
+
+/// HLLC solver (defined only for Hydro)
+template <class E>
+struct HLLC;
+
+/// HLLD solver (defined only for MHD)
+template <class E>
+struct HLLD;
+
+///
+/// @class HLLC riemann.hpp
+/// @brief HLLC solver for hydrodynamics
+///
+template <>
+struct HLLC<Hydro>
+{
+  typedef Hydro equation;
+  enum { NVAR = Hydro::NVAR,
+         IRO = Hydro::IRO, IVX = Hydro::IVX, IVY = Hydro::IVY,
+         IVZ = Hydro::IVZ, IPR = Hydro::IPR };
+
+  Hydro eq; ///< equation set
+
+  HLLC(const Hydro &e = Hydro()) : eq(e)
+  {
+  }
+
+  // flux of star state F* = F + s*(U* - U) with s <= 0 (left) or s >= 0
+  template <class T>
+  FORCE_INLINE void star(const T *w, const T *u, const T *f, const T sk,
+                   const T sm, const T s, T *fs) const
+  {
+    const T c  = w[IRO]*(sk - w[IVX]);
+    const T r  = c/(sk - sm);
+    const T us[NVAR] = {
+      r,
+      r*sm,
+      r*w[IVY],
+      r*w[IVZ],
+      r*(u[IPR]/w[IRO] + (sm - w[IVX])*(sm + w[IPR]/c))
+    };
+    for(int v=0; v < NVAR ;v++) {
+      fs[v] = f[v] + s*(us[v] - u[v]);
+    }
+  }
+
+  template <class T>
+  FORCE_INLINE void operator()(const T *wl, const T *wr, T *f) const
+  {
+    T ul[NVAR], ur[NVAR];
+    T fl[NVAR], fr[NVAR];
+    T gl[NVAR], gr[NVAR];
+
+    eq.conserved(wl, ul);
+    eq.conserved(wr, ur);
+    eq.flux(wl, ul, fl);
+    eq.flux(wr, ur, fr);
+
+    // signal speeds (Davis 1988)
+    const T cl = eq.fastspeed(wl);
+    const T cr = eq.fastspeed(wr);
+    const T sl = std::min(wl[IVX] - cl, wr[IVX] - cr);
+    const T sr = std::max(wl[IVX] + cl, wr[IVX] + cr);
+
+    // contact speed
+    const T ml = wl[IRO]*(sl - wl[IVX]);
+    const T mr = wr[IRO]*(sr - wr[IVX]);
+    const T sm = (wr[IPR] - wl[IPR] + ml*wl[IVX] - mr*wr[IVX]) / (ml - mr);
+
+    // zero speed for a supersonic flow gives the upwind flux
+    star(wl, ul, fl, sl, sm, std::min(sl, T(0)), gl);
+    star(wr, ur, fr, sr, sm, std::max(sr, T(0)), gr);
+
+    for(int v=0; v < NVAR ;v++) {
+      f[v] = (sm >= 0) ? gl[v] : gr[v];
+    }
+  }
+};
+
+///
+/// @class HLLD riemann.hpp
+/// @brief HLLD solver for MHD
+///
+/// The intermediate states reduce to those of HLL (with the outer states)
+/// in the degenerate case where the denominator is smaller than epsilon
+/// relative to the total pressure.
+///
+template <>
+struct HLLD<MHD>
+{
+  typedef MHD equation;
+  enum { NVAR = MHD::NVAR,
+         IRO = MHD::IRO, IVX = MHD::IVX, IVY = MHD::IVY, IVZ = MHD::IVZ,
+         IPR = MHD::IPR, IBX = MHD::IBX, IBY = MHD::IBY, IBZ = MHD::IBZ };
+
+  MHD     eq;      ///< equation set
+  float64 epsilon; ///< tolerance for degeneracy
+
+  HLLD(const MHD &e = MHD(), const float64 eps=1.0e-8) : eq(e), epsilon(eps)
+  {
+  }
+
+  // single star state of one side (conservative variables)
+  template <class T>
+  FORCE_INLINE void star(const T *w, const T *u, const T sk, const T sm,
+                   const T pt, const T ps, const T e, T *us) const
+  {
+    const T bx  = w[IBX];
+    const T c   = w[IRO]*(sk - w[IVX]);
+    const T r   = c/(sk - sm);
+    const T den = c*(sk - sm) - bx*bx;
+    const bool ok = std::fabs(den) > e*ps;
+    const T rd  = ok ? 1/den : T(0);
+    const T fv  = bx*(sm - w[IVX])*rd;
+    const T fb  = ok ? (c*(sk - w[IVX]) - bx*bx)*rd : T(1);
+    const T vy  = w[IVY] - w[IBY]*fv;
+    const T vz  = w[IVZ] - w[IBZ]*fv;
+    const T by  = w[IBY]*fb;
+    const T bz  = w[IBZ]*fb;
+    const T vb  = w[IVX]*bx + w[IVY]*w[IBY] + w[IVZ]*w[IBZ];
+    const T vbs = sm*bx + vy*by + vz*bz;
+    us[IRO] = r;
+    us[IVX] = r*sm;
+    us[IVY] = r*vy;
+    us[IVZ] = r*vz;
+    us[IPR] = ((sk - w[IVX])*u[IPR] - pt*w[IVX] + ps*sm + bx*(vb - vbs)) /
+      (sk - sm);
+    us[IBX] = bx;
+    us[IBY] = by;
+    us[IBZ] = bz;
+  }
+
+  template <class T>
+  FORCE_INLINE void operator()(const T *wl_, const T *wr_, T *f) const
+  {
+    T wl[NVAR], wr[NVAR];
+    T ul[NVAR], ur[NVAR];
+    T fl[NVAR], fr[NVAR];
+    T sl[NVAR], sr[NVAR];
+    T dd[NVAR];
+
+    for(int v=0; v < NVAR ;v++) {
+      wl[v] = wl_[v];
+      wr[v] = wr_[v];
+    }
+    normal_field<MHD>(wl, wr);
+    eq.conserved(wl, ul);
+    eq.conserved(wr, ur);
+    eq.flux(wl, ul, fl);
+    eq.flux(wr, ur, fr);
+
+    const T half = static_cast<T>(0.5);
+    const T bx   = wl[IBX];
+    const T sgn  = std::copysign(T(1), bx);
+
+    // outer signal speeds (Miyoshi & Kusano 2005, eq. 67)
+    const T cf = std::max(eq.fastspeed(wl), eq.fastspeed(wr));
+    const T s1 = std::min(wl[IVX], wr[IVX]) - cf;
+    const T s5 = std::max(wl[IVX], wr[IVX]) + cf;
+
+    // contact speed and total pressure of star states
+    const T ptl = wl[IPR] + half*(bx*bx + wl[IBY]*wl[IBY] + wl[IBZ]*wl[IBZ]);
+    const T ptr = wr[IPR] + half*(bx*bx + wr[IBY]*wr[IBY] + wr[IBZ]*wr[IBZ]);
+    const T ml  = wl[IRO]*(s1 - wl[IVX]);
+    const T mr  = wr[IRO]*(s5 - wr[IVX]);
+    const T rd  = 1/(mr - ml);
+    const T s3  = (mr*wr[IVX] - ml*wl[IVX] - ptr + ptl) * rd;
+    const T ps  = (mr*ptl - ml*ptr + ml*mr*(wr[IVX] - wl[IVX])) * rd;
+
+    star(wl, ul, s1, s3, ptl, ps, static_cast<T>(epsilon), sl);
+    star(wr, ur, s5, s3, ptr, ps, static_cast<T>(epsilon), sr);
+
+    // Alfven speeds
+    const T ql = std::sqrt(sl[IRO]);
+    const T qr = std::sqrt(sr[IRO]);
+    const T s2 = s3 - std::fabs(bx)/ql;
+    const T s4 = s3 + std::fabs(bx)/qr;
+
+    // double star state
+    const T rq  = 1/(ql + qr);
+    const T vyl = sl[IVY]/sl[IRO];
+    const T vzl = sl[IVZ]/sl[IRO];
+    const T vyr = sr[IVY]/sr[IRO];
+    const T vzr = sr[IVZ]/sr[IRO];
+    const T vy  = (ql*vyl + qr*vyr + (sr[IBY] - sl[IBY])*sgn) * rq;
+    const T vz  = (ql*vzl + qr*vzr + (sr[IBZ] - sl[IBZ])*sgn) * rq;
+    const T by  = (ql*sr[IBY] + qr*sl[IBY] + ql*qr*(vyr - vyl)*sgn) * rq;
+    const T bz  = (ql*sr[IBZ] + qr*sl[IBZ] + ql*qr*(vzr - vzl)*sgn) * rq;
+    const T vbd = s3*bx + vy*by + vz*bz;
+    const T vbl = s3*bx + vyl*sl[IBY] + vzl*sl[IBZ];
+    const T vbr = s3*bx + vyr*sr[IBY] + vzr*sr[IBZ];
+
+    // select side by contact speed
+    const bool left = s3 >= 0;
+    const T sk = left ? std::min(s1, T(0)) : std::max(s5, T(0));
+    const T sa = left ? std::min(s2, T(0)) : std::max(s4, T(0));
+    const T q  = left ? ql : qr;
+
+    dd[IRO] = 0;
+    dd[IVX] = 0;
+    dd[IBX] = 0;
+    dd[IVY] = (left ? sl[IRO] : sr[IRO])*(vy - (left ? vyl : vyr));
+    dd[IVZ] = (left ? sl[IRO] : sr[IRO])*(vz - (left ? vzl : vzr));
+    dd[IBY] = by - (left ? sl[IBY] : sr[IBY]);
+    dd[IBZ] = bz - (left ? sl[IBZ] : sr[IBZ]);
+    dd[IPR] = (left ? -q : q)*(left ? vbl - vbd : vbr - vbd)*sgn;
+
+    // F = F_k + s_k*(U*_k - U_k) + s_ak*(U**_k - U*_k)
+    for(int v=0; v < NVAR ;v++) {
+      const T uk = left ? ul[v] : ur[v];
+      const T us = left ? sl[v] : sr[v];
+      const T fk = left ? fl[v] : fr[v];
+      f[v] = fk + sk*(us - uk) + sa*dd[v];
+    }
+  }
+};
+
+///
+/// @brief solve Riemann problems at n interfaces
+///
+/// The left and right states at interface i are given by wl[v][i] and
+/// wr[v][i] for each variable v, and the flux is stored in f[v][i].
+///
+/// Note that "ivdep" is used instead of "omp simd", as GCC fails to
+/// vectorize the per-lane local arrays of the solvers in an "omp simd" loop.
+///
+template <class S, class T>
+void solve(const S &solver, const T* const *wl, const T* const *wr,
+           T* const *f, const int64 n)
+{
+  const int N = S::NVAR;
+
+  const T* pl[N];
+  const T* pr[N];
+  T* pf[N];
+  for(int v=0; v < N ;v++) {
+    pl[v] = wl[v];
+    pr[v] = wr[v];
+    pf[v] = f[v];
+  }
+
+#pragma GCC ivdep
+  for(int64 i=0; i < n ;i++) {
+    T l[N], r[N], g[N];
+    for(int v=0; v < N ;v++) {
+      l[v] = pl[v][i];
+      r[v] = pr[v][i];
+    }
+    solver(l, r, g);
+    for(int v=0; v < N ;v++) {
+      pf[v][i] = g[v];
+    }
+  }
+}
+
+///
+/// @brief solve Riemann problems for NArray
+///
+/// The first index of the arrays is the variable, and all the others are
+/// regarded as interfaces; i.e., wl(v, ...) is the variable v of the left
+/// state. The interfaces are split into blocks distributed across threads.
+///
+template <class S, class T, int Rank>
+void solve(const S &solver, const NArray<T,Rank> &wl,
+           const NArray<T,Rank> &wr, NArray<T,Rank> &f)
+{
+  const int   N  = S::NVAR;
+  const int64 n  = wl.getSize() / wl.shape[0];
+  const int64 nb = (n + BLOCK - 1)/BLOCK;
+
+#pragma omp parallel for schedule(static)
+  for(int64 ib=0; ib < nb ;ib++) {
+    const int64 i0 = ib*BLOCK;
+    const T* pl[N];
+    const T* pr[N];
+    T* pf[N];
+    for(int v=0; v < N ;v++) {
+      pl[v] = &wl.data[v*n + i0];
+      pr[v] = &wr.data[v*n + i0];
+      pf[v] = &f.data[v*n + i0];
+    }
+    solve(solver, pl, pr, pf, std::min<int64>(BLOCK, n - i0));
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
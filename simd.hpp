@@ -0,0 +1,357 @@
+// -*- C++ -*-
+#ifndef _SIMD_HPP_
+#define _SIMD_HPP_
+
+///
+/// SIMD Utilities
+///
+/// This module defines the SIMD width and cache line size (SIMD_BYTES and
+/// CACHE_LINE_BYTES, which may be overridden at compile time), aligned memory
+/// allocation, and alignment hints for the compiler. The latter two use
+/// posix_memalign() and __builtin_assume_aligned() with GNU compatible
+/// compilers, and portable fallbacks with the other systems of config.hpp.
+///
+/// Indirect (indexed) loads and stores do not vectorize with plain loops.
+/// This module provides gather and scatter-add kernels which use AVX2 or
+/// AVX-512 gather/scatter instructions when these are enabled by the compiler
+/// (e.g., -march=native), and fall back to portable scalar loops otherwise.
+/// The AVX-512 scatter-add additionally requires SIMD_SCATTER to be defined.
+/// Generic templates are provided for any element and index types, and
+/// overloads for float64/float32 with int32/int64 indices use intrinsics.
+///
+/// $Id$
+///
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include "config.hpp"
+#if defined (__AVX2__) || defined (__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// SIMD register width in byte
+#ifndef SIMD_BYTES
+#if   defined (__AVX512F__)
+#define SIMD_BYTES 64
+#elif defined (__AVX__)
+#define SIMD_BYTES 32
+#else
+#define SIMD_BYTES 16
+#endif
+#endif
+
+// cache line size in byte
+#ifndef CACHE_LINE_BYTES
+#define CACHE_LINE_BYTES 64
+#endif
+
+namespace simd
+{
+/// number of SIMD lanes for type T
+template <class T>
+struct lanes
+{
+  enum { value = SIMD_BYTES/sizeof(T) > 0 ? SIMD_BYTES/sizeof(T) : 1 };
+};
+
+/// allocate memory for n elements aligned to a given boundary
+template <class T>
+inline T* aligned_alloc(const size_t n, const size_t align=SIMD_BYTES)
+{
+#if defined (__GNUC__)
+  void *ptr = 0;
+  if( posix_memalign(&ptr, align, n*sizeof(T)) != 0 ) {
+    throw std::bad_alloc();
+  }
+  return static_cast<T*>(ptr);
+#else
+  // over-allocate and keep the original pointer just before the block
+  char *raw = static_cast<char*>(malloc(n*sizeof(T) + align + sizeof(void*)));
+  if( raw == 0 ) {
+    throw std::bad_alloc();
+  }
+  uintptr_t addr = reinterpret_cast<uintptr_t>(raw + sizeof(void*));
+  addr = (addr + align - 1) / align * align;
+  reinterpret_cast<void**>(addr)[-1] = raw;
+  return reinterpret_cast<T*>(addr);
+#endif
+}
+
+/// release memory allocated by aligned_alloc()
+template <class T>
+inline void aligned_free(T* ptr)
+{
+#if defined (__GNUC__)
+  free(ptr);
+#else
+  if( ptr != 0 ) {
+    free(reinterpret_cast<void**>(ptr)[-1]);
+  }
+#endif
+}
+
+/// return true if the pointer is aligned to a given boundary
+inline bool is_aligned(const void* ptr, const size_t align=SIMD_BYTES)
+{
+  return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
+
+///
+/// @brief tell the compiler that the pointer is aligned to A byte
+///
+/// The result is undefined if the pointer is not actually aligned.
+///
+template <size_t A, class T>
+inline T* assume_aligned(T* ptr)
+{
+#if defined (__GNUC__)
+  return static_cast<T*>(__builtin_assume_aligned(ptr, A));
+#else
+  return ptr;
+#endif
+}
+
+/// @name generic (scalar) implementation
+//@{
+/// dst[i] = src[index[i]] for i = 0, ..., n-1
+template <class T, class I>
+inline void gather(const T* RESTRICT src, const I* RESTRICT index,
+                   T* RESTRICT dst, const int64 n)
+{
+  for(int64 i=0; i < n ;i++) {
+    dst[i] = src[index[i]];
+  }
+}
+
+/// dst[index[i]] += src[i] for i = 0, ..., n-1 (index may repeat)
+template <class T, class I>
+inline void scatter_add(T* RESTRICT dst, const I* RESTRICT index,
+                        const T* RESTRICT src, const int64 n)
+{
+  for(int64 i=0; i < n ;i++) {
+    dst[index[i]] += src[i];
+  }
+}
+//@}
+
+#if defined (__AVX512F__) || defined (__AVX2__)
+// pointer to indices for unaligned integer vector load
+template <class I>
+inline const __m256i* load_index(const I* index)
+{
+  return reinterpret_cast<const __m256i*>(index);
+}
+
+/// @name gather with AVX-512 or AVX2 intrinsics
+///
+/// The AVX-512 versions use the masked form with a zero pass-through, as
+/// the unmasked intrinsics leave it undefined (-Wmaybe-uninitialized).
+///
+//@{
+inline void gather(const float64* RESTRICT src, const int32* RESTRICT index,
+                   float64* RESTRICT dst, const int64 n)
+{
+  int64 i = 0;
+#if defined (__AVX512F__)
+  for(; i+8 <= n ;i+=8) {
+    __m256i idx = _mm256_loadu_si256(load_index(&index[i]));
+    _mm512_storeu_pd(&dst[i], _mm512_mask_i32gather_pd(_mm512_setzero_pd(),
+                                                       0xff, idx, src, 8));
+  }
+#else
+  for(; i+4 <= n ;i+=4) {
+    __m128i idx =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(&index[i]));
+    _mm256_storeu_pd(&dst[i], _mm256_i32gather_pd(src, idx, 8));
+  }
+#endif
+  for(; i < n ;i++) {
+    dst[i] = src[index[i]];
+  }
+}
+
+inline void gather(const float64* RESTRICT src, const int64* RESTRICT index,
+                   float64* RESTRICT dst, const int64 n)
+{
+  int64 i = 0;
+#if defined (__AVX512F__)
+  for(; i+8 <= n ;i+=8) {
+    __m512i idx = _mm512_loadu_si512(&index[i]);
+    _mm512_storeu_pd(&dst[i], _mm512_mask_i64gather_pd(_mm512_setzero_pd(),
+                                                       0xff, idx, src, 8));
+  }
+#else
+  for(; i+4 <= n ;i+=4) {
+    __m256i idx = _mm256_loadu_si256(load_index(&index[i]));
+    _mm256_storeu_pd(&dst[i], _mm256_i64gather_pd(src, idx, 8));
+  }
+#endif
+  for(; i < n ;i++) {
+    dst[i] = src[index[i]];
+  }
+}
+
+inline void gather(const float32* RESTRICT src, const int32* RESTRICT index,
+                   float32* RESTRICT dst, const int64 n)
+{
+  int64 i = 0;
+#if defined (__AVX512F__)
+  for(; i+16 <= n ;i+=16) {
+    __m512i idx = _mm512_loadu_si512(&index[i]);
+    _mm512_storeu_ps(&dst[i], _mm512_mask_i32gather_ps(_mm512_setzero_ps(),
+                                                       0xffff, idx, src, 4));
+  }
+#else
+  for(; i+8 <= n ;i+=8) {
+    __m256i idx = _mm256_loadu_si256(load_index(&index[i]));
+    _mm256_storeu_ps(&dst[i], _mm256_i32gather_ps(src, idx, 4));
+  }
+#endif
+  for(; i < n ;i++) {
+    dst[i] = src[index[i]];
+  }
+}
+
+inline void gather(const float32* RESTRICT src, const int64* RESTRICT index,
+                   float32* RESTRICT dst, const int64 n)
+{
+  int64 i = 0;
+#if defined (__AVX512F__)
+  for(; i+8 <= n ;i+=8) {
+    __m512i idx = _mm512_loadu_si512(&index[i]);
+    _mm256_storeu_ps(&dst[i], _mm512_mask_i64gather_ps(_mm256_setzero_ps(),
+                                                       0xff, idx, src, 4));
+  }
+#else
+  for(; i+4 <= n ;i+=4) {
+    __m256i idx = _mm256_loadu_si256(load_index(&index[i]));
+    _mm_storeu_ps(&dst[i], _mm256_i64gather_ps(src, idx, 4));
+  }
+#endif
+  for(; i < n ;i++) {
+    dst[i] = src[index[i]];
+  }
+}
+//@}
+#endif
+
+#if defined (__AVX512F__) && defined (__AVX512CD__) && defined (SIMD_SCATTER)
+///
+/// @name scatter-add with AVX-512 intrinsics
+///
+/// Repeated indices within a vector are detected with the conflict detection
+/// instruction (AVX512CD). In each pass, lanes whose index does not appear in
+/// any preceding lane still to be processed are updated with masked
+/// gather-add-scatter. The number of passes is thus the maximum multiplicity
+/// of an index within a vector, which is one if there is no conflict.
+///
+/// Scatter instructions are slow on many processors, and this version was
+/// found to be slower than the scalar loop on Xeon (Skylake-SP and later).
+/// It is therefore enabled only if SIMD_SCATTER is defined. AVX2 does not
+/// provide scatter instructions, and the generic scalar version is used.
+///
+//@{
+inline void scatter_add(float64* RESTRICT dst, const int64* RESTRICT index,
+                        const float64* RESTRICT src, const int64 n)
+{
+  int64 i = 0;
+  for(; i+8 <= n ;i+=8) {
+    __m512i  idx  = _mm512_loadu_si512(&index[i]);
+    __m512d  val  = _mm512_loadu_pd(&src[i]);
+    __m512i  conf = _mm512_conflict_epi64(idx);
+    __mmask8 todo = 0xff;
+    while( todo ) {
+      __m512i  live  = _mm512_set1_epi64(todo);
+      __mmask8 ready = _mm512_mask_testn_epi64_mask(todo, conf, live);
+      __m512d  x     = _mm512_mask_i64gather_pd(val, ready, idx, dst, 8);
+      _mm512_mask_i64scatter_pd(dst, ready, idx, _mm512_add_pd(x, val), 8);
+      todo &= ~ready;
+    }
+  }
+  for(; i < n ;i++) {
+    dst[index[i]] += src[i];
+  }
+}
+
+inline void scatter_add(float64* RESTRICT dst, const int32* RESTRICT index,
+                        const float64* RESTRICT src, const int64 n)
+{
+  int64 i = 0;
+  for(; i+8 <= n ;i+=8) {
+    __m256i  idx  = _mm256_loadu_si256(load_index(&index[i]));
+    __m512i  idx8 = _mm512_maskz_cvtepi32_epi64(0xff, idx);
+    __m512d  val  = _mm512_loadu_pd(&src[i]);
+    __m512i  conf = _mm512_conflict_epi64(idx8);
+    __mmask8 todo = 0xff;
+    while( todo ) {
+      __m512i  live  = _mm512_set1_epi64(todo);
+      __mmask8 ready = _mm512_mask_testn_epi64_mask(todo, conf, live);
+      __m512d  x     = _mm512_mask_i32gather_pd(val, ready, idx, dst, 8);
+      _mm512_mask_i32scatter_pd(dst, ready, idx, _mm512_add_pd(x, val), 8);
+      todo &= ~ready;
+    }
+  }
+  for(; i < n ;i++) {
+    dst[index[i]] += src[i];
+  }
+}
+
+inline void scatter_add(float32* RESTRICT dst, const int32* RESTRICT index,
+                        const float32* RESTRICT src, const int64 n)
+{
+  int64 i = 0;
+  for(; i+16 <= n ;i+=16) {
+    __m512i   idx  = _mm512_loadu_si512(&index[i]);
+    __m512    val  = _mm512_loadu_ps(&src[i]);
+    __m512i   conf = _mm512_conflict_epi32(idx);
+    __mmask16 todo = 0xffff;
+    while( todo ) {
+      __m512i   live  = _mm512_set1_epi32(todo);
+      __mmask16 ready = _mm512_mask_testn_epi32_mask(todo, conf, live);
+      __m512    x     = _mm512_mask_i32gather_ps(val, ready, idx, dst, 4);
+      _mm512_mask_i32scatter_ps(dst, ready, idx, _mm512_add_ps(x, val), 4);
+      todo &= ~ready;
+    }
+  }
+  for(; i < n ;i++) {
+    dst[index[i]] += src[i];
+  }
+}
+
+inline void scatter_add(float32* RESTRICT dst, const int64* RESTRICT index,
+                        const float32* RESTRICT src, const int64 n)
+{
+  int64 i = 0;
+  for(; i+8 <= n ;i+=8) {
+    __m512i  idx  = _mm512_loadu_si512(&index[i]);
+    __m256   val  = _mm256_loadu_ps(&src[i]);
+    __m512i  conf = _mm512_conflict_epi64(idx);
+    __mmask8 todo = 0xff;
+    while( todo ) {
+      __m512i  live  = _mm512_set1_epi64(todo);
+      __mmask8 ready = _mm512_mask_testn_epi64_mask(todo, conf, live);
+      __m256   x     = _mm512_mask_i64gather_ps(val, ready, idx, dst, 4);
+      _mm512_mask_i64scatter_ps(dst, ready, idx, _mm256_add_ps(x, val), 4);
+      todo &= ~ready;
+    }
+  }
+  for(; i < n ;i++) {
+    dst[index[i]] += src[i];
+  }
+}
+//@}
+#endif
+
+/// whether scatter_add of float64 and float32 uses vector instructions
+#if defined (__AVX512F__) && defined (__AVX512CD__) && defined (SIMD_SCATTER)
+enum { VECTOR_SCATTER_ADD = 1 };
+#else
+enum { VECTOR_SCATTER_ADD = 0 };
+#endif
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,546 @@
+// -*- C++ -*-
+#ifndef _SPARSE_HPP_
+#define _SPARSE_HPP_
+
+///
+/// Sparse Matrix Formats and SpMV Kernels
+///
+/// Sparse matrices in CSR (compressed sparse row) and SELL-C-sigma (sliced
+/// ELLPACK) formats are stored in NArray<.,1> for values, column indices and
+/// pointers. The column index is int32, the same as simd::gather.
+///
+/// CSR is created from (row, col, val) triplets in any order; duplicate
+/// entries are summed. SELL-C-sigma is created from CSR: rows are sorted by
+/// descending length within windows of sigma rows, and grouped in chunks of C
+/// rows which are padded to the longest row in the chunk. Within a chunk, the
+/// entries are stored column-major, i.e., the j-th entries of the C rows are
+/// contiguous, so that SIMD lanes run across the rows of a chunk. Padding is
+/// kept small by sorting, and rows are permuted back when storing the result.
+///
+/// SpMV streams the values and indices (12 bytes per nonzero for float64)
+/// and approaches the memory bandwidth only with enough threads; a single
+/// core achieves about 40-50 % of the stream triad bandwidth (TestSparse).
+/// The rows (chunks) are partitioned across threads statically such that each
+/// thread has about the same number of nonzeros (including padding), rather than
+/// the same number of rows. If the matrix is created with numa = true, the
+/// storage is initialized in parallel with the same partition, so that the
+/// pages are placed on the memory of the NUMA node of the thread which uses
+/// them (first-touch policy). Vectors may be initialized by touch() likewise.
+/// The partition is computed for the number of threads at creation; another
+/// number of threads falls back to an even split.
+///
+/// $Id$
+///
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace sparse
+{
+/// default number of rows in a chunk of SELL-C-sigma
+enum { CHUNK = 8 };
+
+/// default sorting window of SELL-C-sigma
+enum { SIGMA = 256 };
+
+/// return number of threads
+inline int get_num_threads()
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+/// return thread id and number of threads in a parallel region
+inline void get_thread(int &tid, int &nth)
+{
+#ifdef _OPENMP
+  tid = omp_get_thread_num();
+  nth = omp_get_num_threads();
+#else
+  tid = 0;
+  nth = 1;
+#endif
+}
+
+///
+/// @class Partition sparse.hpp
+/// @brief static partition of n items balanced by cumulative cost
+///
+class Partition
+{
+private:
+  std::vector<int64> m_bound;
+
+public:
+  Partition() : m_bound(2, 0)
+  {
+  }
+
+  /// partition n items with cumulative cost ptr[0..n] (ptr[0] = 0)
+  void balance(const int64* ptr, const int64 n, const int nthread)
+  {
+    // each item costs one in addition to ptr as for loop overhead
+    const float64 total = static_cast<float64>(ptr[n] + n);
+
+    m_bound.resize(nthread+1);
+    m_bound[0] = 0;
+    for(int t=1; t < nthread ;t++) {
+      const float64 target = total * t / nthread;
+      int64 lo = m_bound[t-1];
+      int64 hi = n;
+      while( lo < hi ) {
+        const int64 mid = (lo + hi) / 2;
+        if( ptr[mid] + mid < target ) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      m_bound[t] = lo;
+    }
+    m_bound[nthread] = n;
+  }
+
+  /// number of threads for which the partition is computed
+  int getNumThread() const
+  {
+    return static_cast<int>(m_bound.size()) - 1;
+  }
+
+  /// range [begin, end) of thread tid out of nth threads
+  void range(const int tid, const int nth, int64 &begin, int64 &end) const
+  {
+    if( nth == getNumThread() ) {
+      begin = m_bound[tid];
+      end   = m_bound[tid+1];
+    } else {
+      const int64 n = m_bound.back();
+      begin = n * tid / nth;
+      end   = n * (tid+1) / nth;
+    }
+  }
+};
+
+///
+/// @class CSR sparse.hpp
+/// @brief compressed sparse row matrix
+///
+template <class T>
+class CSR
+{
+private:
+  int64     m_nrow;
+  int64     m_ncol;
+  Partition m_part;
+
+  std::unique_ptr< NArray<int64,1> > m_ptr;
+  std::unique_ptr< NArray<int32,1> > m_col;
+  std::unique_ptr< NArray<T,1> >     m_val;
+
+  // remain undefined
+  CSR(const CSR &);
+  CSR& operator=(const CSR &);
+
+  // order of entries by column
+  static bool compare(const std::pair<int32,T> &a, const std::pair<int32,T> &b)
+  {
+    return a.first < b.first;
+  }
+
+public:
+  ///
+  /// @brief constructor from triplets
+  ///
+  /// @param[in] nrow number of rows
+  /// @param[in] ncol number of columns
+  /// @param[in] row  row indices
+  /// @param[in] col  column indices
+  /// @param[in] val  values
+  /// @param[in] numa initialize storage in parallel for first-touch
+  ///
+  CSR(const int64 nrow, const int64 ncol, const std::vector<int64> &row,
+      const std::vector<int32> &col, const std::vector<T> &val,
+      const bool numa=false)
+    : m_nrow(nrow), m_ncol(ncol)
+  {
+    const int64 nt = row.size();
+
+    // counting sort by row, then sort each row by column
+    std::vector<int64> ptr(nrow+1, 0);
+    for(int64 i=0; i < nt ;i++) {
+      ptr[row[i]+1]++;
+    }
+    for(int64 i=0; i < nrow ;i++) {
+      ptr[i+1] += ptr[i];
+    }
+
+    std::vector<int64> pos(ptr.begin(), ptr.end()-1);
+    std::vector< std::pair<int32,T> > entry(nt);
+    for(int64 i=0; i < nt ;i++) {
+      entry[pos[row[i]]++] = std::make_pair(col[i], val[i]);
+    }
+
+    // sum duplicates
+    std::vector<int64> rptr(nrow+1, 0);
+    int64 nnz = 0;
+    for(int64 i=0; i < nrow ;i++) {
+      typename std::vector< std::pair<int32,T> >::iterator
+        first = entry.begin() + ptr[i], last = entry.begin() + ptr[i+1];
+      std::stable_sort(first, last, compare);
+      for(int64 p=ptr[i]; p < ptr[i+1] ;p++) {
+        if( nnz > rptr[i] && entry[nnz-1].first == entry[p].first ) {
+          entry[nnz-1].second += entry[p].second;
+        } else {
+          entry[nnz++] = entry[p];
+        }
+      }
+      rptr[i+1] = nnz;
+    }
+
+    m_part.balance(&rptr[0], nrow, get_num_threads());
+
+    m_ptr.reset(new NArray<int64,1>(nrow+1));
+    m_col.reset(new NArray<int32,1>(nnz));
+    m_val.reset(new NArray<T,1>(nnz));
+
+    int64* RESTRICT p = m_ptr->data;
+    int32* RESTRICT c = m_col->data;
+    T* RESTRICT     v = m_val->data;
+    p[nrow] = nnz;
+
+#pragma omp parallel if( numa )
+    {
+      int tid, nth;
+      int64 is, ie;
+      get_thread(tid, nth);
+      m_part.range(tid, nth, is, ie);
+
+      for(int64 i=is; i < ie ;i++) {
+        p[i] = rptr[i];
+        for(int64 k=rptr[i]; k < rptr[i+1] ;k++) {
+          c[k] = entry[k].first;
+          v[k] = entry[k].second;
+        }
+      }
+    }
+  }
+
+  int64 getRows() const
+  {
+    return m_nrow;
+  }
+
+  int64 getCols() const
+  {
+    return m_ncol;
+  }
+
+  int64 getNonZeros() const
+  {
+    return m_val->getSize();
+  }
+
+  const Partition& getPartition() const
+  {
+    return m_part;
+  }
+
+  const NArray<int64,1>& getPtr() const
+  {
+    return *m_ptr;
+  }
+
+  const NArray<int32,1>& getCol() const
+  {
+    return *m_col;
+  }
+
+  const NArray<T,1>& getVal() const
+  {
+    return *m_val;
+  }
+
+  /// range of rows [begin, end) of thread tid out of nth threads
+  void row_range(const int tid, const int nth, int64 &begin, int64 &end) const
+  {
+    m_part.range(tid, nth, begin, end);
+  }
+
+  /// y = A x for raw pointers (called by every thread in a parallel region)
+  void multiply_range(const T* RESTRICT x, T* RESTRICT y,
+                      const int tid, const int nth) const
+  {
+    const int64* RESTRICT p = m_ptr->data;
+    const int32* RESTRICT c = m_col->data;
+    const T* RESTRICT     v = m_val->data;
+
+    int64 is, ie;
+    m_part.range(tid, nth, is, ie);
+
+    for(int64 i=is; i < ie ;i++) {
+      T sum = 0;
+#pragma omp simd reduction(+:sum)
+      for(int64 k=p[i]; k < p[i+1] ;k++) {
+        sum += v[k] * x[c[k]];
+      }
+      y[i] = sum;
+    }
+  }
+};
+
+///
+/// @class SELL sparse.hpp
+/// @brief SELL-C-sigma matrix with C rows in a chunk
+///
+template <class T, int C=CHUNK>
+class SELL
+{
+private:
+  int64     m_nrow;
+  int64     m_ncol;
+  int64     m_nchunk;
+  int64     m_nnz;
+  Partition m_part;
+
+  std::unique_ptr< NArray<int64,1> > m_ptr;  ///< chunk pointer
+  std::unique_ptr< NArray<int32,1> > m_len;  ///< chunk width
+  std::unique_ptr< NArray<int64,1> > m_perm; ///< original row (-1 for pad)
+  std::unique_ptr< NArray<int32,1> > m_col;
+  std::unique_ptr< NArray<T,1> >     m_val;
+
+  // remain undefined
+  SELL(const SELL &);
+  SELL& operator=(const SELL &);
+
+public:
+  ///
+  /// @brief constructor from CSR
+  ///
+  /// @param[in] a     CSR matrix
+  /// @param[in] sigma sorting window (rounded up to a multiple of C)
+  /// @param[in] numa  initialize storage in parallel for first-touch
+  ///
+  SELL(const CSR<T> &a, const int64 sigma=SIGMA, const bool numa=false)
+    : m_nrow(a.getRows()), m_ncol(a.getCols()), m_nnz(a.getNonZeros())
+  {
+    const int64* ap = a.getPtr().data;
+    const int32* ac = a.getCol().data;
+    const T*     av = a.getVal().data;
+    const int64  nr = m_nrow;
+    const int64  ns = std::max<int64>(1, (sigma + C - 1) / C) * C;
+
+    m_nchunk = (nr + C - 1) / C;
+
+    // sort rows by descending length within windows
+    std::vector<int64> perm(m_nchunk*C, -1);
+    for(int64 i=0; i < nr ;i++) {
+      perm[i] = i;
+    }
+    for(int64 s=0; s < nr ;s+=ns) {
+      std::stable_sort(perm.begin() + s, perm.begin() + std::min(s+ns, nr),
+                       [ap] (const int64 i, const int64 j)
+                       { return ap[i+1]-ap[i] > ap[j+1]-ap[j]; });
+    }
+
+    // chunk width and pointer
+    std::vector<int64> cptr(m_nchunk+1, 0);
+    std::vector<int32> clen(m_nchunk, 0);
+    for(int64 ic=0; ic < m_nchunk ;ic++) {
+      int64 w = 0;
+      for(int r=0; r < C ;r++) {
+        const int64 i = perm[ic*C + r];
+        if( i >= 0 ) w = std::max(w, ap[i+1] - ap[i]);
+      }
+      clen[ic]   = w;
+      cptr[ic+1] = cptr[ic] + w*C;
+    }
+
+    m_part.balance(&cptr[0], m_nchunk, get_num_threads());
+
+    m_ptr.reset(new NArray<int64,1>(m_nchunk+1));
+    m_len.reset(new NArray<int32,1>(m_nchunk));
+    m_perm.reset(new NArray<int64,1>(m_nchunk*C));
+    m_col.reset(new NArray<int32,1>(cptr[m_nchunk]));
+    m_val.reset(new NArray<T,1>(cptr[m_nchunk]));
+
+    int64* RESTRICT p = m_ptr->data;
+    int32* RESTRICT l = m_len->data;
+    int64* RESTRICT q = m_perm->data;
+    int32* RESTRICT c = m_col->data;
+    T* RESTRICT     v = m_val->data;
+    p[m_nchunk] = cptr[m_nchunk];
+
+#pragma omp parallel if( numa )
+    {
+      int tid, nth;
+      int64 cs, ce;
+      get_thread(tid, nth);
+      m_part.range(tid, nth, cs, ce);
+
+      for(int64 ic=cs; ic < ce ;ic++) {
+        p[ic] = cptr[ic];
+        l[ic] = clen[ic];
+        for(int r=0; r < C ;r++) {
+          const int64 i = perm[ic*C + r];
+          const int64 n = (i >= 0) ? ap[i+1] - ap[i] : 0;
+          q[ic*C + r] = i;
+          // padding refers to the last column of the row to stay in cache
+          int32 last = 0;
+          for(int64 j=0; j < clen[ic] ;j++) {
+            const int64 k = cptr[ic] + j*C + r;
+            if( j < n ) {
+              last = ac[ap[i]+j];
+              c[k] = last;
+              v[k] = av[ap[i]+j];
+            } else {
+              c[k] = last;
+              v[k] = 0;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  int64 getRows() const
+  {
+    return m_nrow;
+  }
+
+  int64 getCols() const
+  {
+    return m_ncol;
+  }
+
+  int64 getNonZeros() const
+  {
+    return m_nnz;
+  }
+
+  /// number of stored entries including padding
+  int64 getStorage() const
+  {
+    return m_val->getSize();
+  }
+
+  const Partition& getPartition() const
+  {
+    return m_part;
+  }
+
+  /// range of (sorted) rows [begin, end) of thread tid out of nth threads
+  void row_range(const int tid, const int nth, int64 &begin, int64 &end) const
+  {
+    m_part.range(tid, nth, begin, end);
+    begin = std::min(begin*C, m_nrow);
+    end   = std::min(end*C, m_nrow);
+  }
+
+  /// y = A x for raw pointers (called by every thread in a parallel region)
+  void multiply_range(const T* RESTRICT x, T* RESTRICT y,
+                      const int tid, const int nth) const
+  {
+    const int64* RESTRICT p = m_ptr->data;
+    const int32* RESTRICT l = m_len->data;
+    const int64* RESTRICT q = m_perm->data;
+    const int32* RESTRICT c = m_col->data;
+    const T* RESTRICT     v = m_val->data;
+
+    int64 cs, ce;
+    m_part.range(tid, nth, cs, ce);
+
+    for(int64 ic=cs; ic < ce ;ic++) {
+      T sum[C];
+#pragma omp simd
+      for(int r=0; r < C ;r++) {
+        sum[r] = 0;
+      }
+      for(int64 j=0; j < l[ic] ;j++) {
+        const int64 k = p[ic] + j*C;
+#pragma omp simd
+        for(int r=0; r < C ;r++) {
+          sum[r] += v[k+r] * x[c[k+r]];
+        }
+      }
+      for(int r=0; r < C ;r++) {
+        const int64 i = q[ic*C + r];
+        if( i >= 0 ) y[i] = sum[r];
+      }
+    }
+  }
+};
+
+///
+/// @brief y = A x
+///
+/// Arrays of any rank are regarded as flat vectors; x and y should have
+/// getCols() and getRows() elements, respectively.
+///
+template <class Matrix, class T, int R>
+void spmv(const Matrix &a, const NArray<T,R> &x, NArray<T,R> &y)
+{
+  const T* xp = x.data;
+  T*       yp = y.data;
+
+#pragma omp parallel
+  {
+    int tid, nth;
+    get_thread(tid, nth);
+    a.multiply_range(xp, yp, tid, nth);
+  }
+}
+
+///
+/// @brief zero-fill a vector with the row partition of a matrix
+///
+/// When called right after allocation, the pages of x are placed on the
+/// NUMA node of the thread which computes the corresponding rows. For SELL,
+/// rows are permuted within sorting windows, which is local enough. The
+/// whole x is zeroed: elements beyond getRows() (e.g., x sized by getCols()
+/// of a wide matrix) are evenly divided among threads.
+///
+template <class Matrix, class T, int R>
+void touch(const Matrix &a, NArray<T,R> &x)
+{
+  const int64 n  = x.getSize();
+  const int64 nr = std::min(a.getRows(), n);
+  T* RESTRICT xp = x.data;
+
+#pragma omp parallel
+  {
+    int tid, nth;
+    int64 is, ie;
+    get_thread(tid, nth);
+    a.row_range(tid, nth, is, ie);
+    ie = std::min(ie, nr);
+
+#pragma omp simd
+    for(int64 i=is; i < ie ;i++) {
+      xp[i] = 0;
+    }
+
+    // tail
+    is = nr + (n - nr) * tid / nth;
+    ie = nr + (n - nr) * (tid + 1) / nth;
+
+#pragma omp simd
+    for(int64 i=is; i < ie ;i++) {
+      xp[i] = 0;
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,494 @@
+// -*- C++ -*-
+#ifndef _STENCIL_HPP_
+#define _STENCIL_HPP_
+
+///
+/// Cache-Blocked Multithreaded 3D Stencil Driver
+///
+/// A pointwise kernel f(i, j, k), which typically reads neighbors of (i,j,k)
+/// within a given stencil radius from input arrays and writes (i,j,k) of an
+/// output array, is applied to an index range of NArray<T,3>. The range is
+/// decomposed into tiles such that the working set of a tile fits in cache
+/// (STENCIL_CACHE_BYTES), and tiles are distributed across OpenMP threads.
+/// Within a tile, the innermost dimension is vectorized with "omp simd".
+///
+/// The range may be the interior of a ghosted array, or an arbitrary slice
+/// (sub-box) of it:
+///
+///   // 7-point Laplacian on the interior excluding one ghost cell
+///   stencil::sweep<1>(u, [&](int i, int j, int k)
+///                     {
+///                       v(i,j,k) = u(i-1,j,k) + u(i+1,j,k) + ... ;
+///                     });
+///
+///   // slice with explicit tiling
+///   loopnest::Range<3> r = {{lo0, lo1, lo2}, {hi0, hi1, hi2}};
+///   stencil::sweep(r, stencil::tiling<double>(r, 1), kernel);
+///
+/// sweep_max() and sweep_min() take a kernel returning a value and reduce
+/// it within the same sweep, e.g., for the CFL condition together with the
+/// conversion to primitive variables. The local result may then be passed to
+/// a non-blocking global reduction (mpiutils::Reduction) of which the result
+/// is fetched when needed:
+///
+///   double dt = stencil::sweep_min<2>(u, [&](int i, int j, int k)
+///                                     {
+///                                       ... // primitive variables
+///                                       return dx/(abs(vx) + cs);
+///                                     });
+///   mpiutils::Reduction cfl;
+///   cfl.begin(dt, MPI_MIN);
+///
+/// For a stencil applied many times (smoothers, explicit diffusion substeps,
+/// Jacobi iterations), iterate() performs temporal blocking: tblock time
+/// levels are advanced in cache by a wavefront along the first dimension,
+/// with overlapped tiles in the other dimensions (halo cells are computed
+/// redundantly by neighboring tiles). The kernel is written in terms of View
+/// objects with global indices, so that the same kernel works both on arrays
+/// and on scratch buffers:
+///
+///   // 16 Jacobi iterations for Laplace equation, 4 time levels per tile
+///   stencil::iterate<1>(u, w, 16,
+///                       [](const stencil::View<double> &in,
+///                          const stencil::View<double> &out,
+///                          int i, int j, int k)
+///                       {
+///                         out(i,j,k) = (in(i-1,j,k) + in(i+1,j,k) + ...)/6;
+///                       }, 4);
+///
+/// $Id$
+///
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+#include "loopnest.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// cache size in byte for which tiles are chosen (about half of L2)
+#ifndef STENCIL_CACHE_BYTES
+#define STENCIL_CACHE_BYTES (512*1024)
+#endif
+
+namespace stencil
+{
+/// maximum tile size of the innermost (vectorized) dimension
+enum { MAX_TILE_INNER = 256 };
+
+/// tile size in each dimension
+struct Tiling
+{
+  int64 size[3];
+};
+
+/// return number of threads
+inline int get_num_threads()
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+///
+/// @brief return tiling for a range
+///
+/// Tiles are chosen for 2.5D blocking: the innermost dimension is kept long
+/// for vectorization, the middle dimension is chosen such that 2*radius+1
+/// planes of the tile (including halo) for narray arrays fit in cache, and
+/// the outermost dimension is streamed. The outermost dimension is split
+/// only if there are not enough tiles to keep all the threads busy.
+///
+template <class T>
+Tiling tiling(const loopnest::Range<3> &r, const int radius,
+              const int narray=2)
+{
+  const int64 n0 = std::max<int64>(r.hi[0] - r.lo[0], 1);
+  const int64 n1 = std::max<int64>(r.hi[1] - r.lo[1], 1);
+  const int64 n2 = std::max<int64>(r.hi[2] - r.lo[2], 1);
+
+  Tiling t;
+
+  // innermost
+  t.size[2] = std::min<int64>(n2, MAX_TILE_INNER);
+
+  // middle
+  const int64 plane = (2*radius + 1) * (t.size[2] + 2*radius) *
+    narray * sizeof(T);
+  t.size[1] = STENCIL_CACHE_BYTES / plane - 2*radius;
+  t.size[1] = std::max<int64>(std::min<int64>(t.size[1], n1), 1);
+
+  // outermost
+  const int64 ntile = ((n1 + t.size[1] - 1)/t.size[1]) *
+    ((n2 + t.size[2] - 1)/t.size[2]);
+  const int64 nsplit = (4*get_num_threads() + ntile - 1)/ntile;
+  t.size[0] = std::max<int64>((n0 + nsplit - 1)/nsplit, 1);
+
+  return t;
+}
+
+///
+/// @brief apply kernel f(i, j, k) to a range with given tiling
+///
+template <class F>
+void sweep(const loopnest::Range<3> &r, const Tiling &t, F &&f)
+{
+  typedef loopnest::RowMajor<3> O;
+  typedef loopnest::NoTile<3>   T;
+  typedef loopnest::Nest<O,T,3> Nest;
+
+  int64 nt[3];
+  for(int d=0; d < 3 ;d++) {
+    nt[d] = (r.hi[d] - r.lo[d] + t.size[d] - 1) / t.size[d];
+    if( nt[d] <= 0 ) return;
+  }
+  const int64 ntile = nt[0]*nt[1]*nt[2];
+
+#pragma omp parallel for schedule(static)
+  for(int64 it=0; it < ntile ;it++) {
+    int64 id[3] = {it / (nt[1]*nt[2]), (it / nt[2]) % nt[1], it % nt[2]};
+
+    loopnest::Range<3> box;
+    for(int d=0; d < 3 ;d++) {
+      box.lo[d] = r.lo[d] + id[d]*t.size[d];
+      box.hi[d] = std::min(box.lo[d] + t.size[d], r.hi[d]);
+    }
+    Nest::apply(box, f);
+  }
+}
+
+///
+/// @brief apply kernel f(i, j, k) to a range with default tiling
+///
+/// Type T (element type) and narray (number of arrays accessed by the
+/// kernel) are used only for choosing tile size.
+///
+template <class T, class F>
+void sweep(const loopnest::Range<3> &r, const int radius, F &&f,
+           const int narray=2)
+{
+  sweep(r, tiling<T>(r, radius, narray), f);
+}
+
+///
+/// @brief apply kernel f(i, j, k) to the interior of ghosted array
+///
+/// The interior excludes Radius ghost cells on each side.
+///
+template <int Radius, class T, class F>
+void sweep(const NArray<T,3> &a, F &&f, const int narray=2)
+{
+  sweep<T>(loopnest::range(a, Radius), Radius, f, narray);
+}
+
+///
+/// @brief apply kernel f(i, j, k) to a range and return maximum of results
+///
+/// The kernel returns a value (e.g., signal speed) in addition to any work
+/// it does, and the maximum is reduced within the vectorized loop and then
+/// across threads, so that the reduction is fused into the sweep. The lowest
+/// value of the type is returned for an empty range.
+///
+template <class F>
+auto sweep_max(const loopnest::Range<3> &r, const Tiling &t, F &&f)
+  -> typename std::decay<decltype(f(0, 0, 0))>::type
+{
+  typedef typename std::decay<decltype(f(0, 0, 0))>::type T;
+
+  T result = std::numeric_limits<T>::lowest();
+
+  int64 nt[3];
+  for(int d=0; d < 3 ;d++) {
+    nt[d] = (r.hi[d] - r.lo[d] + t.size[d] - 1) / t.size[d];
+    if( nt[d] <= 0 ) return result;
+  }
+  const int64 ntile = nt[0]*nt[1]*nt[2];
+
+#pragma omp parallel for schedule(static) reduction(max:result)
+  for(int64 it=0; it < ntile ;it++) {
+    int64 id[3] = {it / (nt[1]*nt[2]), (it / nt[2]) % nt[1], it % nt[2]};
+
+    int lo[3], hi[3];
+    for(int d=0; d < 3 ;d++) {
+      lo[d] = r.lo[d] + id[d]*t.size[d];
+      hi[d] = std::min(lo[d] + t.size[d], r.hi[d]);
+    }
+
+    T m = result;
+    for(int i=lo[0]; i < hi[0] ;i++) {
+      for(int j=lo[1]; j < hi[1] ;j++) {
+#pragma omp simd reduction(max:m)
+        for(int k=lo[2]; k < hi[2] ;k++) {
+          const T v = f(i, j, k);
+          m = (v > m) ? v : m;
+        }
+      }
+    }
+    result = (m > result) ? m : result;
+  }
+
+  return result;
+}
+
+///
+/// @brief apply kernel f(i, j, k) to a range and return minimum of results
+///
+/// This is sweep_max() of -f; e.g., the minimum time step of cells.
+///
+template <class F>
+auto sweep_min(const loopnest::Range<3> &r, const Tiling &t, F &&f)
+  -> typename std::decay<decltype(f(0, 0, 0))>::type
+{
+  return -sweep_max(r, t, [&](int i, int j, int k) { return -f(i, j, k); });
+}
+
+///
+/// @brief sweep_max() for the interior of ghosted array
+///
+template <int Radius, class T, class F>
+auto sweep_max(const NArray<T,3> &a, F &&f, const int narray=2)
+  -> typename std::decay<decltype(f(0, 0, 0))>::type
+{
+  const loopnest::Range<3> r = loopnest::range(a, Radius);
+  return sweep_max(r, tiling<T>(r, Radius, narray), f);
+}
+
+///
+/// @brief sweep_min() for the interior of ghosted array
+///
+template <int Radius, class T, class F>
+auto sweep_min(const NArray<T,3> &a, F &&f, const int narray=2)
+  -> typename std::decay<decltype(f(0, 0, 0))>::type
+{
+  const loopnest::Range<3> r = loopnest::range(a, Radius);
+  return sweep_min(r, tiling<T>(r, Radius, narray), f);
+}
+
+///
+/// @class View stencil.hpp
+/// @brief view of 3D array with global indices
+///
+/// Planes (first dimension) are referred to via a table of pointers, so that
+/// a view may consist of planes of an array and of scratch buffers. A
+/// scratch plane covers only a part of the array plane, and the offset gives
+/// the flat index of its origin in the second and third dimensions.
+///
+template <class T>
+struct View
+{
+  T* const *plane;  ///< pointer to each plane
+  int64     stride; ///< stride of the second dimension
+  int64     offset; ///< flat index (j*stride + k) of origin of plane
+
+  /// access operator with global indices
+  T& operator()(int i, int j, int k) const
+  {
+    return plane[i][j*stride + k - offset];
+  }
+};
+
+///
+/// @brief return tiling for temporal blocking
+///
+/// The first dimension is not tiled (it is the direction of the wavefront).
+/// Tiles in the other dimensions are chosen such that the scratch planes of
+/// a tile with halo of tblock*radius cells fit in cache, but the tile size
+/// is at least the halo width to bound redundant computation.
+///
+template <class T>
+Tiling tiling_temporal(const loopnest::Range<3> &r, const int radius,
+                       const int tblock)
+{
+  const int64 h  = radius*tblock;
+  const int64 n0 = std::max<int64>(r.hi[0] - r.lo[0], 1);
+  const int64 n1 = std::max<int64>(r.hi[1] - r.lo[1], 1);
+  const int64 n2 = std::max<int64>(r.hi[2] - r.lo[2], 1);
+
+  Tiling t;
+  t.size[0] = n0;
+  t.size[2] = std::min<int64>(n2, MAX_TILE_INNER);
+
+  const int64 nplane = (tblock + 1)*(2*radius + 1);
+  const int64 row    = (t.size[2] + 2*h)*sizeof(T);
+  t.size[1] = STENCIL_CACHE_BYTES / (nplane*row) - 2*h;
+  t.size[1] = std::max<int64>(t.size[1], 2*h);
+  t.size[1] = std::max<int64>(std::min<int64>(t.size[1], n1), 1);
+
+  return t;
+}
+
+///
+/// @brief apply stencil nstep times with temporal blocking
+///
+/// Kernel f(in, out, i, j, k) computes out(i,j,k) from in, where in and out
+/// are View<T> objects accessed with global indices. After the call, u holds
+/// the result and w is used as work space. Ghost cells (Radius cells on each
+/// side) of u are kept fixed during the iterations.
+///
+/// Each tile (in the second and third dimensions, with halo of
+/// tblock*Radius cells) advances tblock time levels at once by a wavefront
+/// along the first dimension: time level s lags behind level s-1 by Radius
+/// planes, and the intermediate levels are kept only in a small ring buffer
+/// of 2*Radius+1 planes (of the tile with halo) per level. The input and
+/// output arrays are thus accessed only once per tblock time levels. With
+/// tblock = 1, this is equivalent to nstep sweeps.
+///
+template <int Radius, class T, class F>
+void iterate(NArray<T,3> &u, NArray<T,3> &w, const int nstep, F &&f,
+             const int tblock=4)
+{
+  if( tblock < 1 ) {
+    std::cerr << "Error in stencil::iterate() !" << std::endl
+              << "===> tblock should be positive." << std::endl;
+    return;
+  }
+
+  const int   nring = 2*Radius + 1;
+  const int   N0    = u.shape[0];
+  const int   N1    = u.shape[1];
+  const int   N2    = u.shape[2];
+  const int64 psize = N1*N2;
+
+  const loopnest::Range<3> r = loopnest::range(u, Radius);
+  const Tiling t = tiling_temporal<T>(r, Radius, tblock);
+
+  int64 nt[3];
+  for(int d=0; d < 3 ;d++) {
+    nt[d] = (r.hi[d] - r.lo[d] + t.size[d] - 1) / t.size[d];
+    if( nt[d] <= 0 ) return;
+  }
+  const int64 ntile = nt[1]*nt[2];
+
+  // scratch plane of a tile with halo
+  const int64 H     = Radius*tblock;
+  const int64 lw1   = t.size[1] + 2*H;
+  const int64 lw2   = t.size[2] + 2*H;
+  const int64 lsize = lw1*lw2;
+
+  // ghost cells of work array
+  std::copy(u.data, u.data + u.getSize(), w.data);
+
+  // number of passes over the arrays (the result is in w if odd)
+  const int npass = (nstep + tblock - 1) / tblock;
+
+#pragma omp parallel
+  {
+    // input and output are swapped by each thread after every pass
+    T *src = u.data;
+    T *dst = w.data;
+
+    // ring buffers and plane tables for intermediate time levels
+    T *buf = simd::aligned_alloc<T>((tblock-1)*nring*lsize + 1);
+    std::vector<T*> table((tblock+1)*N0);
+    std::vector< View<T> > view(tblock+1);
+    for(int s=0; s <= tblock ;s++) {
+      view[s].plane  = &table[s*N0];
+      view[s].stride = N2;
+      view[s].offset = 0;
+    }
+    for(int s=1; s < tblock ;s++) {
+      view[s].stride = lw2;
+      for(int i=0; i < N0 ;i++) {
+        table[s*N0 + i] = buf + ((s-1)*nring + i%nring)*lsize;
+      }
+    }
+
+    for(int step=0; step < nstep ;step+=tblock) {
+      const int ns = std::min(tblock, nstep - step);
+
+      // input and output
+      for(int i=0; i < N0 ;i++) {
+        table[0*N0 + i]  = src + i*psize;
+        table[ns*N0 + i] = dst + i*psize;
+      }
+      view[ns].stride = N2;
+      view[ns].offset = 0;
+
+#pragma omp for schedule(dynamic)
+      for(int64 it=0; it < ntile ;it++) {
+        const int64 id[3] = {0, it / nt[2], it % nt[2]};
+
+        // tile
+        loopnest::Range<3> box;
+        for(int d=1; d < 3 ;d++) {
+          box.lo[d] = r.lo[d] + id[d]*t.size[d];
+          box.hi[d] = std::min(box.lo[d] + t.size[d], r.hi[d]);
+        }
+
+        // origin of scratch planes
+        for(int s=1; s < ns ;s++) {
+          view[s].stride = lw2;
+          view[s].offset = (box.lo[1] - H)*lw2 + (box.lo[2] - H);
+        }
+
+        // wavefront (ghost planes of intermediate levels are copied)
+        for(int q=0; q < r.hi[0] + (ns-1)*Radius ;q++) {
+          for(int s=1; s <= ns ;s++) {
+            const int  ip    = q - (s-1)*Radius;
+            const bool ghost = ip < r.lo[0] || ip >= r.hi[0];
+            if( ip < 0 || ip >= N0 || (ghost && s == ns) ) continue;
+
+            // region of level s shrinks toward the tile
+            const int64 h = Radius*(ns-s);
+            loopnest::Range<3> reg;
+            reg.lo[0] = ip;
+            reg.hi[0] = ip+1;
+            for(int d=1; d < 3 ;d++) {
+              reg.lo[d] = std::max(box.lo[d] - h, r.lo[d]);
+              reg.hi[d] = std::min(box.hi[d] + h, r.hi[d]);
+            }
+
+            const View<T> &in  = view[s-1];
+            const View<T> &out = view[s];
+            if( !ghost ) {
+              loopnest::nd_for(reg, [&](int i, int j, int k)
+                               {
+                                 f(in, out, i, j, k);
+                               });
+            }
+
+            // ghost cells of intermediate level
+            if( s < ns ) {
+              const int j0 = std::max<int64>(reg.lo[1] - Radius, 0);
+              const int j1 = std::min<int64>(reg.hi[1] + Radius, N1);
+              const int k0 = std::max<int64>(reg.lo[2] - Radius, 0);
+              const int k1 = std::min<int64>(reg.hi[2] + Radius, N2);
+              for(int j=j0; j < j1 ;j++) {
+                const bool g  = ghost || j < r.lo[1] || j >= r.hi[1];
+                const int  kb = g ? k1 : std::max<int64>(r.lo[2], k0);
+                const int  ke = g ? k1 : std::min<int64>(r.hi[2], k1);
+                for(int k=k0; k < kb ;k++) {
+                  out(ip,j,k) = view[0](ip,j,k);
+                }
+                for(int k=ke; k < k1 ;k++) {
+                  out(ip,j,k) = view[0](ip,j,k);
+                }
+              }
+            }
+          }
+        }
+      }
+
+      std::swap(src, dst);
+    }
+
+    simd::aligned_free(buf);
+  }
+
+  // result is in work array
+  if( npass % 2 == 1 ) {
+    std::copy(w.data, w.data + w.getSize(), u.data);
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif
@@ -0,0 +1,269 @@
+// -*- C++ -*-
+#ifndef _TRIDIAG_HPP_
+#define _TRIDIAG_HPP_
+
+///
+/// Batched Tridiagonal Solver
+///
+/// Tridiagonal systems
+///
+///   a[i]*x[i-1] + b[i]*x[i] + c[i]*x[i+1] = d[i]   (i = 0, ..., n-1)
+///
+/// are solved by the Thomas algorithm for many systems (lines) at once. The
+/// recurrence along a line is sequential, and thus SIMD lanes run across
+/// lines: the element i of the line l is at p[i*stride + l] for l = 0, ...,
+/// m-1, so that the innermost (vectorized) loop is contiguous.
+///
+/// For a periodic (cyclic) system, a[0] and c[n-1] are the coefficients of
+/// x[n-1] in the first row and of x[0] in the last row, respectively; they
+/// are ignored otherwise. The cyclic system is solved with Sherman-Morrison
+/// formula, i.e., by two Thomas solves with a modified matrix.
+///
+/// solve() for NArray solves all the lines along a given axis in-place: the
+/// right-hand-side d is overwritten by the solution. The array is regarded
+/// as [n0][n1][n2] with n1 along the axis. For an axis other than the last
+/// one, the lines are already interleaved in the contiguous dimension n2, so
+/// that they are solved directly without transpose in blocks of BLOCK lines.
+/// For the last axis, LANES lines are transposed into scratch memory, which
+/// stays in cache. (n0, block) pairs are distributed across threads.
+///
+/// Note that no pivoting is performed; the matrix should be diagonally
+/// dominant (as for implicit diffusion).
+///
+/// $Id$
+///
+#include <algorithm>
+#include <vector>
+#include "config.hpp"
+#include "NArray.hpp"
+
+namespace tridiag
+{
+/// number of interleaved lines solved at once for an axis but the last one
+enum { BLOCK = 256 };
+
+/// number of lines transposed at once for the last axis
+enum { LANES = 16 };
+
+///
+/// @brief solve m interleaved tridiagonal systems of size n
+///
+/// d is overwritten by the solution, and w (n*m) is used as scratch, in
+/// which the element i of the line l is at w[i*m + l].
+///
+template <class T>
+void solve(const T* RESTRICT a, const T* RESTRICT b, const T* RESTRICT c,
+           T* RESTRICT d, T* RESTRICT w, const int64 n, const int64 stride,
+           const int64 m)
+{
+  // forward elimination
+#pragma omp simd
+  for(int64 l=0; l < m ;l++) {
+    const T r = 1/b[l];
+    w[l] = c[l]*r;
+    d[l] = d[l]*r;
+  }
+  for(int64 i=1; i < n ;i++) {
+    const int64 ic = i*stride;
+    const int64 im = ic - stride;
+    const T* RESTRICT wm = &w[(i-1)*m];
+    T* RESTRICT wc = &w[i*m];
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      const T r = 1/(b[ic+l] - a[ic+l]*wm[l]);
+      wc[l] = c[ic+l]*r;
+      d[ic+l] = (d[ic+l] - a[ic+l]*d[im+l])*r;
+    }
+  }
+
+  // backward substitution
+  for(int64 i=n-2; i >= 0 ;i--) {
+    const int64 ic = i*stride;
+    const int64 ip = ic + stride;
+    const T* RESTRICT wc = &w[i*m];
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      d[ic+l] -= wc[l]*d[ip+l];
+    }
+  }
+}
+
+///
+/// @brief solve m interleaved cyclic tridiagonal systems of size n (>= 3)
+///
+/// d is overwritten by the solution, and w, z (n*m) and f (m) are used as
+/// scratch in the same way as solve().
+///
+template <class T>
+void solve_cyclic(const T* RESTRICT a, const T* RESTRICT b,
+                  const T* RESTRICT c, T* RESTRICT d, T* RESTRICT w,
+                  T* RESTRICT z, T* RESTRICT f, const int64 n,
+                  const int64 stride, const int64 m)
+{
+  const int64 in = (n-1)*stride;
+  const int64 jn = (n-1)*m;
+
+  // first row with b[0] - gamma, where gamma = -b[0]
+#pragma omp simd
+  for(int64 l=0; l < m ;l++) {
+    const T r = 1/(2*b[l]);
+    w[l] = c[l]*r;
+    d[l] = d[l]*r;
+    z[l] = -b[l]*r;
+  }
+
+  // forward elimination for two right-hand-sides d and z
+  for(int64 i=1; i < n-1 ;i++) {
+    const int64 ic = i*stride;
+    const int64 im = ic - stride;
+    const int64 jc = i*m;
+    const int64 jm = jc - m;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      const T r = 1/(b[ic+l] - a[ic+l]*w[jm+l]);
+      w[jc+l] = c[ic+l]*r;
+      d[ic+l] = (d[ic+l] - a[ic+l]*d[im+l])*r;
+      z[jc+l] = -a[ic+l]*z[jm+l]*r;
+    }
+  }
+
+  // last row with b[n-1] - a[0]*c[n-1]/gamma
+#pragma omp simd
+  for(int64 l=0; l < m ;l++) {
+    const int64 im = in - stride;
+    const int64 jm = jn - m;
+    const T bn = b[in+l] + a[l]*c[in+l]/b[l];
+    const T r  = 1/(bn - a[in+l]*w[jm+l]);
+    d[in+l] = (d[in+l] - a[in+l]*d[im+l])*r;
+    z[jn+l] = (c[in+l] - a[in+l]*z[jm+l])*r;
+  }
+
+  // backward substitution
+  for(int64 i=n-2; i >= 0 ;i--) {
+    const int64 ic = i*stride;
+    const int64 ip = ic + stride;
+    const int64 jc = i*m;
+    const int64 jp = jc + m;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      d[ic+l] -= w[jc+l]*d[ip+l];
+      z[jc+l] -= w[jc+l]*z[jp+l];
+    }
+  }
+
+  // correction x = y - (v.y)/(1 + v.z) z with v = (1, 0, ..., 0, -a/b)
+#pragma omp simd
+  for(int64 l=0; l < m ;l++) {
+    const T s = a[l]/b[l];
+    f[l] = (d[l] - s*d[in+l]) / (1 + z[l] - s*z[jn+l]);
+  }
+  for(int64 i=0; i < n ;i++) {
+    const int64 ic = i*stride;
+    const int64 jc = i*m;
+#pragma omp simd
+    for(int64 l=0; l < m ;l++) {
+      d[ic+l] -= f[l]*z[jc+l];
+    }
+  }
+}
+
+// solve m interleaved systems with scratch s of size (2*n + 1)*m
+template <class T>
+INLINE void solve_lines(const T *a, const T *b, const T *c, T *d, T *s,
+                        const int64 n, const int64 stride, const int64 m,
+                        const bool periodic)
+{
+  if( periodic ) {
+    solve_cyclic(a, b, c, d, &s[0], &s[n*m], &s[2*n*m], n, stride, m);
+  } else {
+    solve(a, b, c, d, &s[0], n, stride, m);
+  }
+}
+
+///
+/// @brief solve tridiagonal systems along a given axis of NArray
+///
+/// a, b, c and d are arrays of the same shape, and d is overwritten by the
+/// solution. If periodic is true, the systems are cyclic (n1 >= 3).
+///
+template <class T, int Rank>
+void solve(const NArray<T,Rank> &a, const NArray<T,Rank> &b,
+           const NArray<T,Rank> &c, NArray<T,Rank> &d, const int axis,
+           const bool periodic=false)
+{
+  int64 n0 = 1;
+  int64 n1 = d.shape[axis];
+  int64 n2 = 1;
+  for(int k=0; k < axis ;k++) n0 *= d.shape[k];
+  for(int k=axis+1; k < Rank ;k++) n2 *= d.shape[k];
+
+  if( n1 < 1 ) return;
+
+  const T* aa = a.data;
+  const T* bb = b.data;
+  const T* cc = c.data;
+  T* dd = d.data;
+
+  if( n2 == 1 ) {
+    // transpose LANES contiguous lines into scratch
+    const int64 nb = (n0 + LANES - 1)/LANES;
+#pragma omp parallel
+    {
+      std::vector<T> buf(4*n1*LANES + (2*n1 + 1)*LANES);
+      T* ta = &buf[0*n1*LANES];
+      T* tb = &buf[1*n1*LANES];
+      T* tc = &buf[2*n1*LANES];
+      T* td = &buf[3*n1*LANES];
+      T* ts = &buf[4*n1*LANES];
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < nb ;ib++) {
+        const int64 l0 = ib*LANES;
+        const int64 m  = std::min<int64>(LANES, n0 - l0);
+
+        const int64 ip = l0*n1;
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            ta[i*LANES + l] = aa[ip + l*n1 + i];
+            tb[i*LANES + l] = bb[ip + l*n1 + i];
+            tc[i*LANES + l] = cc[ip + l*n1 + i];
+            td[i*LANES + l] = dd[ip + l*n1 + i];
+          }
+        }
+
+        solve_lines(ta, tb, tc, td, ts, n1, LANES, m, periodic);
+
+        for(int64 i=0; i < n1 ;i++) {
+          for(int64 l=0; l < m ;l++) {
+            dd[ip + l*n1 + i] = td[i*LANES + l];
+          }
+        }
+      }
+    }
+  } else {
+    // interleaved lines without transpose
+    const int64 nb = (n2 + BLOCK - 1)/BLOCK;
+#pragma omp parallel
+    {
+      std::vector<T> buf((2*n1 + 1)*BLOCK);
+
+#pragma omp for schedule(static)
+      for(int64 ib=0; ib < n0*nb ;ib++) {
+        const int64 i0 = ib / nb;
+        const int64 l0 = (ib % nb) * BLOCK;
+        const int64 m  = std::min<int64>(BLOCK, n2 - l0);
+        const int64 ip = i0*n1*n2 + l0;
+
+        solve_lines(&aa[ip], &bb[ip], &cc[ip], &dd[ip], &buf[0],
+                    n1, n2, m, periodic);
+      }
+    }
+  }
+}
+}
+
+// Local Variables:
+// c-file-style   : "gnu"
+// c-file-offsets : ((innamespace . 0) (inline-open . 0))
+// End:
+#endif